@@ -0,0 +1,176 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of Beast: https://github.com/vinniefalco/Beast
+    Copyright 2014, Vinnie Falco <vinnie.falco@gmail.com>
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef BEAST_NUDB_DETAIL_MAPPING_H_INCLUDED
+#define BEAST_NUDB_DETAIL_MAPPING_H_INCLUDED
+
+#include <beast/nudb/common.h>
+#include <beast/nudb/posix_file.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#if BEAST_NUDB_POSIX_FILE
+# include <sys/mman.h>
+#endif
+
+namespace beast {
+namespace nudb {
+namespace detail {
+
+// Read-only memory mapping of a file.
+//
+// The mapping may reserve room past the end of the file. Bytes the
+// file gains there become visible once extend is called with the new
+// length, and bytes rewritten in place are visible at once. Where
+// mapping is not supported the mapping is always empty, so callers
+// fall back to reading the file.
+//
+class mapping
+{
+private:
+    std::uint8_t const* data_ = nullptr;
+    std::size_t capacity_ = 0;          // bytes mapped
+    mutable std::atomic<
+        std::size_t> size_;             // bytes of the file visible
+
+public:
+    mapping()
+        : size_ (0)
+    {
+    }
+
+    mapping (mapping const&) = delete;
+    mapping& operator= (mapping const&) = delete;
+
+    ~mapping()
+    {
+        close();
+    }
+
+    // Map the file at path, replacing any previous mapping, with
+    // room for the file to grow by headroom bytes. Returns `false`
+    // if the file could not be mapped.
+    bool
+    open (path_type const& path,
+        std::size_t headroom = 0);
+
+    void
+    close();
+
+    // Make the first size bytes of the file visible. Returns
+    // `false` if the file has outgrown the mapping. Readers
+    // share the mapping, so this is allowed through const.
+    bool
+    extend (std::size_t size) const
+    {
+        if (! data_ || size > capacity_)
+            return false;
+        if (size > size_.load(std::memory_order_relaxed))
+            size_.store(size, std::memory_order_release);
+        return true;
+    }
+
+    std::size_t
+    size() const
+    {
+        return size_.load(std::memory_order_acquire);
+    }
+
+    // Returns a pointer to bytes at offset, or nullptr
+    // if the range is not entirely within the mapping.
+    void const*
+    view (std::size_t offset, std::size_t bytes) const
+    {
+        auto const size = this->size();
+        if (offset > size || bytes > size - offset)
+            return nullptr;
+        return data_ + offset;
+    }
+};
+
+#if BEAST_NUDB_POSIX_FILE
+
+inline
+bool
+mapping::open (path_type const& path,
+    std::size_t headroom)
+{
+    close();
+    int const fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+        return false;
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size <= 0)
+    {
+        ::close(fd);
+        return false;
+    }
+    // Pages past the end of the file are never touched, since
+    // views stop at the length made visible by extend.
+    std::size_t const capacity = st.st_size + headroom;
+    void* const p = ::mmap(nullptr, capacity,
+        PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping stays valid after the descriptor is closed
+    ::close(fd);
+    if (p == MAP_FAILED)
+        return false;
+#ifdef MADV_RANDOM
+    // Lookups hash to random offsets, readahead only wastes cache
+    ::madvise(p, capacity, MADV_RANDOM);
+#endif
+    data_ = reinterpret_cast<std::uint8_t const*>(p);
+    capacity_ = capacity;
+    size_.store(st.st_size, std::memory_order_release);
+    return true;
+}
+
+inline
+void
+mapping::close()
+{
+    if (data_)
+        ::munmap(const_cast<std::uint8_t*>(data_), capacity_);
+    data_ = nullptr;
+    capacity_ = 0;
+    size_.store(0, std::memory_order_relaxed);
+}
+
+#else
+
+inline
+bool
+mapping::open (path_type const&, std::size_t)
+{
+    return false;
+}
+
+inline
+void
+mapping::close()
+{
+}
+
+#endif
+
+} // detail
+} // nudb
+} // beast
+
+#endif
@@ -28,6 +28,7 @@
 #include <beast/nudb/detail/cache.h>
 #include <beast/nudb/detail/format.h>
 #include <beast/nudb/detail/gentex.h>
+#include <beast/nudb/detail/mapping.h>
 #include <beast/nudb/detail/pool.h>
 #include <boost/thread/lock_types.hpp>
 #include <boost/thread/shared_mutex.hpp>
@@ -44,6 +45,7 @@
 #include <cstdlib>
 #include <cstring>
 #include <exception>
+#include <functional>
 #include <limits>
 #include <beast/cxx14/memory.h> // <memory>
 #include <mutex>
@@ -51,6 +53,7 @@
 #include <string>
 #include <thread>
 #include <utility>
+#include <vector>
 
 #if DOXYGEN
 #include <beast/nudb/README.md>
@@ -96,7 +99,11 @@ private:
         bulk_write_size     = 16 * 1024 * 1024,
 
         // Size of bulk reads during recover
-        recover_read_size   = 16 * 1024 * 1024
+        recover_read_size   = 16 * 1024 * 1024,
+
+        // Address space reserved past the end of each
+        // mapped file, so commits rarely need a new mapping
+        map_headroom        = 1024 * 1024 * 1024
     };
 
     using clock_type =
@@ -108,6 +115,13 @@ private:
     using unique_lock_type =
         boost::unique_lock<boost::shared_mutex>;
 
+    // Mappings of the key and data files for readers
+    struct maps
+    {
+        detail::mapping kf;
+        detail::mapping df;
+    };
+
     struct state
     {
         File df;
@@ -120,9 +134,14 @@ private:
         detail::pool p1;
         detail::cache c0;
         detail::cache c1;
-        Codec const codec;
+        Codec codec;
         detail::key_file_header const kh;
 
+        // Extended after each commit, since the files grow, and
+        // replaced once they outgrow it. Readers hold a reference
+        // while they use a view.
+        std::shared_ptr<maps const> mp;
+
         // pool commit high water mark
         std::size_t pool_thresh = 1;
 
@@ -137,6 +156,7 @@ private:
     };
 
     bool open_ = false;
+    bool mapped_ = false;
 
     // VFALCO Unfortunately boost::optional doesn't support
     //        move construction so we use unique_ptr instead.
@@ -215,6 +235,31 @@ public:
         return s_->kh.appnum;
     }
 
+    /** Returns the approximate number of keys stored.
+
+        The key file gains a bucket after a fixed number
+        of inserts, so the count is derived from the number
+        of buckets and is accurate to about one bucket's
+        worth of keys. Keys not yet committed are not counted.
+    */
+    std::size_t
+    key_count_estimate()
+    {
+        shared_lock_type m (m_);
+        return buckets_ * (thresh_ / 65536);
+    }
+
+    /** Returns the codec of the open database.
+
+        The codec is created when the database is opened. It
+        may be configured before the first insert or fetch.
+    */
+    Codec&
+    codec()
+    {
+        return s_->codec;
+    }
+
     /** Close the database.
 
         All data is committed before closing.
@@ -225,6 +270,21 @@ public:
     void
     close();
 
+    /** Read through memory mappings of the key and data files.
+
+        When enabled, fetches take key file buckets and data
+        records straight from the mappings instead of reading
+        them into buffers. Uncompressed values are passed to
+        the fetch handler without being copied. Inserts and
+        commits still use the files. This must be called
+        before open.
+    */
+    void
+    map_files (bool enable)
+    {
+        mapped_ = enable;
+    }
+
     /** Open a database.
 
         @param args Arguments passed to File constructors
@@ -253,6 +313,25 @@ public:
     bool
     fetch (void const* key, Handler&& handler);
 
+    /** Fetch a batch of values.
+
+        Keys are grouped by bucket so that each key file bucket
+        is read at most once, and data records are then read in
+        ascending file offset order.
+
+        For each key that is found, Handler will be called as:
+            `(void)()(std::size_t i, void const* data, std::size_t size)`
+
+        where i is the index of the key in keys. Keys which are
+        not found are not reported. The order of calls is unspecified.
+
+        @return The number of keys that were found.
+    */
+    template <class Handler>
+    std::size_t
+    fetch_batch (std::size_t n, void const* const* keys,
+        Handler&& handler);
+
     /** Insert a value.
 
         Returns:
@@ -263,6 +342,41 @@ public:
     insert (void const* key, void const* data,
         std::size_t bytes);
 
+    /** Insert a batch of values.
+
+        Keys are hashed and values compressed before any
+        lock is taken, each into its own slot, by calling
+        `for_each(n, f)`. It must call `f(i)` once for every
+        i in [0, n) and return when all calls are done, and
+        may make the calls from several threads at once.
+        Existing keys are then found with one batch fetch,
+        and the new records are added to the pool under a
+        single lock acquisition. Keys which already exist,
+        or which appear earlier in the batch, are not
+        inserted.
+
+        @return The number of keys inserted.
+    */
+    template <class ForEach>
+    std::size_t
+    insert_batch (std::size_t n, void const* const* keys,
+        void const* const* data, std::size_t const* sizes,
+            ForEach&& for_each);
+
+    /** Insert a batch of values, compressing on this thread. */
+    std::size_t
+    insert_batch (std::size_t n, void const* const* keys,
+        void const* const* data, std::size_t const* sizes)
+    {
+        return insert_batch (n, keys, data, sizes,
+            [](std::size_t n, std::function<
+                void(std::size_t)> const& f)
+            {
+                for (std::size_t i = 0; i < n; ++i)
+                    f(i);
+            });
+    }
+
 private:
     void
     rethrow()
@@ -276,7 +390,45 @@ private:
     template <class Handler>
     bool
     fetch (std::size_t h, void const* key,
-        detail::bucket b, Handler&& handler);
+        detail::bucket b, maps const* mp,
+            Handler&& handler);
+
+    // Returns the bucket at offset in f, viewed in the
+    // mapping m if it holds the bucket, else read into buf.
+    //
+    detail::bucket
+    read_bucket (File& f, detail::mapping const* m,
+        std::size_t offset, detail::buffer& buf);
+
+    // Returns bytes at offset in the data file, viewed
+    // in the mapping if it holds them, else read into buf.
+    //
+    void const*
+    read_data (maps const* mp, std::size_t offset,
+        std::size_t bytes, detail::buffer& buf);
+
+    // Make the files as they are now visible through the
+    // mappings, mapping them again if they have outgrown
+    // the room reserved. Does nothing unless enabled.
+    //
+    void
+    remap();
+
+    // A data record which may hold a key in a batch fetch
+    struct candidate
+    {
+        std::size_t offset;
+        std::size_t size;
+        std::size_t index;
+    };
+
+    // Gather candidate records for key i in loaded bucket b,
+    // and return the offset of b's spill record, or zero.
+    //
+    static
+    std::size_t
+    gather (std::size_t h, std::size_t i,
+        detail::bucket const& b, std::vector<candidate>& v);
 
     // Returns `true` if the key exists
     // lock is unlocked after the first bucket processed
@@ -389,6 +541,7 @@ store<Hasher, Codec, File>::open (
         throw store_corrupt_error (
             "bad key file length");
     s_ = std::move(s);
+    remap();
     open_ = true;
     thread_ = std::thread(
         &store::run, this);
@@ -441,22 +594,155 @@ store<Hasher, Codec, File>::fetch (
         return true;
     }
 next:
+    auto const mp = s_->mp;
     auto const n = bucket_index(
         h, buckets_, modulus_);
     auto const iter = s_->c1.find(n);
     if (iter != s_->c1.end())
         return fetch(h, key,
-            iter->second, handler);
+            iter->second, mp.get(), handler);
     // VFALCO Audit for concurrency
     genlock <gentex> g (g_);
     m.unlock();
-    buffer buf (s_->kh.block_size);
-    // VFALCO Constructs with garbage here
-    bucket b (s_->kh.block_size,
-        buf.get());
-    b.read (s_->kf,
-        (n + 1) * b.block_size());
-    return fetch(h, key, b, handler);
+    buffer buf;
+    auto const b = read_bucket (s_->kf,
+        mp ? &mp->kf : nullptr,
+            (n + 1) * s_->kh.block_size, buf);
+    return fetch(h, key, b, mp.get(), handler);
+}
+
+template <class Hasher, class Codec, class File>
+template <class Handler>
+std::size_t
+store<Hasher, Codec, File>::fetch_batch (
+    std::size_t n, void const* const* keys,
+        Handler&& handler)
+{
+    using namespace detail;
+    rethrow();
+    std::size_t found = 0;
+    std::vector<std::size_t> hashes;
+    hashes.reserve(n);
+    for (std::size_t i = 0; i < n; ++i)
+        hashes.push_back(hash<Hasher>(
+            keys[i], s_->kh.key_size, s_->kh.salt));
+    // Keys waiting on a key file bucket, as (bucket, index)
+    std::vector<std::pair<std::size_t, std::size_t>> pending;
+    // Data records to examine, and spills to follow
+    std::vector<candidate> cv;
+    std::vector<std::pair<std::size_t, std::size_t>> spills;
+    buffer buf;
+    shared_lock_type m (m_);
+    auto const mp = s_->mp;
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        auto iter = s_->p1.find(keys[i]);
+        if (iter == s_->p1.end())
+        {
+            iter = s_->p0.find(keys[i]);
+            if (iter == s_->p0.end())
+            {
+                auto const nb = bucket_index(
+                    hashes[i], buckets_, modulus_);
+                auto const iter1 = s_->c1.find(nb);
+                if (iter1 == s_->c1.end())
+                {
+                    pending.emplace_back(nb, i);
+                }
+                else
+                {
+                    auto const spill = gather(
+                        hashes[i], i, iter1->second, cv);
+                    if (spill)
+                        spills.emplace_back(spill, i);
+                }
+                continue;
+            }
+        }
+        auto const result =
+            s_->codec.decompress(
+                iter->first.data,
+                    iter->first.size, buf);
+        handler(i, result.first, result.second);
+        ++found;
+    }
+    // VFALCO Audit for concurrency
+    genlock <gentex> g (g_);
+    m.unlock();
+    // Read each needed bucket once, in file order
+    std::sort(pending.begin(), pending.end());
+    buffer kb;
+    for (std::size_t j = 0; j < pending.size();)
+    {
+        auto const nb = pending[j].first;
+        auto const b = read_bucket (s_->kf,
+            mp ? &mp->kf : nullptr,
+                (nb + 1) * s_->kh.block_size, kb);
+        for (; j < pending.size() &&
+            pending[j].first == nb; ++j)
+        {
+            auto const i = pending[j].second;
+            auto const spill = gather(
+                hashes[i], i, b, cv);
+            if (spill)
+                spills.emplace_back(spill, i);
+        }
+    }
+    // Follow spill records, each of which holds
+    // the overflow for a single bucket.
+    while (! spills.empty())
+    {
+        std::sort(spills.begin(), spills.end());
+        decltype(spills) next;
+        for (std::size_t j = 0; j < spills.size();)
+        {
+            auto const spill = spills[j].first;
+            auto const b = read_bucket (s_->df,
+                mp ? &mp->df : nullptr, spill, kb);
+            for (; j < spills.size() &&
+                spills[j].first == spill; ++j)
+            {
+                auto const i = spills[j].second;
+                auto const more = gather(
+                    hashes[i], i, b, cv);
+                if (more)
+                    next.emplace_back(more, i);
+            }
+        }
+        spills.swap(next);
+    }
+    // Read data records in ascending offset order
+    std::sort(cv.begin(), cv.end(),
+        [](candidate const& lhs, candidate const& rhs)
+        {
+            return lhs.offset < rhs.offset;
+        });
+    std::vector<bool> done (n, false);
+    buffer buf0;
+    for (auto const& c : cv)
+    {
+        if (done[c.index])
+            continue;
+        // Data Record
+        auto const len =
+            s_->kh.key_size +       // Key
+            c.size;                 // Value
+        auto const p = reinterpret_cast<
+            std::uint8_t const*>(read_data(mp.get(),
+                c.offset + field<uint48_t>::size, // Size
+                    len, buf0));
+        if (std::memcmp(p, keys[c.index],
+                s_->kh.key_size) != 0)
+            continue;
+        auto const result =
+            s_->codec.decompress(
+                p + s_->kh.key_size,
+                    c.size, buf);
+        handler(c.index, result.first, result.second);
+        done[c.index] = true;
+        ++found;
+    }
+    return found;
 }
 
 template <class Hasher, class Codec, class File>
@@ -531,12 +817,80 @@ store<Hasher, Codec, File>::insert (
     return true;
 }
 
+template <class Hasher, class Codec, class File>
+template <class ForEach>
+std::size_t
+store<Hasher, Codec, File>::insert_batch (
+    std::size_t n, void const* const* keys,
+        void const* const* data, std::size_t const* sizes,
+            ForEach&& for_each)
+{
+    using namespace detail;
+    rethrow();
+    for (std::size_t i = 0; i < n; ++i)
+        if (sizes[i] > field<uint48_t>::max)
+            throw std::logic_error(
+                "nudb: size too large");
+    std::vector<std::size_t> hashes (n);
+    std::vector<buffer> bufs (n);
+    std::vector<std::pair<void const*,
+        std::size_t>> values (n);
+    for_each (n, std::function<void(std::size_t)> (
+        [&](std::size_t i)
+        {
+            hashes[i] = hash<Hasher>(keys[i],
+                s_->kh.key_size, s_->kh.salt);
+            values[i] = s_->codec.compress(
+                data[i], sizes[i], bufs[i]);
+        }));
+    std::lock_guard<std::mutex> u (u_);
+    // Holding u_ means no key found missing
+    // here can be inserted by anyone else.
+    std::vector<bool> exists (n, false);
+    fetch_batch (n, keys,
+        [&](std::size_t i, void const*, std::size_t)
+        {
+            exists[i] = true;
+        });
+    std::size_t inserted = 0;
+    unique_lock_type m (m_);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        if (exists[i])
+            continue;
+        if (s_->p1.find(keys[i]) != s_->p1.end())
+            continue;
+        s_->p1.insert (hashes[i], keys[i],
+            values[i].first, values[i].second);
+        ++inserted;
+    }
+    // Did we go over the commit limit?
+    if (commit_limit_ > 0 &&
+        s_->p1.data_size() >= commit_limit_)
+    {
+        // Yes, start a new commit
+        cond_.notify_all();
+        // Wait for pool to shrink
+        cond_limit_.wait(m,
+            [this]() { return
+                s_->p1.data_size() <
+                    commit_limit_; });
+    }
+    bool const notify =
+        s_->p1.data_size() >= s_->pool_thresh;
+    m.unlock();
+    if (notify)
+        cond_.notify_all();
+    return inserted;
+}
+
 template <class Hasher, class Codec, class File>
 template <class Handler>
 bool
 store<Hasher, Codec, File>::fetch (
     std::size_t h, void const* key,
-        detail::bucket b, Handler&& handler)
+        detail::bucket b, maps const* mp,
+            Handler&& handler)
 {
     using namespace detail;
     buffer buf0;
@@ -553,16 +907,16 @@ store<Hasher, Codec, File>::fetch (
             auto const len = 
                 s_->kh.key_size +       // Key
                 item.size;              // Value
-            buf0.reserve(len);
-            s_->df.read(item.offset +
-                field<uint48_t>::size,  // Size
-                    buf0.get(), len);
-            if (std::memcmp(buf0.get(), key,
+            auto const p = reinterpret_cast<
+                std::uint8_t const*>(read_data(mp,
+                    item.offset + field<uint48_t>::size, // Size
+                        len, buf0));
+            if (std::memcmp(p, key,
                 s_->kh.key_size) == 0)
             {
                 auto const result =
                     s_->codec.decompress(
-                        buf0.get() + s_->kh.key_size,
+                        p + s_->kh.key_size,
                             item.size, buf1);
                 handler(result.first, result.second);
                 return true;
@@ -571,14 +925,99 @@ store<Hasher, Codec, File>::fetch (
         auto const spill = b.spill();
         if (! spill)
             break;
-        buf1.reserve(s_->kh.block_size);
-        b = bucket(s_->kh.block_size,
-            buf1.get());
-        b.read(s_->df, spill);
+        b = read_bucket(s_->df,
+            mp ? &mp->df : nullptr, spill, buf1);
     }
     return false;
 }
 
+template <class Hasher, class Codec, class File>
+detail::bucket
+store<Hasher, Codec, File>::read_bucket (
+    File& f, detail::mapping const* m,
+        std::size_t offset, detail::buffer& buf)
+{
+    using namespace detail;
+    auto const cap = bucket_capacity(
+        s_->kh.block_size);
+    if (m)
+    {
+        if (auto const p = m->view(
+            offset, bucket_size(cap)))
+        {
+            // Fetches only inspect the bucket,
+            // nothing writes through the view.
+            bucket b (s_->kh.block_size,
+                const_cast<void*>(p));
+            if (b.size() > cap)
+                throw store_corrupt_error(
+                    "bad bucket size");
+            return b;
+        }
+    }
+    buf.reserve(s_->kh.block_size);
+    // VFALCO Constructs with garbage here
+    bucket b (s_->kh.block_size,
+        buf.get());
+    b.read (f, offset);
+    return b;
+}
+
+template <class Hasher, class Codec, class File>
+void const*
+store<Hasher, Codec, File>::read_data (
+    maps const* mp, std::size_t offset,
+        std::size_t bytes, detail::buffer& buf)
+{
+    if (mp)
+    {
+        if (auto const p = mp->df.view(
+                offset, bytes))
+            return p;
+    }
+    buf.reserve(bytes);
+    s_->df.read(offset, buf.get(), bytes);
+    return buf.get();
+}
+
+template <class Hasher, class Codec, class File>
+void
+store<Hasher, Codec, File>::remap()
+{
+    if (! mapped_)
+        return;
+    // Only this thread replaces the mappings
+    auto const kf_size = s_->kf.actual_size();
+    auto const df_size = s_->df.actual_size();
+    if (s_->mp &&
+        s_->mp->kf.extend(kf_size) &&
+        s_->mp->df.extend(df_size))
+        return;
+    // A file that can't be mapped is read as usual
+    auto mp = std::make_shared<maps>();
+    mp->kf.open(s_->kp, map_headroom);
+    mp->df.open(s_->dp, map_headroom);
+    unique_lock_type m (m_);
+    s_->mp = std::move(mp);
+}
+
+template <class Hasher, class Codec, class File>
+std::size_t
+store<Hasher, Codec, File>::gather (
+    std::size_t h, std::size_t i,
+        detail::bucket const& b, std::vector<candidate>& v)
+{
+    for (auto j = b.lower_bound(h);
+        j < b.size(); ++j)
+    {
+        auto const item = b[j];
+        if (item.hash != h)
+            break;
+        v.push_back({item.offset, item.size, i});
+    }
+    return b.spill();
+}
+
 template <class Hasher, class Codec, class File>
 bool
 store<Hasher, Codec, File>::exists (
@@ -872,6 +1311,9 @@ store<Hasher, Codec, File>::commit()
     s_->kf.sync();
     s_->lf.trunc(0);
     s_->lf.sync();
+    // Let readers see the new records and buckets
+    // in place, before the cache that held them goes.
+    remap();
     // Cache is no longer needed, all fetches will go straight
     // to disk again. Do this after the sync, otherwise readers
     // might get blocked longer due to the extra I/O.
@@ -23,11 +23,15 @@
 #include <beast/module/core/files/File.h>
 #include <beast/random/xor_shift_engine.h>
 #include <beast/unit_test/suite.h>
+#include <atomic>
 #include <cmath>
+#include <functional>
 #include <iomanip>
 #include <memory>
 #include <random>
+#include <thread>
 #include <utility>
+#include <vector>
 
 namespace beast {
 namespace nudb {
@@ -41,11 +45,33 @@ namespace test {
 class store_test : public unit_test::suite
 {
 public:
+    // Runs f over [0, n) on several threads, the
+    // way a caller would hand insert_batch a pool.
+    static
+    void
+    parallel_for_each (std::size_t n,
+        std::function<void(std::size_t)> const& f)
+    {
+        std::atomic<std::size_t> next (0);
+        auto const work = [&]()
+        {
+            for (auto i = next++; i < n; i = next++)
+                f(i);
+        };
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 3; ++i)
+            threads.emplace_back (work);
+        work();
+        for (auto& t : threads)
+            t.join();
+    }
+
     void
     do_test (std::size_t N,
-        std::size_t block_size, float load_factor)
+        std::size_t block_size, float load_factor,
+            bool mapped)
     {
-        testcase (abort_on_fail);
+        testcase (abort_on_fail) << (mapped ? "mapped" : "unmapped");
         std::string const path =
             beast::UnitTestUtilities::TempDirectory(
                 "test_db").getFullPathName().toStdString();
@@ -54,6 +80,7 @@ public:
         auto const lp = path + ".log";
         Sequence seq;
         test_api::store db;
+        db.map_files(mapped);
         try
         {
             expect (test_api::create (dp, kp, lp, appnum,
@@ -79,6 +106,33 @@ public:
                 expect (std::memcmp(s.get(),
                     v.data, v.size) == 0, "not equal");
             }
+            // fetch batch
+            {
+                std::vector<key_type> kv;
+                std::vector<void const*> keys;
+                kv.reserve(2 * N);
+                keys.reserve(2 * N);
+                for (std::size_t i = 0; i < 2 * N; ++i)
+                {
+                    kv.push_back(seq.key(i));
+                    keys.push_back(&kv.back());
+                }
+                std::vector<bool> seen (2 * N, false);
+                std::size_t const found = db.fetch_batch(
+                    keys.size(), keys.data(),
+                    [&](std::size_t i,
+                        void const* data, std::size_t size)
+                    {
+                        expect (i < N, "unexpected key");
+                        expect (! seen[i], "duplicate key");
+                        seen[i] = true;
+                        auto const v = seq[i];
+                        expect (size == v.size, "wrong size");
+                        expect (std::memcmp(data,
+                            v.data, size) == 0, "not equal");
+                    });
+                expect (found == N, "batch count");
+            }
             // insert duplicates
             for (std::size_t i = 0; i < N; ++i)
             {
@@ -99,6 +153,45 @@ public:
                 expect (db.insert(&v.key, v.data, v.size),
                     "insert 2");
             }
+            // insert batch, half of which already exists
+            {
+                std::vector<key_type> kv;
+                std::vector<std::vector<std::uint8_t>> dv;
+                std::vector<void const*> keys;
+                std::vector<void const*> data;
+                std::vector<std::size_t> sizes;
+                kv.reserve(2 * N);
+                dv.reserve(2 * N);
+                for (std::size_t i = N; i < 3 * N; ++i)
+                {
+                    auto const v = seq[i];
+                    kv.push_back(v.key);
+                    dv.emplace_back(v.data, v.data + v.size);
+                    keys.push_back(&kv.back());
+                    data.push_back(dv.back().data());
+                    sizes.push_back(v.size);
+                }
+                // repeat a key within the batch
+                keys.push_back(keys.back());
+                data.push_back(data.back());
+                sizes.push_back(sizes.back());
+                expect (db.insert_batch(keys.size(), keys.data(),
+                    data.data(), sizes.data(), &parallel_for_each) == N,
+                        "insert batch");
+            }
+            // reopen, so every record is read from the files
+            db.close();
+            expect (db.open(dp, kp, lp,
+                arena_alloc_size), "reopen");
+            for (std::size_t i = 0; i < 3 * N; ++i)
+            {
+                auto const v = seq[i];
+                bool const found = db.fetch (&v.key, s);
+                expect (found, "missing after reopen");
+                expect (s.size() == v.size, "wrong size");
+                expect (std::memcmp(s.get(),
+                    v.data, v.size) == 0, "wrong data");
+            }
             db.close();
             //auto const stats = test_api::verify(dp, kp);
             auto const stats = verify<test_api::hash_type>(
@@ -134,7 +227,8 @@ public:
 
         float const load_factor = 0.95f;
 
-        do_test (N, block_size, load_factor);
+        do_test (N, block_size, load_factor, false);
+        do_test (N, block_size, load_factor, true);
     }
 };
 
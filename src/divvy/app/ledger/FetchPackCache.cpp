@@ -0,0 +1,227 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of divvyd: https://github.com/xdv/divvyd
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <divvy/app/ledger/FetchPackCache.h>
+#include <divvy/protocol/JsonFields.h>
+#include <algorithm>
+
+namespace divvy {
+
+// How long after a request prebuilding is still worthwhile
+static std::chrono::seconds const demandWindow (60);
+
+FetchPackCache::FetchPackCache (std::size_t maxSegments,
+        std::size_t maxBytes, beast::Journal journal)
+    : maxSegments_ (maxSegments)
+    , maxBytes_ (maxBytes)
+    , journal_ (journal)
+{
+}
+
+FetchPackCache::Segment
+FetchPackCache::fetch (uint256 const& have, uint256 const& want,
+    Builder const& build)
+{
+    Key const key (have, want);
+    {
+        std::lock_guard <std::mutex> lock (mutex_);
+        lastRequest_ = clock_type::now ();
+
+        auto const iter = map_.find (key);
+        if (iter != map_.end ())
+        {
+            ++hits_;
+            iter->second.lastUse = ++useCount_;
+            return iter->second.segment;
+        }
+        ++misses_;
+    }
+    return make (key, build, false);
+}
+
+FetchPackCache::Segment
+FetchPackCache::find (uint256 const& have, uint256 const& want)
+{
+    std::lock_guard <std::mutex> lock (mutex_);
+    auto const iter = map_.find (Key (have, want));
+    if (iter == map_.end ())
+        return {};
+    iter->second.lastUse = ++useCount_;
+    return iter->second.segment;
+}
+
+bool
+FetchPackCache::prebuild (uint256 const& have, uint256 const& want,
+    Builder const& build)
+{
+    Key const key (have, want);
+    {
+        std::lock_guard <std::mutex> lock (mutex_);
+        if (map_.count (key) != 0)
+            return false;
+    }
+    return make (key, build, true) != nullptr;
+}
+
+FetchPackCache::Segment
+FetchPackCache::make (Key const& key, Builder const& build, bool prebuilt)
+{
+    auto const start = clock_type::now ();
+    Segment segment = build ();
+    auto const elapsed = std::chrono::duration_cast <
+        std::chrono::microseconds> (clock_type::now () - start);
+
+    if (! segment)
+        return segment;
+
+    auto const bytes = footprint (*segment);
+
+    if (journal_.debug) journal_.debug <<
+        "Built fetch pack segment with " << segment->objects_size () <<
+        " objects, " << bytes << " bytes in " << elapsed.count () << "us";
+
+    std::lock_guard <std::mutex> lock (mutex_);
+    ++built_;
+    if (prebuilt)
+        ++prebuilt_;
+    buildTime_ += elapsed;
+    buildTimeMax_ = std::max (buildTimeMax_, elapsed);
+
+    // Another job may have built the same segment meanwhile
+    auto const iter = map_.find (key);
+    if (iter != map_.end ())
+    {
+        iter->second.lastUse = ++useCount_;
+        return iter->second.segment;
+    }
+
+    insert (key, segment, bytes);
+    return segment;
+}
+
+void
+FetchPackCache::insert (Key const& key, Segment const& segment,
+    std::size_t bytes)
+{
+    // A segment larger than the whole budget is served but not kept
+    if (bytes > maxBytes_)
+        return;
+
+    map_.emplace (key, Entry {segment, bytes, ++useCount_});
+    bytes_ += bytes;
+    evict ();
+}
+
+void
+FetchPackCache::evict ()
+{
+    while (! map_.empty () &&
+        (map_.size () > maxSegments_ || bytes_ > maxBytes_))
+    {
+        auto const oldest = std::min_element (map_.begin (), map_.end (),
+            [](std::map <Key, Entry>::value_type const& lhs,
+               std::map <Key, Entry>::value_type const& rhs)
+            {
+                return lhs.second.lastUse < rhs.second.lastUse;
+            });
+        bytes_ -= oldest->second.bytes;
+        map_.erase (oldest);
+        ++evicted_;
+    }
+}
+
+void
+FetchPackCache::onSent (std::size_t objects, std::size_t bytes,
+    std::chrono::milliseconds elapsed)
+{
+    std::lock_guard <std::mutex> lock (mutex_);
+    ++sent_;
+    sentObjects_ += objects;
+    sentBytes_ += bytes;
+    sentBytesMax_ = std::max (sentBytesMax_, bytes);
+    sendTime_ += elapsed;
+    sendTimeMax_ = std::max (sendTimeMax_, elapsed);
+}
+
+bool
+FetchPackCache::inDemand () const
+{
+    std::lock_guard <std::mutex> lock (mutex_);
+    return lastRequest_ != clock_type::time_point () &&
+        (clock_type::now () - lastRequest_) < demandWindow;
+}
+
+std::size_t
+FetchPackCache::size () const
+{
+    std::lock_guard <std::mutex> lock (mutex_);
+    return map_.size ();
+}
+
+std::size_t
+FetchPackCache::bytes () const
+{
+    std::lock_guard <std::mutex> lock (mutex_);
+    return bytes_;
+}
+
+void
+FetchPackCache::getCounts (Json::Value& ret) const
+{
+    std::lock_guard <std::mutex> lock (mutex_);
+
+    ret[jss::fetch_pack_cache_size] = static_cast<Json::UInt> (map_.size ());
+    ret[jss::fetch_pack_cache_bytes] = static_cast<Json::UInt> (bytes_);
+    ret[jss::fetch_pack_hits] = static_cast<Json::UInt> (hits_);
+    ret[jss::fetch_pack_misses] = static_cast<Json::UInt> (misses_);
+    ret[jss::fetch_pack_prebuilt] = static_cast<Json::UInt> (prebuilt_);
+    ret[jss::fetch_pack_evicted] = static_cast<Json::UInt> (evicted_);
+
+    if (built_ != 0)
+    {
+        ret[jss::fetch_pack_build_ms] =
+            static_cast<double> (buildTime_.count ()) / built_ / 1000.0;
+        ret[jss::fetch_pack_build_ms_max] =
+            static_cast<double> (buildTimeMax_.count ()) / 1000.0;
+    }
+
+    ret[jss::fetch_pack_sent] = static_cast<Json::UInt> (sent_);
+    if (sent_ != 0)
+    {
+        ret[jss::fetch_pack_avg_objects] =
+            static_cast<Json::UInt> (sentObjects_ / sent_);
+        ret[jss::fetch_pack_avg_bytes] =
+            static_cast<Json::UInt> (sentBytes_ / sent_);
+        ret[jss::fetch_pack_max_bytes] =
+            static_cast<Json::UInt> (sentBytesMax_);
+        ret[jss::fetch_pack_send_ms] =
+            static_cast<Json::UInt> (sendTime_.count () / sent_);
+        ret[jss::fetch_pack_send_ms_max] =
+            static_cast<Json::UInt> (sendTimeMax_.count ());
+    }
+}
+
+std::size_t
+FetchPackCache::footprint (protocol::TMGetObjectByHash const& segment)
+{
+    return segment.ByteSize ();
+}
+
+} // divvy
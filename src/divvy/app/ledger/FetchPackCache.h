@@ -0,0 +1,156 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of divvyd: https://github.com/xdv/divvyd
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef RIPPLE_APP_LEDGER_FETCHPACKCACHE_H_INCLUDED
+#define RIPPLE_APP_LEDGER_FETCHPACKCACHE_H_INCLUDED
+
+#include <divvy/basics/base_uint.h>
+#include <divvy/json/json_value.h>
+#include <beast/utility/Journal.h>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include "divvy.pb.h"
+
+namespace divvy {
+
+/** Keeps recently built fetch pack segments.
+
+    A segment holds the objects a peer that has ledger `have` needs to
+    build its parent `want`: the header of `want` and the nodes that
+    differ between the two ledgers. A reply to a fetch pack request is a
+    run of consecutive segments walking back from the requested ledger, so
+    peers catching up from nearby ledgers share most of their segments.
+
+    Segments are stored already encoded as the objects of a
+    TMGetObjectByHash reply and are appended to outgoing replies without
+    touching the SHAMaps again. The cache is bounded by segment count and
+    by encoded bytes, least recently used segments are dropped first.
+*/
+class FetchPackCache
+{
+public:
+    using Segment = std::shared_ptr <protocol::TMGetObjectByHash const>;
+    using Builder = std::function <Segment ()>;
+    using clock_type = std::chrono::steady_clock;
+
+    FetchPackCache (std::size_t maxSegments, std::size_t maxBytes,
+        beast::Journal journal);
+
+    FetchPackCache (FetchPackCache const&) = delete;
+    FetchPackCache& operator= (FetchPackCache const&) = delete;
+
+    /** Return the segment for a ledger pair, building it on a miss.
+        The builder runs without the lock held. If it returns null or
+        throws, nothing is cached.
+    */
+    Segment
+    fetch (uint256 const& have, uint256 const& want, Builder const& build);
+
+    /** Return the segment for a ledger pair if it is cached. */
+    Segment
+    find (uint256 const& have, uint256 const& want);
+
+    /** Build and cache a segment ahead of any request for it.
+        Does nothing if the segment is already cached.
+        @return `true` if a segment was built.
+    */
+    bool
+    prebuild (uint256 const& have, uint256 const& want, Builder const& build);
+
+    /** Record a reply sent to a peer. */
+    void
+    onSent (std::size_t objects, std::size_t bytes,
+        std::chrono::milliseconds elapsed);
+
+    /** Return `true` if a fetch pack was requested recently.
+        Used to decide whether prebuilding segments is worth the work.
+    */
+    bool
+    inDemand () const;
+
+    std::size_t
+    size () const;
+
+    std::size_t
+    bytes () const;
+
+    /** Add the cache counters to a get_counts result. */
+    void
+    getCounts (Json::Value& ret) const;
+
+    /** Return the encoded size of a segment. */
+    static
+    std::size_t
+    footprint (protocol::TMGetObjectByHash const& segment);
+
+private:
+    using Key = std::pair <uint256, uint256>;
+
+    struct Entry
+    {
+        Segment segment;
+        std::size_t bytes;
+        std::uint64_t lastUse;
+    };
+
+    // Builds a segment outside the lock and caches it.
+    Segment
+    make (Key const& key, Builder const& build, bool prebuilt);
+
+    void
+    insert (Key const& key, Segment const& segment, std::size_t bytes);
+
+    void
+    evict ();
+
+    std::size_t const maxSegments_;
+    std::size_t const maxBytes_;
+    beast::Journal journal_;
+
+    mutable std::mutex mutex_;
+    std::map <Key, Entry> map_;
+    std::uint64_t useCount_ = 0;
+    std::size_t bytes_ = 0;
+    clock_type::time_point lastRequest_;
+
+    // Counters
+    std::uint64_t hits_ = 0;
+    std::uint64_t misses_ = 0;
+    std::uint64_t built_ = 0;
+    std::uint64_t prebuilt_ = 0;
+    std::uint64_t evicted_ = 0;
+    std::chrono::microseconds buildTime_ {0};
+    std::chrono::microseconds buildTimeMax_ {0};
+    std::uint64_t sent_ = 0;
+    std::uint64_t sentObjects_ = 0;
+    std::uint64_t sentBytes_ = 0;
+    std::size_t sentBytesMax_ = 0;
+    std::chrono::milliseconds sendTime_ {0};
+    std::chrono::milliseconds sendTimeMax_ {0};
+};
+
+} // divvy
+
+#endif
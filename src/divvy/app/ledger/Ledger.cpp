@@ -334,7 +334,7 @@ bool Ledger::addSLE (SLE const& sle)
 bool Ledger::addTransaction (uint256 const& txID, const Serializer& txn)
 {
     // low-level - just add to table
-    auto item = std::make_shared<SHAMapItem> (txID, txn.peekData ());
+    auto item = make_pooled<SHAMapItem> (txID, txn.peekData ());
 
     if (!mTransactionMap->addGiveItem (item, true, false))
     {
@@ -354,7 +354,7 @@ bool Ledger::addTransaction (
     Serializer s (txn.getDataLength () + md.getDataLength () + 16);
     s.addVL (txn.peekData ());
     s.addVL (md.peekData ());
-    auto item = std::make_shared<SHAMapItem> (txID, s.peekData ());
+    auto item = make_pooled<SHAMapItem> (txID, s.peekData ());
 
     if (!mTransactionMap->addGiveItem (item, true, true))
     {
@@ -552,8 +552,6 @@ bool Ledger::saveValidatedLedger (bool current)
         "DELETE FROM Transactions WHERE LedgerSeq = %u;");
     static boost::format deleteTrans2 (
         "DELETE FROM AccountTransactions WHERE LedgerSeq = %u;");
-    static boost::format deleteAcctTrans (
-        "DELETE FROM AccountTransactions WHERE TransID = '%s';");
     static boost::format transExists (
         "SELECT Status FROM Transactions WHERE TransID = '%s';");
     static boost::format updateTx (
@@ -620,7 +618,41 @@ bool Ledger::saveValidatedLedger (bool current)
         *db << boost::str (deleteTrans1 % getLedgerSeq ());
         *db << boost::str (deleteTrans2 % getLedgerSeq ());
 
-        std::string const ledgerSeq (std::to_string (getLedgerSeq ()));
+        // Every row of the ledger goes through these statements, which
+        // are parsed once and then executed with freshly bound values.
+        // The blobs are bound as raw binary rather than hex literals.
+        // SOCI binds unsigned int as int, which would turn sequences
+        // past 2^31 negative, so they are widened to 64 bits.
+        std::int64_t const ledgerSeq = getLedgerSeq ();
+        std::string txnId;
+        std::string account;
+        std::int64_t txnSeq = 0;
+        std::string txnType;
+        std::string fromAcct;
+        std::int64_t fromSeq = 0;
+        std::string const status (1, TXN_SQL_VALIDATED);
+        soci::blob rawTxn (*db);
+        soci::blob txnMeta (*db);
+
+        soci::statement deleteAcctTx = (db->prepare <<
+            "DELETE FROM AccountTransactions WHERE TransID = :id;",
+            soci::use (txnId));
+
+        soci::statement insertAcctTx = (db->prepare <<
+            "INSERT INTO AccountTransactions "
+            "(TransID, Account, LedgerSeq, TxnSeq) VALUES "
+            "(:id, :acct, :seq, :txnSeq);",
+            soci::use (txnId), soci::use (account),
+            soci::use (ledgerSeq), soci::use (txnSeq));
+
+        soci::statement insertTx = (db->prepare <<
+            "INSERT OR REPLACE INTO Transactions "
+            "(TransID, TransType, FromAcct, FromSeq, LedgerSeq, Status, "
+            "RawTxn, TxnMeta) VALUES "
+            "(:id, :type, :from, :fromSeq, :seq, :status, :raw, :meta);",
+            soci::use (txnId), soci::use (txnType), soci::use (fromAcct),
+            soci::use (fromSeq), soci::use (ledgerSeq), soci::use (status),
+            soci::use (rawTxn), soci::use (txnMeta));
 
         for (auto const& vt : aLedger->getMap ())
         {
@@ -629,59 +661,42 @@ bool Ledger::saveValidatedLedger (bool current)
             getApp().getMasterTransaction ().inLedger (
                 transactionID, getLedgerSeq ());
 
-            std::string const txnId (to_string (transactionID));
-            std::string const txnSeq (std::to_string (vt.second->getTxnSeq ()));
+            txnId = to_string (transactionID);
+            txnSeq = vt.second->getTxnSeq ();
 
-            *db << boost::str (deleteAcctTrans % transactionID);
+            deleteAcctTx.execute (true);
 
             auto const& accts = vt.second->getAffected ();
 
-            if (!accts.empty ())
-            {
-                std::string sql ("INSERT INTO AccountTransactions "
-                                 "(TransID, Account, LedgerSeq, TxnSeq) VALUES ");
-
-                // Try to make an educated guess on how much space we'll need
-                // for our arguments. In argument order we have:
-                // 64 + 34 + 10 + 10 = 118 + 10 extra = 128 bytes
-                sql.reserve (sql.length () + (accts.size () * 128));
-
-                bool first = true;
-                for (auto const& it : accts)
-                {
-                    if (!first)
-                        sql += ", ('";
-                    else
-                    {
-                        sql += "('";
-                        first = false;
-                    }
-
-                    sql += txnId;
-                    sql += "','";
-                    sql += it.humanAccountID ();
-                    sql += "',";
-                    sql += ledgerSeq;
-                    sql += ",";
-                    sql += txnSeq;
-                    sql += ")";
-                }
-                sql += ";";
-                if (ShouldLog (lsTRACE, Ledger))
-                {
-                    WriteLog (lsTRACE, Ledger) << "ActTx: " << sql;
-                }
-                *db << sql;
-            }
-            else
+            if (accts.empty ())
                 WriteLog (lsWARNING, Ledger)
                     << "Transaction in ledger " << seq_
                     << " affects no accounts";
 
-            *db <<
-               (STTx::getMetaSQLInsertReplaceHeader () +
-                vt.second->getTxn ()->getMetaSQL (
-                    getLedgerSeq (), vt.second->getEscMeta ()) + ";");
+            for (auto const& it : accts)
+            {
+                account = it.humanAccountID ();
+                insertAcctTx.execute (true);
+            }
+
+            auto const& txn = vt.second->getTxn ();
+            auto const format =
+                TxFormats::getInstance ().findByType (txn->getTxnType ());
+            assert (format != nullptr);
+            txnType = format->getName ();
+            fromAcct = txn->getSourceAccount ().humanAccountID ();
+            fromSeq = txn->getSequence ();
+
+            Serializer s;
+            txn->add (s);
+
+            // A reused blob keeps its old length unless trimmed
+            rawTxn.trim (0);
+            convert (s.peekData (), rawTxn);
+            txnMeta.trim (0);
+            convert (vt.second->getRawMeta (), txnMeta);
+
+            insertTx.execute (true);
         }
 
         tr.commit ();
@@ -718,7 +733,7 @@ loadLedgerHelper(std::string const& sqlSuffix)
     uint256 ledgerHash;
     std::uint32_t ledgerSeq{0};
 
-    auto db = getApp ().getLedgerDB ().checkoutDb ();
+    auto db = getApp ().getLedgerDB ().checkoutReadDb ();
 
     boost::optional<std::string> sLedgerHash, sPrevHash, sAccountHash,
         sTransHash;
@@ -838,7 +853,7 @@ uint256 Ledger::getHashByIndex (std::uint32_t ledgerIndex)
 
     std::string hash;
     {
-        auto db = getApp().getLedgerDB ().checkoutDb ();
+        auto db = getApp().getLedgerDB ().checkoutReadDb ();
 
         boost::optional<std::string> lh;
         *db << sql,
@@ -859,7 +874,7 @@ uint256 Ledger::getHashByIndex (std::uint32_t ledgerIndex)
 bool Ledger::getHashesByIndex (
     std::uint32_t ledgerIndex, uint256& ledgerHash, uint256& parentHash)
 {
-    auto db = getApp().getLedgerDB ().checkoutDb ();
+    auto db = getApp().getLedgerDB ().checkoutReadDb ();
 
     boost::optional <std::string> lhO, phO;
 
@@ -893,7 +908,7 @@ Ledger::getHashesByIndex (std::uint32_t minSeq, std::uint32_t maxSeq)
     sql.append (beast::lexicalCastThrow <std::string> (maxSeq));
     sql.append (";");
 
-    auto db = getApp().getLedgerDB ().checkoutDb ();
+    auto db = getApp().getLedgerDB ().checkoutReadDb ();
 
     std::uint64_t ls;
     std::string lh;
@@ -974,7 +989,7 @@ void
 Ledger::insert (SLE const& sle)
 {
     assert(! mAccountStateMap->hasItem(sle.getIndex()));
-    auto item = std::make_shared<SHAMapItem>(
+    auto item = make_pooled<SHAMapItem> (
         sle.getIndex());
     sle.add(item->peekSerializer());
     auto const success =
@@ -1003,7 +1018,7 @@ void
 Ledger::replace (SLE const& sle)
 {
     assert(mAccountStateMap->hasItem(sle.getIndex()));
-    auto item = std::make_shared<SHAMapItem>(
+    auto item = make_pooled<SHAMapItem> (
         sle.getIndex());
     sle.add(item->peekSerializer());
     auto const success =
@@ -24,6 +24,7 @@
 #include <divvy/basics/Log.h>
 #include <divvy/core/Config.h>
 #include <divvy/core/JobQueue.h>
+#include <divvy/nodestore/ScopedUncachedReads.h>
 #include <divvy/protocol/Indexes.h>
 
 namespace divvy {
@@ -114,6 +115,7 @@ void OrderBookDB::update (Ledger::pointer ledger)
 
     try
     {
+        NodeStore::ScopedUncachedReads uncached;
         ledger->visitStateItems(std::bind(&updateHelper, std::placeholders::_1,
                                           std::ref(seen), std::ref(destMap),
             std::ref(sourceMap), std::ref(XDVBooks), std::ref(books)));
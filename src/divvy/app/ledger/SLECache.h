@@ -20,17 +20,29 @@
 #ifndef RIPPLE_APP_SLECACHE_H_INCLUDED
 #define RIPPLE_APP_SLECACHE_H_INCLUDED
 
-#include <divvy/basics/TaggedCache.h>
+#include <divvy/basics/ShardedTaggedCache.h>
 #include <divvy/protocol/STLedgerEntry.h>
 
 namespace divvy {
 
+/** Returns the approximate memory used by a ledger entry.
+    Each field is counted at the inline size of an STVar, larger
+    fields which allocate are underestimated.
+    @see cacheFootprint
+*/
+inline
+std::size_t
+cacheFootprint (STLedgerEntry const& sle)
+{
+    return sizeof (sle) + sle.getCount () * sizeof (detail::STVar);
+}
+
 /** STLedgerEntry cache.
     This maps keys to the deserialized ledger entries,
     to improve performance where the same item in
     the ledger is accessed often.
 */
-using SLECache = TaggedCache <uint256, STLedgerEntry>;
+using SLECache = ShardedTaggedCache <uint256, STLedgerEntry>;
 
 }
 
@@ -33,6 +33,7 @@
 #include <divvy/protocol/HashPrefix.h>
 #include <divvy/protocol/JsonFields.h>
 #include <divvy/nodestore/Database.h>
+#include <divvy/nodestore/ScopedReadPriority.h>
 
 namespace divvy {
 
@@ -55,8 +56,27 @@ enum
 
     // How many nodes to consider a fetch "small"
     ,fetchSmallNodes = 32
+
+    // Threads searching the state map for missing nodes
+    ,missingNodeThreads = 4
 };
 
+// How urgently the node store reads made for an acquire are needed
+static
+NodeStore::ReadPriority
+readPriority (InboundLedger::fcReason reason)
+{
+    switch (reason)
+    {
+    case InboundLedger::fcCONSENSUS:
+        return NodeStore::readCritical;
+    case InboundLedger::fcHISTORY:
+        return NodeStore::readBackground;
+    default:
+        return NodeStore::readAcquire;
+    }
+}
+
 InboundLedger::InboundLedger (uint256 const& hash, std::uint32_t seq, fcReason reason,
     clock_type& clock)
     : PeerSet (hash, ledgerAcquireTimeoutMillis, false, clock,
@@ -146,6 +166,7 @@ void InboundLedger::init (ScopedLockType& collectionLock)
 bool InboundLedger::tryLocal ()
 {
     // return value: true = no more work to do
+    NodeStore::ScopedReadPriority priority (readPriority (mReason));
 
     if (!mHaveHeader)
     {
@@ -387,6 +408,7 @@ bool InboundLedger::addOnComplete (
 void InboundLedger::trigger (Peer::ptr const& peer)
 {
     ScopedLockType sl (mLock);
+    NodeStore::ScopedReadPriority priority (readPriority (mReason));
 
     if (isDone ())
     {
@@ -537,23 +559,61 @@ void InboundLedger::trigger (Peer::ptr const& peer)
         }
         else
         {
-            std::vector<SHAMapNodeID> nodeIDs;
-            std::vector<uint256> nodeHashes;
-            // VFALCO Why 256? Make this a constant
-            nodeIDs.reserve (256);
-            nodeHashes.reserve (256);
             AccountStateSF filter;
+            bool sent = false;
 
-            // Release the lock while we process the large state map
+            // Release the lock while we search the large state map.
+            // Requests go out as the missing nodes are found, the
+            // lock is only held while each one is built and sent.
             sl.unlock();
-            mLedger->peekAccountStateMap ()->getMissingNodes (
-                nodeIDs, nodeHashes, 256, &filter);
+            // VFALCO Why 256? Make this a constant
+            auto const found = mLedger->peekAccountStateMap ()->getMissingNodes (
+                256, &filter, missingNodeThreads,
+                [&](std::vector<SHAMapNodeID> const& ids,
+                    std::vector<uint256> const& hashes)
+                {
+                    std::lock_guard <LockType> lock (mLock);
+                    if (mFailed || mComplete || mHaveState)
+                        return false;
+
+                    std::vector<SHAMapNodeID> nodeIDs (ids);
+                    std::vector<uint256> nodeHashes (hashes);
+
+                    // VFALCO Why 128? Make this a constant
+                    if (!mAggressive)
+                        filterNodes (nodeIDs, nodeHashes, 128, !isProgress ());
+
+                    if (nodeIDs.empty ())
+                        return true;
+
+                    protocol::TMGetLedger tmAS (tmGL);
+                    tmAS.set_itype (protocol::liAS_NODE);
+                    for (auto const& id : nodeIDs)
+                    {
+                        * (tmAS.add_nodeids ()) = id.getRawString ();
+                    }
+
+                    // If we're not querying for a lot of entries,
+                    // query extra deep
+                    if (nodeIDs.size() <= fetchSmallNodes)
+                        tmAS.set_querydepth (tmAS.querydepth() + 1);
+
+                    if (m_journal.trace) m_journal.trace <<
+                        "Sending AS node " << nodeIDs.size () <<
+                            " request to " << (
+                                peer ? "selected peer" : "all peers");
+                    if (nodeIDs.size () == 1 && m_journal.trace) m_journal.trace <<
+                        "AS node: " << nodeIDs[0];
+                    sendRequest (tmAS, peer);
+                    sent = true;
+                    return true;
+                });
             sl.lock();
 
             // Make sure nothing happened while we released the lock
             if (!mFailed && !mComplete && !mHaveState)
             {
-                if (nodeIDs.empty ())
+                if (found == 0)
                 {
                     if (!mLedger->peekAccountStateMap ()->isValid ())
                         mFailed = true;
@@ -565,37 +625,14 @@ void InboundLedger::trigger (Peer::ptr const& peer)
                             mComplete = true;
                     }
                 }
+                else if (sent)
+                {
+                    return;
+                }
                 else
                 {
-                    // VFALCO Why 128? Make this a constant
-                    if (!mAggressive)
-                        filterNodes (nodeIDs, nodeHashes, 128, !isProgress ());
-
-                    if (!nodeIDs.empty ())
-                    {
-                        tmGL.set_itype (protocol::liAS_NODE);
-                        for (auto const& id : nodeIDs)
-                        {
-                            * (tmGL.add_nodeids ()) = id.getRawString ();
-                        }
-
-                        // If we're not querying for a lot of entries,
-                        // query extra deep
-                        if (nodeIDs.size() <= fetchSmallNodes)
-                            tmGL.set_querydepth (tmGL.querydepth() + 1);
-
-                        if (m_journal.trace) m_journal.trace <<
-                            "Sending AS node " << nodeIDs.size () <<
-                                " request to " << (
-                                    peer ? "selected peer" : "all peers");
-                        if (nodeIDs.size () == 1 && m_journal.trace) m_journal.trace <<
-                            "AS node: " << nodeIDs[0];
-                        sendRequest (tmGL, peer);
-                        return;
-                    }
-                    else
-                        if (m_journal.trace) m_journal.trace <<
-                            "All AS nodes filtered";
+                    if (m_journal.trace) m_journal.trace <<
+                        "All AS nodes filtered";
                 }
             }
         }
@@ -981,6 +1018,7 @@ bool InboundLedger::takeTxRootNode (Blob const& data, SHAMapAddNode& san)
 std::vector<InboundLedger::neededHash_t> InboundLedger::getNeededHashes ()
 {
     std::vector<neededHash_t> ret;
+    NodeStore::ScopedReadPriority priority (readPriority (mReason));
 
     if (!mHaveHeader)
     {
@@ -1205,6 +1243,7 @@ Json::Value InboundLedger::getJson (int)
     Json::Value ret (Json::objectValue);
 
     ScopedLockType sl (mLock);
+    NodeStore::ScopedReadPriority priority (NodeStore::readBackground);
 
     ret[jss::hash] = to_string (mHash);
 
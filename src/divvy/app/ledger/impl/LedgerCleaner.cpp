@@ -24,6 +24,7 @@
 #include <divvy/app/ledger/impl/LedgerCleaner.h>
 #include <divvy/app/main/Application.h>
 #include <divvy/core/LoadFeeTrack.h>
+#include <divvy/nodestore/ScopedUncachedReads.h>
 #include <divvy/protocol/JsonFields.h>
 #include <divvy/protocol/Protocol.h>
 #include <divvy/protocol/DivvyLedgerHash.h>
@@ -306,7 +307,14 @@ public:
             doTxns = true;
         }
 
-        if (doNodes && !nodeLedger->walkLedger())
+        bool missingNodes = false;
+        if (doNodes)
+        {
+            NodeStore::ScopedUncachedReads uncached;
+            missingNodes = !nodeLedger->walkLedger();
+        }
+
+        if (missingNodes)
         {
             m_journal.debug << "Ledger " << ledgerIndex << " is missing nodes";
             getApp().getInboundLedgers().acquire(
@@ -947,7 +947,7 @@ private:
         newLCL->setClosed ();
 
         int asf = newLCL->peekAccountStateMap ()->flushDirty (
-            hotACCOUNT_NODE, newLCL->getLedgerSeq());
+            hotACCOUNT_NODE, newLCL->getLedgerSeq(), true);
         int tmf = newLCL->peekTransactionMap ()->flushDirty (
             hotTRANSACTION_NODE, newLCL->getLedgerSeq());
         WriteLog (lsDEBUG, LedgerConsensus) << "Flushed " << asf << " accounts and " <<
@@ -97,6 +97,9 @@ public:
     std::atomic <std::uint32_t> mValidLedgerSeq;
     std::atomic <std::uint32_t> mBuildingLedgerSeq;
 
+    // A node store sync job is queued or running
+    std::atomic <bool>          mSyncPending;
+
     // The server is in standalone mode
     bool const standalone_;
 
@@ -130,6 +133,7 @@ public:
         , mValidLedgerSign (0)
         , mValidLedgerSeq (0)
         , mBuildingLedgerSeq (0)
+        , mSyncPending (false)
         , standalone_ (config.RUN_STANDALONE)
         , fetch_depth_ (getApp ().getSHAMapStore ().clampFetchDepth (config.FETCH_DEPTH))
         , ledger_history_ (config.LEDGER_HISTORY)
@@ -232,6 +236,7 @@ public:
         getApp().getOPs().updateLocalTx (l);
         getApp().getSHAMapStore().onLedgerClosed (getValidatedLedger());
         mLedgerHistory.validatedLedger (l);
+        syncNodeStore ();
 
     #if RIPPLE_HOOK_VALIDATORS
         getApp().getValidators().onLedgerClosed (l->getLedgerSeq(),
@@ -239,6 +244,22 @@ public:
     #endif
     }
 
+    // A validated ledger is the durability point for backends which
+    // buffer writes in memory. Flushing can block, so do it on a job
+    // and coalesce validations which arrive while a flush is running.
+    void syncNodeStore ()
+    {
+        if (mSyncPending.exchange (true))
+            return;
+
+        getApp().getJobQueue ().addJob (jtWRITE, "NodeStore::sync",
+            [this] (Job&)
+            {
+                mSyncPending = false;
+                getApp().getNodeStore ().sync ();
+            });
+    }
+
     void setPubLedger(Ledger::ref l)
     {
         mPubLedger = l;
@@ -0,0 +1,169 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of divvyd: https://github.com/xdv/divvyd
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <divvy/app/ledger/FetchPackCache.h>
+#include <divvy/protocol/JsonFields.h>
+#include <beast/unit_test/suite.h>
+
+namespace divvy {
+namespace test {
+
+class FetchPackCache_test : public beast::unit_test::suite
+{
+    static
+    uint256
+    hashOf (int n)
+    {
+        uint256 hash;
+        hash = n;
+        return hash;
+    }
+
+    static
+    FetchPackCache::Segment
+    makeSegment (int objects, std::size_t size)
+    {
+        auto segment = std::make_shared <protocol::TMGetObjectByHash> ();
+        for (int i = 0; i < objects; ++i)
+        {
+            auto& obj = *segment->add_objects ();
+            obj.set_hash (hashOf (i).begin (), 256 / 8);
+            obj.set_data (std::string (size, 'x'));
+        }
+        return segment;
+    }
+
+public:
+    void testFetch ()
+    {
+        testcase ("fetch");
+
+        FetchPackCache cache (8, 1024 * 1024, beast::Journal ());
+        expect (! cache.inDemand ());
+
+        int builds = 0;
+        auto const build = [&]()
+        {
+            ++builds;
+            return makeSegment (4, 100);
+        };
+
+        auto const first = cache.fetch (hashOf (2), hashOf (1), build);
+        expect (first && first->objects_size () == 4);
+        expect (builds == 1);
+        expect (cache.inDemand ());
+        expect (cache.size () == 1);
+        expect (cache.bytes () == FetchPackCache::footprint (*first));
+
+        // The same pair is served from the cache
+        auto const second = cache.fetch (hashOf (2), hashOf (1), build);
+        expect (second == first);
+        expect (builds == 1);
+
+        // A pair sharing only one ledger is a different segment
+        cache.fetch (hashOf (3), hashOf (1), build);
+        expect (builds == 2);
+        expect (cache.find (hashOf (3), hashOf (1)) != nullptr);
+        expect (cache.find (hashOf (1), hashOf (3)) == nullptr);
+
+        // Prebuilding skips cached pairs
+        expect (! cache.prebuild (hashOf (2), hashOf (1), build));
+        expect (cache.prebuild (hashOf (4), hashOf (3), build));
+        expect (builds == 3);
+        cache.fetch (hashOf (4), hashOf (3), build);
+        expect (builds == 3);
+
+        // Failed builds are not cached
+        auto const none = cache.fetch (hashOf (5), hashOf (4),
+            []() { return FetchPackCache::Segment (); });
+        expect (! none);
+        expect (cache.size () == 3);
+
+        cache.onSent (8, 1000, std::chrono::milliseconds (4));
+        cache.onSent (4, 500, std::chrono::milliseconds (2));
+
+        Json::Value counts (Json::objectValue);
+        cache.getCounts (counts);
+        expect (counts[jss::fetch_pack_cache_size].asUInt () == 3);
+        expect (counts[jss::fetch_pack_hits].asUInt () == 2);
+        expect (counts[jss::fetch_pack_misses].asUInt () == 3);
+        expect (counts[jss::fetch_pack_prebuilt].asUInt () == 1);
+        expect (counts[jss::fetch_pack_sent].asUInt () == 2);
+        expect (counts[jss::fetch_pack_avg_objects].asUInt () == 6);
+        expect (counts[jss::fetch_pack_avg_bytes].asUInt () == 750);
+        expect (counts[jss::fetch_pack_max_bytes].asUInt () == 1000);
+        expect (counts[jss::fetch_pack_send_ms].asUInt () == 3);
+        expect (counts[jss::fetch_pack_send_ms_max].asUInt () == 4);
+        expect (counts.isMember (jss::fetch_pack_build_ms));
+    }
+
+    void testEviction ()
+    {
+        testcase ("eviction");
+
+        auto const segmentBytes =
+            FetchPackCache::footprint (*makeSegment (2, 1000));
+
+        // Bounded by count
+        {
+            FetchPackCache cache (3, 1024 * 1024, beast::Journal ());
+            auto const build = []() { return makeSegment (2, 1000); };
+            for (int i = 1; i <= 3; ++i)
+                cache.fetch (hashOf (i + 1), hashOf (i), build);
+
+            // Touch the oldest so the second one goes first
+            expect (cache.find (hashOf (2), hashOf (1)) != nullptr);
+            cache.fetch (hashOf (5), hashOf (4), build);
+
+            expect (cache.size () == 3);
+            expect (cache.find (hashOf (2), hashOf (1)) != nullptr);
+            expect (cache.find (hashOf (3), hashOf (2)) == nullptr);
+            expect (cache.find (hashOf (5), hashOf (4)) != nullptr);
+        }
+
+        // Bounded by bytes
+        {
+            FetchPackCache cache (100, 2 * segmentBytes, beast::Journal ());
+            auto const build = []() { return makeSegment (2, 1000); };
+            for (int i = 1; i <= 4; ++i)
+                cache.fetch (hashOf (i + 1), hashOf (i), build);
+            expect (cache.size () == 2);
+            expect (cache.bytes () == 2 * segmentBytes);
+
+            // Larger than the whole budget: served, not kept
+            auto const big = cache.fetch (hashOf (9), hashOf (8),
+                []() { return makeSegment (8, 1000); });
+            expect (big && big->objects_size () == 8);
+            expect (cache.find (hashOf (9), hashOf (8)) == nullptr);
+            expect (cache.size () == 2);
+        }
+    }
+
+    void run ()
+    {
+        testFetch ();
+        testEviction ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE (FetchPackCache, ledger, divvy);
+
+}  // test
+}  // divvy
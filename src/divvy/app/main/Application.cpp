@@ -45,6 +45,7 @@
 #include <divvy/app/tx/TransactionMaster.h>
 #include <divvy/basics/Log.h>
 #include <divvy/basics/ResolverAsio.h>
+#include <divvy/basics/SlabAllocator.h>
 #include <divvy/basics/Sustain.h>
 #include <divvy/basics/seconds_clock.h>
 #include <divvy/json/json_reader.h>
@@ -54,7 +55,9 @@
 #include <divvy/net/SNTPClient.h>
 #include <divvy/nodestore/Database.h>
 #include <divvy/nodestore/DummyScheduler.h>
+#include <divvy/nodestore/HotKeys.h>
 #include <divvy/nodestore/Manager.h>
+#include <divvy/nodestore/impl/Tuning.h>
 #include <divvy/overlay/make_Overlay.h>
 #include <divvy/protocol/Indexes.h>
 #include <divvy/protocol/STParsedJSON.h>
@@ -69,6 +72,8 @@
 #include <beast/module/core/text/LexicalCast.h>
 #include <beast/module/core/thread/DeadlineTimer.h>
 #include <boost/asio/signal_set.hpp>
+#include <boost/filesystem.hpp>
+#include <chrono>
 #include <fstream>
 
 namespace divvy {
@@ -127,6 +132,7 @@ public:
                 fullBelowTargetSize, fullBelowExpirationSeconds)
         , db_ (db)
     {
+        treecache_.setAdmission (true);
     }
 
     FullBelowCache&
@@ -647,6 +653,8 @@ public:
                 TxnDBInit, TxnDBCount);
         mLedgerDB = std::make_unique <DatabaseCon> (setup, "ledger.db",
                 LedgerDBInit, LedgerDBCount);
+        // The wallet database sees little query traffic
+        setup.readers = 0;
         mWalletDB = std::make_unique <DatabaseCon> (setup, "wallet.db",
                 WalletDBInit, WalletDBCount);
 
@@ -715,13 +723,13 @@ public:
             exitWithCode(3);
         }
 
-        getApp ().getLedgerDB ().getSession ()
-            << boost::str (boost::format ("PRAGMA cache_size=-%d;") %
-                           (getConfig ().getSize (siLgrDBCache) * 1024));
+        getApp ().getLedgerDB ().pragma (
+            boost::str (boost::format ("PRAGMA cache_size=-%d;") %
+                        (getConfig ().getSize (siLgrDBCache) * 1024)));
 
-        getApp().getTxnDB ().getSession ()
-                << boost::str (boost::format ("PRAGMA cache_size=-%d;") %
-                               (getConfig ().getSize (siTxnDBCache) * 1024));
+        getApp().getTxnDB ().pragma (
+            boost::str (boost::format ("PRAGMA cache_size=-%d;") %
+                        (getConfig ().getSize (siTxnDBCache) * 1024)));
 
         mTxnDB->setupCheckpointing (m_jobQueue.get());
         mLedgerDB->setupCheckpointing (m_jobQueue.get());
@@ -790,6 +798,23 @@ public:
         family().treecache().setTargetSize (getConfig ().getSize (siTreeCacheSize));
         family().treecache().setTargetAge (getConfig ().getSize (siTreeCacheAge));
 
+        {
+            // Optional memory budgets, in megabytes
+            auto const& section = getConfig ().section (SECTION_CACHE_MB);
+            std::size_t mb = 0;
+            if (get_if_exists (section, "node", mb))
+                m_nodeStore->tuneBytes (mb << 20);
+            if (get_if_exists (section, "tree", mb))
+                family().treecache().setTargetBytes (mb << 20);
+            if (get_if_exists (section, "sle", mb))
+                m_sleCache.setTargetBytes (mb << 20);
+            if (get_if_exists (section, "fullbelow", mb))
+                family().fullbelow().setTargetBytes (mb << 20);
+        }
+
+        // Warm the caches before taking part in consensus
+        loadHotKeys ();
+
         //----------------------------------------------------------------------
         //
         // Server
@@ -904,6 +929,8 @@ public:
 
         m_overlay->saveValidatorKeyManifests (getWalletDB ());
 
+        saveHotKeys ();
+
         DivvyAddress::clearCache ();
         stopped ();
     }
@@ -1012,6 +1039,11 @@ public:
         family().treecache().sweep();
         getOPs().sweepFetchPack();
 
+        // Slabs emptied by the sweeps above go back to the heap
+        auto const trimmed = SlabPool::trimAll ();
+        if (trimmed != 0 && m_journal.debug) m_journal.debug <<
+            "Released " << trimmed << " bytes of pooled memory";
+
         // VFALCO NOTE does the call to sweep() happen on another thread?
         m_sweepTimer.setExpiration (getConfig ().getSize (siSweepInterval));
     }
@@ -1024,6 +1056,11 @@ private:
     bool loadOldLedger (
         std::string const& ledgerID, bool replay, bool isFilename);
 
+    // Keys prefetched at startup, saved at clean shutdown
+    std::string hotKeysPath () const;
+    void loadHotKeys ();
+    void saveHotKeys ();
+
     void onAnnounceAddress ();
 };
 
@@ -1544,6 +1581,64 @@ void ApplicationImp::updateTables ()
     }
 }
 
+std::string ApplicationImp::hotKeysPath () const
+{
+    int enabled = 1;
+    get_if_exists (getConfig ().section (ConfigSection::nodeDatabase ()),
+        "hot_keys", enabled);
+
+    std::string const dbPath = getConfig ().legacy ("database_path");
+    if (! enabled || dbPath.empty ())
+        return std::string ();
+
+    return (boost::filesystem::path (dbPath) / "hotkeys").string ();
+}
+
+void ApplicationImp::loadHotKeys ()
+{
+    auto const path = hotKeysPath ();
+    if (path.empty ())
+        return;
+
+    auto const keys = NodeStore::loadHotKeys (path);
+    if (keys.empty ())
+        return;
+
+    auto const start = std::chrono::steady_clock::now ();
+    auto const reads = NodeStore::prefetchHotKeys (*m_nodeStore, keys);
+
+    m_journal.info << "Prefetched " << reads << " of " << keys.size () <<
+        " hot keys in " << std::chrono::duration_cast <
+            std::chrono::milliseconds> (std::chrono::steady_clock::now () -
+                start).count () << "ms";
+}
+
+void ApplicationImp::saveHotKeys ()
+{
+    auto const path = hotKeysPath ();
+    if (path.empty ())
+        return;
+
+    // The top of the state map first, it is needed by every ledger
+    std::vector <uint256> keys;
+    try
+    {
+        if (auto const ledger = m_ledgerMaster->getClosedLedger ())
+            keys = ledger->peekAccountStateMap ()->getTopHashes (
+                NodeStore::hotKeysStateDepth);
+    }
+    catch (std::exception const& e)
+    {
+        m_journal.warning << "Hot keys without state map: " << e.what ();
+    }
+
+    auto const cached = m_nodeStore->getCacheKeys ();
+    keys.insert (keys.end (), cached.begin (), cached.end ());
+
+    if (! NodeStore::saveHotKeys (path, keys))
+        m_journal.warning << "Unable to save hot keys to " << path;
+}
+
 void ApplicationImp::onAnnounceAddress ()
 {
     // NIKB CODEME
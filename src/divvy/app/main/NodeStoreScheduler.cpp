@@ -66,7 +66,7 @@ void NodeStoreScheduler::onFetch (NodeStore::FetchReport const& report)
     if (report.wentToDisk)
         m_jobQueue->addLoadEvents (
             report.isAsync ? jtNS_ASYNC_READ : jtNS_SYNC_READ,
-                1, report.elapsed);
+                report.fetchCount, report.elapsed);
 }
 
 void NodeStoreScheduler::onBatchWrite (NodeStore::BatchWriteReport const& report)
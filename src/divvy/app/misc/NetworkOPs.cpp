@@ -24,6 +24,7 @@
 #include <divvy/app/main/Application.h>
 #include <divvy/app/misc/FeeVote.h>
 #include <divvy/app/ledger/AcceptedLedger.h>
+#include <divvy/app/ledger/FetchPackCache.h>
 #include <divvy/app/ledger/InboundLedger.h>
 #include <divvy/app/ledger/InboundLedgers.h>
 #include <divvy/app/ledger/LedgerMaster.h>
@@ -64,6 +65,7 @@
 #include <beast/cxx14/memory.h> // <memory>
 #include <beast/utility/make_lock.h>
 #include <boost/optional.hpp>
+#include <chrono>
 #include <tuple>
 #include <condition_variable>
 
@@ -137,6 +139,8 @@ public:
         , mFetchPack ("FetchPack", 65536, 45, clock,
             deprecatedLogs().journal("TaggedCache"))
         , mFetchSeq (0)
+        , mFetchPackCache (fetchPackSegments, fetchPackBytes,
+            deprecatedLogs().journal("FetchPackCache"))
         , mLastLoadBase (256)
         , mLastLoadFactor (256)
         , m_job_queue (job_queue)
@@ -350,6 +354,19 @@ public:
     int getFetchSize () override;
     void sweepFetchPack () override;
 
+    FetchPackCache& getFetchPackCache () override
+    {
+        return mFetchPackCache;
+    }
+
+private:
+    FetchPackCache::Segment makeFetchPackSegment (
+        Ledger::ref haveLedger, Ledger::ref wantLedger);
+
+    void prebuildFetchPack (Job&, Ledger::pointer haveLedger);
+
+public:
+
     // Network state machine.
 
     // VFALCO TODO Try to make all these private since they seem to be...private
@@ -637,6 +654,14 @@ private:
     TaggedCache<uint256, Blob>  mFetchPack;
     std::uint32_t mFetchSeq;
 
+    // Segments of fetch packs we serve to peers
+    enum
+    {
+        fetchPackSegments = 256,
+        fetchPackBytes = 256 * 1024 * 1024
+    };
+    FetchPackCache mFetchPackCache;
+
     std::uint32_t mLastLoadBase;
     std::uint32_t mLastLoadFactor;
 
@@ -1920,15 +1945,22 @@ NetworkOPsImp::transactionsSQL (
             % beast::lexicalCastThrow <std::string> (numberOfResults)
         );
     else
+        // The offset is applied in a subquery that only reads the covering
+        // AcctTxIndex, so the skipped rows never touch the Transactions
+        // table. Only the page that survives is joined for its blobs.
         sql =
             boost::str (boost::format (
                 "SELECT %s FROM "
-                "AccountTransactions INNER JOIN Transactions "
-                "ON Transactions.TransID = AccountTransactions.TransID "
+                "(SELECT LedgerSeq, TxnSeq, TransID "
+                "FROM AccountTransactions INDEXED BY AcctTxIndex "
                 "WHERE Account = '%s' %s %s "
                 "ORDER BY AccountTransactions.LedgerSeq %s, "
                 "AccountTransactions.TxnSeq %s, AccountTransactions.TransID %s "
-                "LIMIT %u, %u;")
+                "LIMIT %u, %u) AS AccountTransactions "
+                "INNER JOIN Transactions "
+                "ON Transactions.TransID = AccountTransactions.TransID "
+                "ORDER BY AccountTransactions.LedgerSeq %s, "
+                "AccountTransactions.TxnSeq %s, AccountTransactions.TransID %s;")
                     % selection
                     % account.humanAccountID ()
                     % maxClause
@@ -1938,6 +1970,9 @@ NetworkOPsImp::transactionsSQL (
                     % (descending ? "DESC" : "ASC")
                     % beast::lexicalCastThrow <std::string> (offset)
                     % beast::lexicalCastThrow <std::string> (numberOfResults)
+                    % (descending ? "DESC" : "ASC")
+                    % (descending ? "DESC" : "ASC")
+                    % (descending ? "DESC" : "ASC")
                    );
     m_journal.trace << "txSQL query: " << sql;
     return sql;
@@ -1956,7 +1991,7 @@ NetworkOPs::AccountTxs NetworkOPsImp::getAccountTxs (
         minLedger, maxLedger, descending, offset, limit, false, false, bAdmin);
 
     {
-        auto db = getApp().getTxnDB ().checkoutDb ();
+        auto db = getApp().getTxnDB ().checkoutReadDb ();
 
         boost::optional<std::uint64_t> ledgerSeq;
         boost::optional<std::string> status;
@@ -2020,7 +2055,7 @@ std::vector<NetworkOPsImp::txnMetaLedgerType> NetworkOPsImp::getAccountTxsB (
         bAdmin);
 
     {
-        auto db = getApp().getTxnDB ().checkoutDb ();
+        auto db = getApp().getTxnDB ().checkoutReadDb ();
 
         boost::optional<std::uint64_t> ledgerSeq;
         boost::optional<std::string> status;
@@ -2114,7 +2149,7 @@ NetworkOPsImp::getLedgerAffectedAccounts (std::uint32_t ledgerSeq)
                            % ledgerSeq);
     DivvyAddress acct;
     {
-        auto db = getApp().getTxnDB ().checkoutDb ();
+        auto db = getApp().getTxnDB ().checkoutReadDb ();
         soci::blob accountBlob(*db);
         soci::indicator bi;
         soci::statement st = (db->prepare << sql, soci::into(accountBlob, bi));
@@ -2391,6 +2426,16 @@ void NetworkOPsImp::pubLedger (Ledger::ref accepted)
     auto alpAccepted = AcceptedLedger::makeAcceptedLedger (accepted);
     Ledger::ref lpAccepted = alpAccepted->getLedger ();
 
+    // Peers catching up ask for the newest validated ledgers first,
+    // have their fetch pack ready before they ask.
+    if (mFetchPackCache.inDemand () &&
+        (m_job_queue.getJobCount (jtPACK) == 0))
+    {
+        m_job_queue.addJob (jtPACK, "prebuildFetchPack",
+            std::bind (&NetworkOPsImp::prebuildFetchPack, this,
+                std::placeholders::_1, lpAccepted));
+    }
+
     {
         ScopedLockType sl (mSubLock);
 
@@ -3335,6 +3380,8 @@ void NetworkOPsImp::makeFetchPack (
 
     try
     {
+        auto const start = std::chrono::steady_clock::now ();
+
         protocol::TMGetObjectByHash reply;
         reply.set_query (false);
 
@@ -3345,36 +3392,23 @@ void NetworkOPsImp::makeFetchPack (
         reply.set_type (protocol::TMGetObjectByHash::otFETCH_PACK);
 
         // Building a fetch pack:
-        //  1. Add the header for the requested ledger.
-        //  2. Add the nodes for the AccountStateMap of that ledger.
-        //  3. If there are transactions, add the nodes for the
-        //     transactions of the ledger.
-        //  4. If the FetchPack now contains greater than or equal to
-        //     256 entries then stop.
-        //  5. If not very much time has elapsed, then loop back and repeat
+        //  1. Add the segment for the requested ledger and its parent.
+        //     Segments are cached, peers catching up from nearby
+        //     ledgers share them.
+        //  2. If the FetchPack now contains greater than or equal to
+        //     512 entries then stop.
+        //  3. If not very much time has elapsed, then loop back and repeat
         //     the same process adding the previous ledger to the FetchPack.
         do
         {
-            std::uint32_t lSeq = wantLedger->getLedgerSeq ();
-
-            protocol::TMIndexedObject& newObj = *reply.add_objects ();
-            newObj.set_hash (wantLedger->getHash ().begin (), 256 / 8);
-            Serializer s (256);
-            s.add32 (HashPrefix::ledgerMaster);
-            wantLedger->addRaw (s);
-            newObj.set_data (s.getDataPtr (), s.getLength ());
-            newObj.set_ledgerseq (lSeq);
-
-            wantLedger->peekAccountStateMap ()->getFetchPack
-                (haveLedger->peekAccountStateMap ().get (), true, 16384,
-                    std::bind (fpAppender, &reply, lSeq, std::placeholders::_1,
-                               std::placeholders::_2));
-
-            if (wantLedger->getTransHash ().isNonZero ())
-                wantLedger->peekTransactionMap ()->getFetchPack (
-                    nullptr, true, 512,
-                    std::bind (fpAppender, &reply, lSeq, std::placeholders::_1,
-                               std::placeholders::_2));
+            auto const segment = mFetchPackCache.fetch (
+                haveLedger->getHash (), wantLedger->getHash (),
+                [&]()
+                {
+                    return makeFetchPackSegment (haveLedger, wantLedger);
+                });
+
+            reply.mutable_objects ()->MergeFrom (segment->objects ());
 
             if (reply.objects ().size () >= 512)
                 break;
@@ -3390,6 +3424,11 @@ void NetworkOPsImp::makeFetchPack (
             << "Built fetch pack with " << reply.objects ().size () << " nodes";
         auto msg = std::make_shared<Message> (reply, protocol::mtGET_OBJECTS);
         peer->send (msg);
+
+        mFetchPackCache.onSent (reply.objects ().size (),
+            msg->getBuffer ().size (),
+            std::chrono::duration_cast <std::chrono::milliseconds> (
+                std::chrono::steady_clock::now () - start));
     }
     catch (...)
     {
@@ -3397,6 +3436,65 @@ void NetworkOPsImp::makeFetchPack (
     }
 }
 
+FetchPackCache::Segment NetworkOPsImp::makeFetchPackSegment (
+    Ledger::ref haveLedger, Ledger::ref wantLedger)
+{
+    // A segment holds:
+    //  1. The header for the wanted ledger.
+    //  2. The nodes for the AccountStateMap of that ledger that
+    //     differ from the ledger the peer has.
+    //  3. If there are transactions, the nodes for the
+    //     transactions of the ledger.
+    auto segment = std::make_shared <protocol::TMGetObjectByHash> ();
+    std::uint32_t lSeq = wantLedger->getLedgerSeq ();
+
+    protocol::TMIndexedObject& newObj = *segment->add_objects ();
+    newObj.set_hash (wantLedger->getHash ().begin (), 256 / 8);
+    Serializer s (256);
+    s.add32 (HashPrefix::ledgerMaster);
+    wantLedger->addRaw (s);
+    newObj.set_data (s.getDataPtr (), s.getLength ());
+    newObj.set_ledgerseq (lSeq);
+
+    wantLedger->peekAccountStateMap ()->getFetchPack
+        (haveLedger->peekAccountStateMap ().get (), true, 16384,
+            std::bind (fpAppender, segment.get (), lSeq, std::placeholders::_1,
+                       std::placeholders::_2));
+
+    if (wantLedger->getTransHash ().isNonZero ())
+        wantLedger->peekTransactionMap ()->getFetchPack (
+            nullptr, true, 512,
+            std::bind (fpAppender, segment.get (), lSeq, std::placeholders::_1,
+                       std::placeholders::_2));
+
+    return segment;
+}
+
+void NetworkOPsImp::prebuildFetchPack (Job&, Ledger::pointer haveLedger)
+{
+    if (getApp().getFeeTrack ().isLoadedLocal ())
+        return;
+
+    Ledger::pointer wantLedger = getLedgerByHash (haveLedger->getParentHash ());
+
+    if (!wantLedger)
+        return;
+
+    try
+    {
+        mFetchPackCache.prebuild (
+            haveLedger->getHash (), wantLedger->getHash (),
+            [&]()
+            {
+                return makeFetchPackSegment (haveLedger, wantLedger);
+            });
+    }
+    catch (...)
+    {
+        m_journal.warning << "Exception prebuilding fetch pack";
+    }
+}
+
 void NetworkOPsImp::sweepFetchPack ()
 {
     mFetchPack.sweep ();
@@ -39,6 +39,7 @@ namespace divvy {
 // Master operational handler, server sequencer, network tracker
 
 class Peer;
+class FetchPackCache;
 class LedgerConsensus;
 class LedgerMaster;
 
@@ -236,6 +237,9 @@ public:
     virtual int getFetchSize () = 0;
     virtual void sweepFetchPack () = 0;
 
+    /** Fetch pack segments built for peers. */
+    virtual FetchPackCache& getFetchPackCache () = 0;
+
     // network state machine
     virtual void endConsensus (bool correctLCL) = 0;
     virtual void setStandAlone () = 0;
@@ -48,6 +48,8 @@ public:
         std::uint32_t deleteBatch = 100;
         std::uint32_t backOff = 100;
         std::int32_t ageThreshold = 60;
+        std::uint32_t copyThreads = 4;
+        std::uint32_t copyBatch = 256;
     };
 
     SHAMapStore (Stoppable& parent) : Stoppable ("SHAMapStore", parent) {}
@@ -23,6 +23,10 @@
 #include <divvy/app/ledger/LedgerMaster.h>
 #include <divvy/app/main/Application.h>
 #include <divvy/core/ConfigSections.h>
+#include <divvy/nodestore/ScopedUncachedReads.h>
+#include <divvy/protocol/HashPrefix.h>
+#include <divvy/shamap/SHAMapMissingNode.h>
+#include <divvy/shamap/SHAMapTreeNode.h>
 #include <boost/format.hpp>
 #include <beast/cxx14/memory.h> // <memory>
 #include <boost/format.hpp>
@@ -243,19 +247,123 @@ SHAMapStoreImp::onLedgerClosed (Ledger::pointer validatedLedger)
     cond_.notify_one();
 }
 
+// Add the children of a stored inner node to the hashes still to copy.
+// Leaves have nothing below them, so they are never decoded.
+static void
+pushChildren (NodeObject const& object, std::vector <uint256>& pending)
+{
+    auto const& data = object.getData();
+    if (data.size() < 4 || ((std::uint32_t (data[0]) << 24) |
+            (std::uint32_t (data[1]) << 16) | (std::uint32_t (data[2]) << 8) |
+                std::uint32_t (data[3])) != HashPrefix::innerNode)
+        return;
+
+    auto const node = SHAMapAbstractNode::make (
+        data, 0, snfPREFIX, object.getHash(), true);
+    if (!node || !node->isInner())
+        return;
+
+    auto const& inner = static_cast <SHAMapInnerNode const&> (*node);
+    for (int branch = 0; branch < 16; ++branch)
+        if (!inner.isEmptyBranch (branch))
+            pending.push_back (inner.getChildHash (branch));
+}
+
+std::uint64_t
+SHAMapStoreImp::copyState (SHAMap const& map)
+{
+    std::atomic <std::uint64_t> nodeCount (0);
+    std::atomic <std::size_t> nextBranch (0);
+    std::atomic <bool> stop (false);
+    std::exception_ptr error;
+    std::mutex errorMutex;
+
+    std::vector <uint256> branches;
+    {
+        auto const root = database_->fetchNode (map.getHash());
+        if (!root)
+            throw SHAMapMissingNode (SHAMapType::STATE, map.getHash());
+        pushChildren (*root, branches);
+        ++nodeCount;
+    }
+
+    auto work = [&]
+    {
+        try
+        {
+            // Each node is visited once, keep the caches for consensus
+            NodeStore::ScopedUncachedReads uncached;
+
+            // Walked depth first, so this holds at most a few
+            // batches' worth of children per level of the map.
+            std::vector <uint256> pending;
+
+            for (auto branch = nextBranch++; branch < branches.size() &&
+                    !stop; branch = nextBranch++)
+            {
+                pending.push_back (branches[branch]);
+                while (!pending.empty() && !stop)
+                {
+                    if (copyBatch (pending, nodeCount))
+                        stop = true;
+                }
+            }
+        }
+        catch (...)
+        {
+            std::lock_guard <std::mutex> lock (errorMutex);
+            if (!error)
+                error = std::current_exception();
+            stop = true;
+        }
+    };
+
+    // This thread is one of the workers
+    std::vector <std::thread> workers;
+    for (std::uint32_t i = 1; i < setup_.copyThreads; ++i)
+        workers.emplace_back (work);
+    work();
+    for (auto& worker : workers)
+        worker.join();
+
+    if (error)
+        std::rethrow_exception (error);
+
+    return nodeCount;
+}
+
 bool
-SHAMapStoreImp::copyNode (std::uint64_t& nodeCount,
-        SHAMapAbstractNode const& node)
+SHAMapStoreImp::copyBatch (std::vector <uint256>& pending,
+        std::atomic <std::uint64_t>& nodeCount)
 {
-    // Copy a single record from node to database_
-    database_->fetchNode (node.getNodeHash());
-    if (! (++nodeCount % checkHealthInterval_))
+    auto const n = std::min <std::size_t> (pending.size(), setup_.copyBatch);
+    std::vector <uint256> const hashes (pending.end() - n, pending.end());
+    pending.resize (pending.size() - n);
+
+    // Fetching from the archive stores into the writable backend. The
+    // nodes read are the only source of the children to copy next, so
+    // every node is read exactly once.
+    auto const objects = database_->fetchNodes (hashes);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        if (!objects[i])
+            throw SHAMapMissingNode (SHAMapType::STATE, hashes[i]);
+        pushChildren (*objects[i], pending);
+    }
+    nodeCount += n;
+
+    // Yield to consensus while the backend falls behind on writes
+    // or jobs are waiting longer than their latency targets.
+    while (database_->getWritableBackend()->getWriteLoad() > maxCopyWriteLoad_
+            || jobQueue_->isOverloaded())
     {
         if (health())
             return true;
+        std::this_thread::sleep_for (
+                std::chrono::milliseconds (setup_.backOff));
     }
 
-    return false;
+    return health() != Health::ok;
 }
 
 void
@@ -268,6 +376,7 @@ SHAMapStoreImp::run()
     treeNodeCache_ = &getApp().family().treecache();
     transactionDb_ = &getApp().getTxnDB();
     ledgerDb_ = &getApp().getLedgerDB();
+    jobQueue_ = &getApp().getJobQueue();
 
     if (setup_.advisoryDelete)
         canDelete_ = state_db_.getCanDelete ();
@@ -330,11 +439,8 @@ SHAMapStoreImp::run()
                     ;
             }
 
-            std::uint64_t nodeCount = 0;
-            validatedLedger_->peekAccountStateMap()->snapShot (
-                    false)->visitNodes (
-                    std::bind (&SHAMapStoreImp::copyNode, this,
-                    std::ref(nodeCount), std::placeholders::_1));
+            std::uint64_t const nodeCount = copyState (
+                    *validatedLedger_->peekAccountStateMap()->snapShot (false));
             journal_.debug << "copied ledger " << validatedSeq
                     << " nodecount " << nodeCount;
             switch (health())
@@ -678,6 +784,12 @@ setup_SHAMapStore (Config const& c)
     get_if_exists (sec, "delete_batch", setup.deleteBatch);
     get_if_exists (sec, "backOff", setup.backOff);
     get_if_exists (sec, "age_threshold", setup.ageThreshold);
+    get_if_exists (sec, "copy_threads", setup.copyThreads);
+    get_if_exists (sec, "copy_batch", setup.copyBatch);
+
+    // The copy is split by root branch
+    setup.copyThreads = std::max (1u, std::min (setup.copyThreads, 16u));
+    setup.copyBatch = std::max (1u, setup.copyBatch);
 
     return setup;
 }
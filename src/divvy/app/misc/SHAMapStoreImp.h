@@ -21,11 +21,13 @@
 #define RIPPLE_APP_MISC_SHAMAPSTOREIMP_H_INCLUDED
 
 #include <divvy/core/DatabaseCon.h>
+#include <divvy/core/JobQueue.h>
 #include <divvy/app/misc/SHAMapStore.h>
 #include <divvy/app/misc/NetworkOPs.h>
 #include <divvy/core/SociDB.h>
 #include <divvy/nodestore/impl/Tuning.h>
 #include <divvy/nodestore/DatabaseRotating.h>
+#include <atomic>
 #include <iostream>
 #include <condition_variable>
 #include <thread>
@@ -77,6 +79,8 @@ private:
     std::string const dbPrefix_ = "divvydb";
     // check health/stop status as records are copied
     std::uint64_t const checkHealthInterval_ = 1000;
+    // pause copying while the writable backend has more writes pending
+    std::int32_t const maxCopyWriteLoad_ = 4096;
     // minimum # of ledgers to maintain for health of network
     std::uint32_t minimumDeletionInterval_ = 256;
 
@@ -88,7 +92,7 @@ private:
     SavedStateDB state_db_;
     std::thread thread_;
     bool stop_ = false;
-    bool healthy_ = true;
+    std::atomic <bool> healthy_ {true};
     mutable std::condition_variable cond_;
     mutable std::mutex mutex_;
     Ledger::pointer newLedger_;
@@ -103,6 +107,7 @@ private:
     TreeNodeCache* treeNodeCache_ = nullptr;
     DatabaseCon* transactionDb_ = nullptr;
     DatabaseCon* ledgerDb_ = nullptr;
+    JobQueue* jobQueue_ = nullptr;
 
 public:
     SHAMapStoreImp (Setup const& setup,
@@ -158,8 +163,17 @@ public:
     void onLedgerClosed (Ledger::pointer validatedLedger) override;
 
 private:
-    // callback for visitNodes
-    bool copyNode (std::uint64_t& nodeCount, SHAMapAbstractNode const &node);
+    /** Copy every node of a state map into the writable backend.
+        The root's branches are handed out to a pool of threads, each of
+        which fetches and stores its nodes in batches. The children of
+        each batch are found from the inner nodes it read.
+        @return The number of nodes copied.
+    */
+    std::uint64_t copyState (SHAMap const& map);
+    // copy the last batch of pending hashes and queue their children,
+    // return true if copying should stop
+    bool copyBatch (std::vector <uint256>& pending,
+        std::atomic <std::uint64_t>& nodeCount);
     void run();
     void dbPaths();
     std::shared_ptr <NodeStore::Backend> makeBackendRotating (
@@ -112,12 +112,19 @@ accountTxPage (
     // we need to clear it in between.
     token = Json::nullValue;
 
+    // The marker is the first row of the page. Rather than skipping the
+    // rows before it, the query seeks straight to it: the LedgerSeq range
+    // starts at the marker's ledger, so SQLite walks AcctTxIndex from
+    // there in index order, and the TxnSeq test only trims the rows of
+    // that one ledger which sort before the marker. Every page costs the
+    // same however deep into the history it is.
     static std::string const prefix (
         R"(SELECT AccountTransactions.LedgerSeq,AccountTransactions.TxnSeq,
           Status,RawTxn,TxnMeta
-          FROM AccountTransactions INNER JOIN Transactions
+          FROM AccountTransactions INDEXED BY AcctTxIndex
+          INNER JOIN Transactions
           ON Transactions.TransID = AccountTransactions.TransID
-          AND AccountTransactions.Account = '%s' WHERE
+          WHERE AccountTransactions.Account = '%s' AND
           )");
 
     std::string sql;
@@ -141,20 +148,18 @@ accountTxPage (
     {
         sql = boost::str (boost::format(
             prefix +
-            (R"(
-            AccountTransactions.LedgerSeq BETWEEN '%u' AND '%u' OR
-            ( AccountTransactions.LedgerSeq = '%u' AND
-              AccountTransactions.TxnSeq >= '%u' )
-            ORDER BY AccountTransactions.LedgerSeq ASC,
-            AccountTransactions.TxnSeq ASC
-            LIMIT %u;
-            )"))
-        % account.humanAccountID()
-        % (findLedger + 1)
-        % maxLedger
-        % findLedger
-        % findSeq
-        % queryLimit);
+            (R"(AccountTransactions.LedgerSeq BETWEEN '%u' AND '%u' AND
+             ( AccountTransactions.LedgerSeq > '%u' OR
+               AccountTransactions.TxnSeq >= '%u' )
+             ORDER BY AccountTransactions.LedgerSeq ASC,
+             AccountTransactions.TxnSeq ASC
+             LIMIT %u;)"))
+            % account.humanAccountID()
+            % findLedger
+            % maxLedger
+            % findLedger
+            % findSeq
+            % queryLimit);
     }
     else if (!forward && (findLedger == 0))
     {
@@ -173,15 +178,15 @@ accountTxPage (
     {
         sql = boost::str (boost::format(
             prefix +
-            (R"(AccountTransactions.LedgerSeq BETWEEN '%u' AND '%u' OR
-             (AccountTransactions.LedgerSeq = '%u' AND
-              AccountTransactions.TxnSeq <= '%u')
+            (R"(AccountTransactions.LedgerSeq BETWEEN '%u' AND '%u' AND
+             ( AccountTransactions.LedgerSeq < '%u' OR
+               AccountTransactions.TxnSeq <= '%u' )
              ORDER BY AccountTransactions.LedgerSeq DESC,
              AccountTransactions.TxnSeq DESC
              LIMIT %u;)"))
             % account.humanAccountID()
             % minLedger
-            % (findLedger - 1)
+            % findLedger
             % findLedger
             % findSeq
             % queryLimit);
@@ -194,7 +199,7 @@ accountTxPage (
     }
 
     {
-        auto db (connection.checkoutDb());
+        auto db (connection.checkoutReadDb());
 
         Blob rawData;
         Blob rawMeta;
@@ -19,7 +19,9 @@
 #include <divvy/core/DatabaseCon.h>
 #include <divvy/app/misc/impl/AccountTxPaging.h>
 #include <beast/cxx14/memory.h>  // <memory>
+#include <beast/module/core/diagnostic/UnitTestUtilities.h>
 #include <beast/unit_test/suite.h>
+#include <boost/filesystem.hpp>
 #include <cstdlib>
 #include <vector>
 
@@ -45,8 +47,18 @@ struct AccountTxPaging_test : beast::unit_test::suite
             return;
         }
 
+        // Work on a copy, since opening the database
+        // leaves journal files next to it.
+        beast::UnitTestUtilities::TempDirectory dir ("account_tx");
+        boost::filesystem::path const folder (
+            dir.getFullPathName ().toStdString ());
+        boost::filesystem::create_directories (folder);
+        boost::filesystem::copy_file (
+            boost::filesystem::path (data_path) / "account-tx-transactions.db",
+            folder / "account-tx-transactions.db");
+
         DatabaseCon::Setup dbConf;
-        dbConf.dataDir = data_path + "/";
+        dbConf.dataDir = folder.string () + "/";
 
         db_ = std::make_unique <DatabaseCon> (
             dbConf, "account-tx-transactions.db", nullptr, 0);
@@ -54,6 +66,8 @@ struct AccountTxPaging_test : beast::unit_test::suite
         account_.setAccountID("rfu6L5p3azwPzQZsbTafuVk884N9YoKvVG");
 
         testAccountTxPaging();
+
+        db_.reset ();
     }
 
     void
@@ -151,7 +151,7 @@ Transaction::pointer Transaction::load (uint256 const& id)
     boost::optional<std::string> status;
     Blob rawTxn;
     {
-        auto db = getApp().getTxnDB ().checkoutDb ();
+        auto db = getApp().getTxnDB ().checkoutReadDb ();
         soci::blob sociRawTxnBlob (*db);
         soci::indicator rti;
 
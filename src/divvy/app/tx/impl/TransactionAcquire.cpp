@@ -24,6 +24,7 @@
 #include <divvy/app/misc/NetworkOPs.h>
 #include <divvy/app/tx/TransactionAcquire.h>
 #include <divvy/app/tx/InboundTransactions.h>
+#include <divvy/nodestore/ScopedReadPriority.h>
 #include <divvy/overlay/Overlay.h>
 #include <beast/utility/make_lock.h>
 #include <memory>
@@ -143,6 +144,8 @@ void TransactionAcquire::trigger (Peer::ptr const& peer)
         std::vector<uint256> nodeHashes;
         // VFALCO TODO Use a dependency injection on the temp node cache
         ConsensusTransSetSF sf (getApp().getTempNodeCache ());
+        // The consensus round is waiting on this set
+        NodeStore::ScopedReadPriority priority (NodeStore::readCritical);
         mMap->getMissingNodes (nodeIDs, nodeHashes, 256, &sf);
 
         if (nodeIDs.empty ())
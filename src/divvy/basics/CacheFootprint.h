@@ -0,0 +1,59 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of divvyd: https://github.com/xdv/divvyd
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef RIPPLE_BASICS_CACHEFOOTPRINT_H_INCLUDED
+#define RIPPLE_BASICS_CACHEFOOTPRINT_H_INCLUDED
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace divvy {
+
+/** Returns the approximate number of bytes of memory used by an object.
+
+    The caches call this to account for the objects they hold when a byte
+    budget is set. The default only counts the object itself; types which
+    own variable length storage should provide an overload in their own
+    namespace so that it is found by argument dependent lookup.
+*/
+template <class T>
+std::size_t
+cacheFootprint (T const&)
+{
+    return sizeof (T);
+}
+
+template <class T, class Allocator>
+std::size_t
+cacheFootprint (std::vector <T, Allocator> const& v)
+{
+    return sizeof (v) + v.capacity () * sizeof (T);
+}
+
+template <class CharT, class Traits, class Allocator>
+std::size_t
+cacheFootprint (std::basic_string <CharT, Traits, Allocator> const& s)
+{
+    return sizeof (s) + s.capacity () * sizeof (CharT);
+}
+
+}
+
+#endif
@@ -0,0 +1,82 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of divvyd: https://github.com/xdv/divvyd
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef RIPPLE_BASICS_FREQUENCYSKETCH_H_INCLUDED
+#define RIPPLE_BASICS_FREQUENCYSKETCH_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace divvy {
+
+/** Approximate counts of recent accesses to a set of keys.
+
+    This is the count-min sketch used by TinyLFU. Each key maps to one
+    4-bit counter in each of four rows and its estimated frequency is the
+    smallest of the four. When the number of recorded accesses reaches ten
+    times the capacity every counter is halved, so the estimates describe
+    recent history instead of all time. The sketch takes eight bytes per
+    unit of capacity.
+
+    Keys are identified only by their hash. The caller must provide its
+    own synchronization.
+*/
+class FrequencySketch
+{
+public:
+    /** The largest frequency a counter can hold. */
+    static int const maxFrequency = 15;
+
+    /** Create a sketch sized for `capacity` distinct keys. */
+    explicit
+    FrequencySketch (std::size_t capacity = 0);
+
+    /** Resize the sketch for `capacity` distinct keys.
+        All counts are discarded.
+    */
+    void
+    resize (std::size_t capacity);
+
+    /** Discard all counts. */
+    void
+    clear ();
+
+    /** Record an access to the key with the given hash. */
+    void
+    increment (std::size_t hash);
+
+    /** Return the approximate number of recent accesses to a key. */
+    int
+    estimate (std::size_t hash) const;
+
+private:
+    static std::uint64_t index (std::size_t hash, int row);
+    void halve ();
+
+    // Each word holds sixteen 4-bit counters
+    std::vector <std::uint64_t> table_;
+    std::uint64_t mask_;
+    std::size_t additions_;
+    std::size_t sampleSize_;
+};
+
+}
+
+#endif
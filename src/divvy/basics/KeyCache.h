@@ -25,7 +25,9 @@
 #include <beast/chrono/abstract_clock.h>
 #include <beast/chrono/chrono_io.h>
 #include <beast/Insight.h>
+#include <algorithm>
 #include <mutex>
+#include <vector>
 
 namespace divvy {
 
@@ -34,6 +36,10 @@ namespace divvy {
     The cache has a target size and an expiration time. When cached items become
     older than the maximum age they are eligible for removal during a
     call to @ref sweep.
+
+    A budget in bytes may also be set. Every entry has the same footprint,
+    so the budget caps the number of entries, and a sweep which finds the
+    cache over budget evicts the least recently used keys.
 */
 // VFALCO TODO Figure out how to pass through the allocator
 template <
@@ -87,6 +93,10 @@ private:
 public:
     using size_type = typename map_type::size_type;
 
+    /** Approximate memory used by one key, including the map node. */
+    static std::size_t const entryBytes =
+        sizeof (typename map_type::value_type) + 2 * sizeof (void*);
+
 private:
     Mutex mutable m_mutex;
     map_type m_map;
@@ -95,6 +105,7 @@ private:
     std::string const m_name;
     size_type m_target_size;
     clock_type::duration m_target_age;
+    std::size_t m_target_bytes;
 
 public:
     /** Construct with the specified name.
@@ -112,6 +123,7 @@ public:
         , m_name (name)
         , m_target_size (target_size)
         , m_target_age (std::chrono::seconds (expiration_seconds))
+        , m_target_bytes (0)
     {
     }
 
@@ -125,6 +137,7 @@ public:
         , m_name (name)
         , m_target_size (target_size)
         , m_target_age (std::chrono::seconds (expiration_seconds))
+        , m_target_bytes (0)
     {
     }
 
@@ -149,6 +162,13 @@ public:
         return m_map.size ();
     }
 
+    /** Returns the approximate number of bytes used by the container. */
+    std::size_t bytes () const
+    {
+        lock_guard lock (m_mutex);
+        return m_map.size () * entryBytes;
+    }
+
     /** Empty the cache */
     void clear ()
     {
@@ -168,6 +188,15 @@ public:
         m_target_age = std::chrono::seconds (s);
     }
 
+    /** Set the memory budget of the cache, in bytes (0 = ignore).
+        The budget is enforced by sweep.
+    */
+    void setTargetBytes (std::size_t bytes)
+    {
+        lock_guard lock (m_mutex);
+        m_target_bytes = bytes;
+    }
+
     /** Returns `true` if the key was found.
         Does not update the last access time.
     */
@@ -280,6 +309,23 @@ public:
                 ++it;
             }
         }
+
+        if (m_target_bytes != 0 && m_map.size () * entryBytes > m_target_bytes)
+        {
+            // Keys all cost the same, so evict the least recently used
+            std::vector <iterator> v;
+            v.reserve (m_map.size ());
+            for (it = m_map.begin (); it != m_map.end (); ++it)
+                v.push_back (it);
+            auto const excess = m_map.size () - m_target_bytes / entryBytes;
+            std::nth_element (v.begin (), v.begin () + excess, v.end (),
+                [](iterator const& lhs, iterator const& rhs)
+                {
+                    return lhs->second.last_access < rhs->second.last_access;
+                });
+            for (auto i = v.begin (); i != v.begin () + excess; ++i)
+                m_map.erase (*i);
+        }
     }
 
 private:
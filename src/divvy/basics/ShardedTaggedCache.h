@@ -0,0 +1,311 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of divvyd: https://github.com/xdv/divvyd
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef RIPPLE_BASICS_SHARDEDTAGGEDCACHE_H_INCLUDED
+#define RIPPLE_BASICS_SHARDEDTAGGEDCACHE_H_INCLUDED
+
+#include <divvy/basics/TaggedCache.h>
+#include <beast/cxx14/memory.h> // <memory>
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+namespace divvy {
+
+/** A TaggedCache split into independently locked shards.
+
+    Each key is assigned to one of `Shards` sub-caches using bits of its
+    hash, so threads working on different keys rarely contend for the same
+    mutex. The interface and semantics match TaggedCache, except that there
+    is no single mutex which protects the whole container.
+
+    The target size and byte budget are divided evenly between the shards,
+    and a sweep visits one shard at a time so that only a fraction of the
+    cache is locked at any moment.
+*/
+template <
+    class Key,
+    class T,
+    class Hash = hardened_hash <>,
+    class KeyEqual = std::equal_to <Key>,
+    class Mutex = std::recursive_mutex,
+    std::size_t Shards = 16
+>
+class ShardedTaggedCache
+{
+public:
+    using shard_type = TaggedCache <Key, T, Hash, KeyEqual, Mutex>;
+    using mutex_type = Mutex;
+    using key_type = Key;
+    using mapped_type = T;
+    using weak_mapped_ptr = std::weak_ptr <mapped_type>;
+    using mapped_ptr = std::shared_ptr <mapped_type>;
+    using clock_type = typename shard_type::clock_type;
+
+    static_assert (Shards > 0, "");
+
+public:
+    ShardedTaggedCache (std::string const& name, int size,
+        typename clock_type::rep expiration_seconds, clock_type& clock,
+            beast::Journal journal,
+                beast::insight::Collector::ptr const& collector =
+                    beast::insight::NullCollector::New ())
+        : m_clock (clock)
+        , m_stats (name,
+            std::bind (&ShardedTaggedCache::collect_metrics, this),
+                collector)
+        , m_target_size (size)
+        , m_target_bytes (0)
+    {
+        m_shards.reserve (Shards);
+        for (std::size_t i = 0; i < Shards; ++i)
+            m_shards.emplace_back (std::make_unique <shard_type> (
+                name, shardSize (size), expiration_seconds, clock, journal));
+    }
+
+    /** Return the clock associated with the cache. */
+    clock_type& clock ()
+    {
+        return m_clock;
+    }
+
+    int getTargetSize () const
+    {
+        return m_target_size;
+    }
+
+    void setTargetSize (int s)
+    {
+        m_target_size = s;
+        for (auto& shard : m_shards)
+            shard->setTargetSize (shardSize (s));
+    }
+
+    typename clock_type::rep getTargetAge () const
+    {
+        return m_shards.front ()->getTargetAge ();
+    }
+
+    void setTargetAge (typename clock_type::rep s)
+    {
+        for (auto& shard : m_shards)
+            shard->setTargetAge (s);
+    }
+
+    std::size_t getTargetBytes () const
+    {
+        return m_target_bytes;
+    }
+
+    /** Set the memory budget of the cache, in bytes (0 = ignore).
+        @see TaggedCache::setTargetBytes
+    */
+    void setTargetBytes (std::size_t bytes)
+    {
+        m_target_bytes = bytes;
+        for (auto& shard : m_shards)
+            shard->setTargetBytes ((bytes + Shards - 1) / Shards);
+    }
+
+    std::size_t getCacheBytes ()
+    {
+        std::size_t bytes = 0;
+        for (auto& shard : m_shards)
+            bytes += shard->getCacheBytes ();
+        return bytes;
+    }
+
+    void setAdmission (bool enable)
+    {
+        for (auto& shard : m_shards)
+            shard->setAdmission (enable);
+    }
+
+    std::uint64_t getRejections ()
+    {
+        std::uint64_t rejections = 0;
+        for (auto& shard : m_shards)
+            rejections += shard->getRejections ();
+        return rejections;
+    }
+
+    int getCacheSize ()
+    {
+        int size = 0;
+        for (auto& shard : m_shards)
+            size += shard->getCacheSize ();
+        return size;
+    }
+
+    int getTrackSize ()
+    {
+        int size = 0;
+        for (auto& shard : m_shards)
+            size += shard->getTrackSize ();
+        return size;
+    }
+
+    float getHitRate ()
+    {
+        std::uint64_t hits = 0;
+        std::uint64_t misses = 0;
+        for (auto& shard : m_shards)
+        {
+            auto const stats = shard->getHitsAndMisses ();
+            hits += stats.first;
+            misses += stats.second;
+        }
+        auto const total = static_cast<float> (hits + misses);
+        return hits * (100.0f / std::max (1.0f, total));
+    }
+
+    void clearStats ()
+    {
+        for (auto& shard : m_shards)
+            shard->clearStats ();
+    }
+
+    void clear ()
+    {
+        for (auto& shard : m_shards)
+            shard->clear ();
+    }
+
+    void sweep ()
+    {
+        for (auto& shard : m_shards)
+            shard->sweep ();
+    }
+
+    bool del (key_type const& key, bool valid)
+    {
+        return shardFor (key).del (key, valid);
+    }
+
+    /** Replace aliased objects with originals.
+        @see TaggedCache::canonicalize
+    */
+    bool canonicalize (key_type const& key, std::shared_ptr<T>& data,
+        bool replace = false)
+    {
+        return shardFor (key).canonicalize (key, data, replace);
+    }
+
+    /** Canonicalize an object loaded from backing storage.
+        @see TaggedCache::admit
+    */
+    bool admit (key_type const& key, std::shared_ptr<T>& data)
+    {
+        return shardFor (key).admit (key, data);
+    }
+
+    std::shared_ptr<T> fetch (key_type const& key)
+    {
+        return shardFor (key).fetch (key);
+    }
+
+    /** Fetch without counting the access.
+        @see TaggedCache::refetch
+    */
+    std::shared_ptr<T> refetch (key_type const& key)
+    {
+        return shardFor (key).refetch (key);
+    }
+
+    bool insert (key_type const& key, T const& value)
+    {
+        return shardFor (key).insert (key, value);
+    }
+
+    bool retrieve (key_type const& key, T& data)
+    {
+        return shardFor (key).retrieve (key, data);
+    }
+
+    bool refreshIfPresent (key_type const& key)
+    {
+        return shardFor (key).refreshIfPresent (key);
+    }
+
+    std::vector <key_type> getKeys ()
+    {
+        std::vector <key_type> v;
+        for (auto& shard : m_shards)
+        {
+            auto keys = shard->getKeys ();
+            v.insert (v.end (), keys.begin (), keys.end ());
+        }
+        return v;
+    }
+
+private:
+    static int shardSize (int size)
+    {
+        return static_cast <int> ((size + Shards - 1) / Shards);
+    }
+
+    shard_type& shardFor (key_type const& key)
+    {
+        // Use the high bits, the low bits select buckets within a shard
+        std::size_t const h = m_hash (key);
+        return *m_shards [(h >> (8 * sizeof (std::size_t) - 16)) % Shards];
+    }
+
+    void collect_metrics ()
+    {
+        m_stats.size.set (getCacheSize ());
+        m_stats.bytes.set (getCacheBytes ());
+        m_stats.hit_rate.set (
+            static_cast <beast::insight::Gauge::value_type> (getHitRate ()));
+    }
+
+private:
+    struct Stats
+    {
+        template <class Handler>
+        Stats (std::string const& prefix, Handler const& handler,
+            beast::insight::Collector::ptr const& collector)
+            : hook (collector->make_hook (handler))
+            , size (collector->make_gauge (prefix, "size"))
+            , hit_rate (collector->make_gauge (prefix, "hit_rate"))
+            , bytes (collector->make_gauge (prefix, "bytes"))
+            { }
+
+        beast::insight::Hook hook;
+        beast::insight::Gauge size;
+        beast::insight::Gauge hit_rate;
+        beast::insight::Gauge bytes;
+    };
+
+    clock_type& m_clock;
+    Stats m_stats;
+    Hash m_hash;
+
+    // Desired number of cache entries across all shards (0 = ignore)
+    std::atomic <int> m_target_size;
+
+    // Desired maximum bytes across all shards (0 = ignore)
+    std::atomic <std::size_t> m_target_bytes;
+
+    std::vector <std::unique_ptr <shard_type>> m_shards;
+};
+
+}
+
+#endif
@@ -0,0 +1,213 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of divvyd: https://github.com/xdv/divvyd
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef RIPPLE_BASICS_SLABALLOCATOR_H_INCLUDED
+#define RIPPLE_BASICS_SLABALLOCATOR_H_INCLUDED
+
+#include <beast/threads/SpinLock.h>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace divvy {
+
+/** A pool of equally sized memory blocks carved from larger slabs.
+
+    Freed blocks go on a free list and are handed out again before a new
+    slab is taken from the heap. Freeing blocks never frees a slab, so the
+    pool holds on to its peak size until trim is called, but objects that
+    are created and destroyed at a high rate stop fragmenting the general
+    heap.
+
+    The free lists are split into shards, each with its own lock, and a
+    thread always uses the shard its id hashes to. A block may be freed
+    to a different shard than it came from, and a shard that runs dry
+    takes the free blocks of the others before a new slab is made.
+
+    All members are thread safe.
+*/
+class SlabPool
+{
+public:
+    SlabPool (std::size_t blockSize, std::size_t slabSize);
+
+    /** Return every slab to the heap.
+        No block may still be in use.
+    */
+    ~SlabPool ();
+
+    SlabPool (SlabPool const&) = delete;
+    SlabPool& operator= (SlabPool const&) = delete;
+
+    void*
+    allocate ();
+
+    void
+    deallocate (void* p);
+
+    std::size_t
+    blockSize () const
+    {
+        return blockSize_;
+    }
+
+    /** Return the number of blocks currently handed out. */
+    std::size_t
+    inUse () const;
+
+    /** Return the number of slabs taken from the heap. */
+    std::size_t
+    slabs () const;
+
+    /** Return slabs whose blocks are all free to the heap.
+        The free lists are taken out of their shards while they are
+        walked, so users of the pool only wait on the hand-offs. Does
+        nothing when too few blocks are free to fill a slab.
+        @return The number of bytes released.
+    */
+    std::size_t
+    trim ();
+
+    /** Trim every pool in the process.
+        @return The number of bytes released.
+    */
+    static
+    std::size_t
+    trimAll ();
+
+private:
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    enum
+    {
+        shardCount = 8
+    };
+
+    struct Shard
+    {
+        mutable beast::SpinLock lock;
+        FreeBlock* free = nullptr;
+
+        // Negative when more blocks were freed here than taken
+        std::ptrdiff_t inUse = 0;
+
+        // Keeps shards used by different threads off one cache line
+        char pad[64];
+    };
+
+    Shard& shard ();
+
+    bool steal (Shard& shard);
+
+    void grow (Shard& shard);
+
+    std::size_t const blockSize_;
+    std::size_t const blocksPerSlab_;
+
+    Shard shards_[shardCount];
+
+    // Taken after any shard lock
+    mutable std::mutex slabsMutex_;
+    std::vector <char*> slabs_;
+};
+
+/** Return the process wide pool for blocks of `Size` bytes. */
+template <std::size_t Size>
+SlabPool&
+getSlabPool ()
+{
+    // Never destroyed: pooled objects may outlive static destructors
+    static SlabPool* const pool = new SlabPool (Size, 64 * 1024);
+    return *pool;
+}
+
+/** An allocator that takes single objects from a SlabPool.
+
+    Arrays fall back to the heap. Meant for allocate_shared, which puts
+    the object and its reference counts in one pooled block.
+*/
+template <class T>
+class SlabAllocator
+{
+public:
+    using value_type = T;
+
+    template <class U>
+    struct rebind
+    {
+        using other = SlabAllocator <U>;
+    };
+
+    SlabAllocator () = default;
+
+    template <class U>
+    SlabAllocator (SlabAllocator <U> const&)
+    {
+    }
+
+    T*
+    allocate (std::size_t n)
+    {
+        if (n == 1)
+            return static_cast <T*> (getSlabPool <sizeof (T)> ().allocate ());
+        return static_cast <T*> (::operator new (n * sizeof (T)));
+    }
+
+    void
+    deallocate (T* p, std::size_t n)
+    {
+        if (n == 1)
+            getSlabPool <sizeof (T)> ().deallocate (p);
+        else
+            ::operator delete (p);
+    }
+};
+
+template <class T, class U>
+bool
+operator== (SlabAllocator <T> const&, SlabAllocator <U> const&)
+{
+    return true;
+}
+
+template <class T, class U>
+bool
+operator!= (SlabAllocator <T> const&, SlabAllocator <U> const&)
+{
+    return false;
+}
+
+/** Create a shared object in a slab pooled block. */
+template <class T, class... Args>
+std::shared_ptr <T>
+make_pooled (Args&&... args)
+{
+    return std::allocate_shared <T> (
+        SlabAllocator <T> (), std::forward <Args> (args)...);
+}
+
+} // divvy
+
+#endif
@@ -20,13 +20,17 @@
 #ifndef RIPPLE_BASICS_TAGGEDCACHE_H_INCLUDED
 #define RIPPLE_BASICS_TAGGEDCACHE_H_INCLUDED
 
+#include <divvy/basics/CacheFootprint.h>
+#include <divvy/basics/FrequencySketch.h>
 #include <divvy/basics/hardened_hash.h>
 #include <divvy/basics/UnorderedContainers.h>
 #include <beast/chrono/abstract_clock.h>
 #include <beast/chrono/chrono_io.h>
 #include <beast/Insight.h>
+#include <algorithm>
 #include <functional>
 #include <mutex>
+#include <utility>
 #include <vector>
 
 namespace divvy {
@@ -43,6 +47,20 @@ struct TaggedCacheLog;
     If it stays in memory even after it is ejected from the cache,
     the map will track it.
 
+    Besides the target size and age, the cache may be given a budget in
+    bytes. The footprint of each cached object is estimated with
+    cacheFootprint when it enters the cache, and when the total exceeds the
+    budget a sweep evicts the entries with the highest cost, where cost is
+    the time since last access multiplied by the footprint. Large, idle
+    objects go first; small, hot objects stay.
+
+    Optionally the cache applies a TinyLFU style admission policy to
+    objects offered through @ref admit. The frequency of fetches is
+    recorded in a FrequencySketch, and while the cache is at its target
+    size or byte budget a new key is only admitted if it was fetched
+    recently. A single pass over a large data set then leaves the working
+    set in place.
+
     @note Callers must not modify data objects that are stored in the cache
           unless they hold their own lock over all cache operations.
 */
@@ -82,9 +100,13 @@ public:
         , m_name (name)
         , m_target_size (size)
         , m_target_age (std::chrono::seconds (expiration_seconds))
+        , m_target_bytes (0)
         , m_cache_count (0)
+        , m_cache_bytes (0)
+        , m_admission (false)
         , m_hits (0)
         , m_misses (0)
+        , m_rejections (0)
     {
     }
 
@@ -109,6 +131,9 @@ public:
         if (s > 0)
             m_cache.rehash (static_cast<std::size_t> ((s + (s >> 2)) / m_cache.max_load_factor () + 1));
 
+        if (m_admission)
+            m_sketch.resize (sketchSize ());
+
         if (m_journal.debug) m_journal.debug <<
             m_name << " target size set to " << s;
     }
@@ -127,12 +152,51 @@ public:
             m_name << " target age set to " << m_target_age;
     }
 
+    std::size_t getTargetBytes () const
+    {
+        lock_guard lock (m_mutex);
+        return m_target_bytes;
+    }
+
+    /** Set the memory budget of the cache, in bytes (0 = ignore).
+        The budget is enforced by sweep.
+    */
+    void setTargetBytes (std::size_t bytes)
+    {
+        lock_guard lock (m_mutex);
+        m_target_bytes = bytes;
+        if (m_journal.debug) m_journal.debug <<
+            m_name << " target bytes set to " << bytes;
+    }
+
+    /** Enable or disable the admission policy used by @ref admit. */
+    void setAdmission (bool enable)
+    {
+        lock_guard lock (m_mutex);
+        m_admission = enable;
+        m_sketch.resize (enable ? sketchSize () : 0);
+    }
+
+    /** Return the number of objects turned away by the admission policy. */
+    std::uint64_t getRejections ()
+    {
+        lock_guard lock (m_mutex);
+        return m_rejections;
+    }
+
     int getCacheSize ()
     {
         lock_guard lock (m_mutex);
         return m_cache_count;
     }
 
+    /** Return the approximate number of bytes held by cached entries. */
+    std::size_t getCacheBytes ()
+    {
+        lock_guard lock (m_mutex);
+        return m_cache_bytes;
+    }
+
     int getTrackSize ()
     {
         lock_guard lock (m_mutex);
@@ -146,11 +210,19 @@ public:
         return m_hits * (100.0f / std::max (1.0f, total));
     }
 
+    /** Return the number of fetch hits and misses. */
+    std::pair <std::uint64_t, std::uint64_t> getHitsAndMisses ()
+    {
+        lock_guard lock (m_mutex);
+        return { m_hits, m_misses };
+    }
+
     void clearStats ()
     {
         lock_guard lock (m_mutex);
         m_hits = 0;
         m_misses = 0;
+        m_rejections = 0;
     }
 
     void clear ()
@@ -158,6 +230,7 @@ public:
         lock_guard lock (m_mutex);
         m_cache.clear ();
         m_cache_count = 0;
+        m_cache_bytes = 0;
     }
 
     void sweep ()
@@ -219,20 +292,9 @@ public:
                 else if (cit->second.last_access <= when_expire)
                 {
                     // strong, expired
-                    --m_cache_count;
                     ++cacheRemovals;
-                    if (cit->second.ptr.unique ())
-                    {
-                        stuffToSweep.push_back (cit->second.ptr);
+                    if (evict (cit, stuffToSweep))
                         ++mapRemovals;
-                        cit = m_cache.erase (cit);
-                    }
-                    else
-                    {
-                        // remains weakly cached
-                        cit->second.ptr.reset ();
-                        ++cit;
-                    }
                 }
                 else
                 {
@@ -241,6 +303,9 @@ public:
                     ++cit;
                 }
             }
+
+            if (m_target_bytes != 0 && m_cache_bytes > m_target_bytes)
+                evictBytes (now, stuffToSweep, cacheRemovals, mapRemovals);
         }
 
         if (m_journal.trace && (mapRemovals || cacheRemovals)) m_journal.trace <<
@@ -268,6 +333,7 @@ public:
         if (entry.isCached ())
         {
             --m_cache_count;
+            m_cache_bytes -= entry.bytes;
             entry.ptr.reset ();
             ret = true;
         }
@@ -301,10 +367,11 @@ public:
 
         if (cit == m_cache.end ())
         {
-            m_cache.emplace (std::piecewise_construct,
+            cit = m_cache.emplace (std::piecewise_construct,
                 std::forward_as_tuple(key),
-                std::forward_as_tuple(m_clock.now(), data));
+                std::forward_as_tuple(m_clock.now(), data)).first;
             ++m_cache_count;
+            m_cache_bytes += cit->second.bytes;
             return false;
         }
 
@@ -315,8 +382,9 @@ public:
         {
             if (replace)
             {
-                entry.ptr = data;
-                entry.weak_ptr = data;
+                m_cache_bytes -= entry.bytes;
+                entry.set (data);
+                m_cache_bytes += entry.bytes;
             }
             else
             {
@@ -332,8 +400,7 @@ public:
         {
             if (replace)
             {
-                entry.ptr = data;
-                entry.weak_ptr = data;
+                entry.set (data);
             }
             else
             {
@@ -342,50 +409,58 @@ public:
             }
 
             ++m_cache_count;
+            m_cache_bytes += entry.bytes;
             return true;
         }
 
-        entry.ptr = data;
-        entry.weak_ptr = data;
+        entry.set (data);
         ++m_cache_count;
+        m_cache_bytes += entry.bytes;
 
         return false;
     }
 
-    std::shared_ptr<T> fetch (const key_type& key)
-    {
-        // fetch us a shared pointer to the stored data object
-        lock_guard lock (m_mutex);
+    /** Canonicalize an object which was loaded from backing storage.
 
-        cache_iterator cit = m_cache.find (key);
+        This is canonicalize without replacement, except that when the
+        admission policy is enabled and the cache is full, a key which
+        is not already present is only inserted if it was fetched at
+        least `admitFrequency` times recently. A rejected object is left
+        in `data` and is not tracked.
 
-        if (cit == m_cache.end ())
+        @return `true` If the key already existed.
+    */
+    bool admit (key_type const& key, std::shared_ptr<T>& data)
+    {
         {
-            ++m_misses;
-            return mapped_ptr ();
-        }
-
-        Entry& entry = cit->second;
-        entry.touch (m_clock.now());
+            lock_guard lock (m_mutex);
 
-        if (entry.isCached ())
-        {
-            ++m_hits;
-            return entry.ptr;
+            if (m_admission && isFull () &&
+                m_cache.find (key) == m_cache.end () &&
+                m_sketch.estimate (m_hash (key)) < admitFrequency)
+            {
+                ++m_rejections;
+                return false;
+            }
         }
 
-        entry.ptr = entry.lock ();
+        return canonicalize (key, data);
+    }
 
-        if (entry.isCached ())
-        {
-            // independent of cache size, so not counted as a hit
-            ++m_cache_count;
-            return entry.ptr;
-        }
+    std::shared_ptr<T> fetch (const key_type& key)
+    {
+        return fetch (key, true);
+    }
 
-        m_cache.erase (cit);
-        ++m_misses;
-        return mapped_ptr ();
+    /** Fetch without counting the access.
+
+        Neither the hit rate nor the frequencies used by @ref admit
+        change. Use this to look again for a key whose access was
+        already counted, so that one request is not counted twice.
+    */
+    std::shared_ptr<T> refetch (const key_type& key)
+    {
+        return fetch (key, false);
     }
 
     /** Insert the element into the container.
@@ -443,6 +518,7 @@ public:
                 {
                     // We just put the object back in cache
                     ++m_cache_count;
+                    m_cache_bytes += entry.bytes;
                     entry.touch (m_clock.now());
                     found = true;
                 }
@@ -488,9 +564,146 @@ public:
     }
 
 private:
+    // Number of recent fetches needed to enter a full cache
+    static int const admitFrequency = 2;
+
+    class Entry;
+    using cache_type = hardened_hash_map <key_type, Entry, Hash, KeyEqual>;
+    using cache_iterator = typename cache_type::iterator;
+
+    bool isFull () const
+    {
+        return (m_target_size != 0 && m_cache_count >= m_target_size) ||
+            (m_target_bytes != 0 && m_cache_bytes >= m_target_bytes);
+    }
+
+    std::size_t sketchSize () const
+    {
+        return std::max (m_target_size, 1024);
+    }
+
+    std::shared_ptr<T> fetch (const key_type& key, bool counted)
+    {
+        // fetch us a shared pointer to the stored data object
+        lock_guard lock (m_mutex);
+
+        if (counted && m_admission)
+            m_sketch.increment (m_hash (key));
+
+        cache_iterator cit = m_cache.find (key);
+
+        if (cit == m_cache.end ())
+        {
+            if (counted)
+                ++m_misses;
+            return mapped_ptr ();
+        }
+
+        Entry& entry = cit->second;
+        entry.touch (m_clock.now());
+
+        if (entry.isCached ())
+        {
+            if (counted)
+                ++m_hits;
+            return entry.ptr;
+        }
+
+        entry.ptr = entry.lock ();
+
+        if (entry.isCached ())
+        {
+            // independent of cache size, so not counted as a hit
+            ++m_cache_count;
+            m_cache_bytes += entry.bytes;
+            return entry.ptr;
+        }
+
+        m_cache.erase (cit);
+        if (counted)
+            ++m_misses;
+        return mapped_ptr ();
+    }
+
+    // Drop the strong reference held by a cached entry, removing
+    // the entry from the map when nobody else holds the object.
+    // Advances the iterator. Returns `true` if the entry was removed.
+    bool evict (cache_iterator& cit, std::vector <mapped_ptr>& stuffToSweep)
+    {
+        --m_cache_count;
+        m_cache_bytes -= cit->second.bytes;
+        if (cit->second.ptr.unique ())
+        {
+            stuffToSweep.push_back (cit->second.ptr);
+            cit = m_cache.erase (cit);
+            return true;
+        }
+        // remains weakly cached
+        cit->second.ptr.reset ();
+        ++cit;
+        return false;
+    }
+
+    // Evict the most costly entries until the cache fits its byte budget.
+    void evictBytes (clock_type::time_point const& now,
+        std::vector <mapped_ptr>& stuffToSweep,
+            int& cacheRemovals, int& mapRemovals)
+    {
+        using candidate = std::pair <double, cache_iterator>;
+        std::vector <candidate> candidates;
+        candidates.reserve (m_cache_count);
+
+        for (auto cit = m_cache.begin (); cit != m_cache.end (); ++cit)
+        {
+            if (cit->second.isCached ())
+            {
+                // Count at least one tick of age so that entries
+                // touched during this sweep are still ordered by size
+                auto const age = std::max <clock_type::rep> (1,
+                    (now - cit->second.last_access).count ());
+                candidates.emplace_back (static_cast <double> (age) *
+                    cit->second.bytes, cit);
+            }
+        }
+
+        auto const costlier = [](candidate const& lhs, candidate const& rhs)
+            {
+                return lhs.first > rhs.first;
+            };
+
+        // Only the costliest few entries are ever evicted, so rather than
+        // sorting every candidate under the lock, select a batch sized
+        // from the bytes still to free and sort just that batch, doubling
+        // it whenever it falls short.
+        std::size_t const before = m_cache_bytes;
+        std::size_t const average = std::max <std::size_t> (1,
+            m_cache_bytes / std::size_t (std::max (m_cache_count, 1)));
+        std::size_t batch = (m_cache_bytes - m_target_bytes) / average + 1;
+        auto first = candidates.begin ();
+        while (first != candidates.end () && m_cache_bytes > m_target_bytes)
+        {
+            auto const last = first + std::min <std::size_t> (
+                batch, candidates.end () - first);
+            std::nth_element (first, last - 1, candidates.end (), costlier);
+            std::sort (first, last, costlier);
+            for (; first != last && m_cache_bytes > m_target_bytes; ++first)
+            {
+                ++cacheRemovals;
+                if (evict (first->second, stuffToSweep))
+                    ++mapRemovals;
+            }
+            batch *= 2;
+        }
+
+        if (m_journal.trace) m_journal.trace <<
+            m_name << " is over budget, evicted " << (before - m_cache_bytes) <<
+                " of " << before << " bytes";
+    }
+
     void collect_metrics ()
     {
         m_stats.size.set (getCacheSize ());
+        m_stats.bytes.set (getCacheBytes ());
 
         {
             beast::insight::Gauge::value_type hit_rate (0);
@@ -513,11 +726,13 @@ private:
             : hook (collector->make_hook (handler))
             , size (collector->make_gauge (prefix, "size"))
             , hit_rate (collector->make_gauge (prefix, "hit_rate"))
+            , bytes (collector->make_gauge (prefix, "bytes"))
             { }
 
         beast::insight::Hook hook;
         beast::insight::Gauge size;
         beast::insight::Gauge hit_rate;
+        beast::insight::Gauge bytes;
     };
 
     class Entry
@@ -527,14 +742,33 @@ private:
         weak_mapped_ptr weak_ptr;
         clock_type::time_point last_access;
 
+        // Approximate memory held by the entry while cached
+        std::size_t bytes;
+
         Entry (clock_type::time_point const& last_access_,
             mapped_ptr const& ptr_)
             : ptr (ptr_)
             , weak_ptr (ptr_)
             , last_access (last_access_)
+            , bytes (footprint (ptr_))
         {
         }
 
+        void set (mapped_ptr const& ptr_)
+        {
+            ptr = ptr_;
+            weak_ptr = ptr_;
+            bytes = footprint (ptr_);
+        }
+
+        static std::size_t footprint (mapped_ptr const& ptr_)
+        {
+            std::size_t bytes = sizeof (typename cache_type::value_type);
+            if (ptr_)
+                bytes += cacheFootprint (*ptr_);
+            return bytes;
+        }
+
         bool isWeak () const { return ptr == nullptr; }
         bool isCached () const { return ptr != nullptr; }
         bool isExpired () const { return weak_ptr.expired (); }
@@ -542,12 +776,10 @@ private:
         void touch (clock_type::time_point const& now) { last_access = now; }
     };
 
-    using cache_type = hardened_hash_map <key_type, Entry, Hash, KeyEqual>;
-    using cache_iterator = typename cache_type::iterator;
-
     beast::Journal m_journal;
     clock_type& m_clock;
     Stats m_stats;
+    Hash m_hash;
 
     mutex_type mutable m_mutex;
 
@@ -560,11 +792,23 @@ private:
     // Desired maximum cache age
     clock_type::duration m_target_age;
 
+    // Desired maximum bytes held by cached entries (0 = ignore)
+    std::size_t m_target_bytes;
+
     // Number of items cached
     int m_cache_count;
+
+    // Approximate bytes held by cached entries
+    std::size_t m_cache_bytes;
     cache_type m_cache;  // Hold strong reference to recent objects
+
+    // Recent fetch frequencies, used when admission is enabled
+    bool m_admission;
+    FrequencySketch m_sketch;
+
     std::uint64_t m_hits;
     std::uint64_t m_misses;
+    std::uint64_t m_rejections;
 };
 
 }
@@ -0,0 +1,92 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of divvyd: https://github.com/xdv/divvyd
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef RIPPLE_BASICS_TASKPOOL_H_INCLUDED
+#define RIPPLE_BASICS_TASKPOOL_H_INCLUDED
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace divvy {
+
+/** A fixed set of long lived threads shared by work that runs in parallel.
+
+    Tasks run in the order they were posted. However many callers post at
+    once, no more than size() tasks run at a time, so the pool bounds the
+    threads such work uses across the whole process. A posted task may wait
+    behind others, so a caller that must finish should do a share of the
+    work on its own thread rather than block on the pool.
+*/
+class TaskPool
+{
+public:
+    using Task = std::function <void ()>;
+
+    explicit TaskPool (int threads);
+
+    /** Wait for the running tasks and stop. Queued tasks are dropped. */
+    ~TaskPool ();
+
+    TaskPool (TaskPool const&) = delete;
+    TaskPool& operator= (TaskPool const&) = delete;
+
+    /** Return the number of threads in the pool. */
+    int
+    size () const
+    {
+        return static_cast <int> (threads_.size ());
+    }
+
+    /** Queue a task. The task must not throw. */
+    void
+    post (Task task);
+
+    /** Call f(i) for every i in [0, n) and return when all calls are done.
+
+        The calling thread takes part, joined by up to `helpers` threads
+        from the pool as they come free. The first exception thrown by f
+        is rethrown here once the other calls have finished.
+    */
+    void
+    forEach (std::size_t n, int helpers,
+        std::function <void (std::size_t)> const& f);
+
+    /** Return the pool shared by the whole process. */
+    static
+    TaskPool&
+    shared ();
+
+private:
+    void run ();
+
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::deque <Task> tasks_;
+    bool stop_ = false;
+    std::vector <std::thread> threads_;
+};
+
+} // divvy
+
+#endif
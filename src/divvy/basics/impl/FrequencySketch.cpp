@@ -0,0 +1,125 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of divvyd: https://github.com/xdv/divvyd
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <divvy/basics/FrequencySketch.h>
+#include <algorithm>
+
+namespace divvy {
+
+FrequencySketch::FrequencySketch (std::size_t capacity)
+    : mask_ (0)
+    , additions_ (0)
+    , sampleSize_ (0)
+{
+    resize (capacity);
+}
+
+void
+FrequencySketch::resize (std::size_t capacity)
+{
+    if (capacity == 0)
+    {
+        table_.clear ();
+        table_.shrink_to_fit ();
+        mask_ = 0;
+        additions_ = 0;
+        sampleSize_ = 0;
+        return;
+    }
+
+    // One word per key, rounded up to a power of two
+    std::size_t words = 1;
+    while (words < capacity)
+        words <<= 1;
+
+    table_.assign (words, 0);
+    mask_ = words - 1;
+    additions_ = 0;
+    sampleSize_ = 10 * capacity;
+}
+
+void
+FrequencySketch::clear ()
+{
+    std::fill (table_.begin (), table_.end (), 0);
+    additions_ = 0;
+}
+
+std::uint64_t
+FrequencySketch::index (std::size_t hash, int row)
+{
+    // A different odd multiplier per row spreads the rows apart
+    static std::uint64_t const seeds[4] = {
+        0xc3a5c85c97cb3127ULL, 0xb492b66fbe98f273ULL,
+        0x9ae16a3b2f90404fULL, 0xcbf29ce484222325ULL };
+    std::uint64_t h = (static_cast <std::uint64_t> (hash) + row) * seeds[row];
+    return h ^ (h >> 32);
+}
+
+void
+FrequencySketch::increment (std::size_t hash)
+{
+    if (table_.empty ())
+        return;
+
+    bool added = false;
+    for (int row = 0; row < 4; ++row)
+    {
+        auto const h = index (hash, row);
+        auto& word = table_[h & mask_];
+        // The top bits of the hash pick the counter within the word
+        int const shift = static_cast <int> (h >> 60) << 2;
+        if (((word >> shift) & 0xf) < maxFrequency)
+        {
+            word += std::uint64_t (1) << shift;
+            added = true;
+        }
+    }
+
+    if (added && ++additions_ >= sampleSize_)
+        halve ();
+}
+
+int
+FrequencySketch::estimate (std::size_t hash) const
+{
+    if (table_.empty ())
+        return 0;
+
+    int frequency = maxFrequency;
+    for (int row = 0; row < 4; ++row)
+    {
+        auto const h = index (hash, row);
+        int const shift = static_cast <int> (h >> 60) << 2;
+        frequency = std::min (frequency,
+            static_cast <int> ((table_[h & mask_] >> shift) & 0xf));
+    }
+    return frequency;
+}
+
+void
+FrequencySketch::halve ()
+{
+    for (auto& word : table_)
+        word = (word >> 1) & 0x7777777777777777ULL;
+    additions_ /= 2;
+}
+
+}
@@ -0,0 +1,269 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of divvyd: https://github.com/xdv/divvyd
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <divvy/basics/SlabAllocator.h>
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace divvy {
+
+namespace {
+
+// Every pool in the process, so they can all be trimmed
+std::mutex& poolsMutex ()
+{
+    // Never destroyed: pools may outlive static destructors
+    static std::mutex* const m = new std::mutex;
+    return *m;
+}
+
+std::vector <SlabPool*>& pools ()
+{
+    static auto* const v = new std::vector <SlabPool*>;
+    return *v;
+}
+
+}
+
+// Every block must be able to hold any object, and a free list link
+static std::size_t blockSizeFor (std::size_t size)
+{
+    std::size_t const align = alignof (std::max_align_t);
+    size = std::max (size, sizeof (void*));
+    return (size + align - 1) & ~(align - 1);
+}
+
+SlabPool::SlabPool (std::size_t blockSize, std::size_t slabSize)
+    : blockSize_ (blockSizeFor (blockSize))
+    , blocksPerSlab_ (std::max <std::size_t> (1, slabSize / blockSize_))
+{
+    std::lock_guard <std::mutex> lock (poolsMutex ());
+    pools ().push_back (this);
+}
+
+SlabPool::~SlabPool ()
+{
+    {
+        std::lock_guard <std::mutex> lock (poolsMutex ());
+        auto& v = pools ();
+        v.erase (std::remove (v.begin (), v.end (), this), v.end ());
+    }
+
+    assert (inUse () == 0);
+    for (auto slab : slabs_)
+        ::operator delete (slab);
+}
+
+void*
+SlabPool::allocate ()
+{
+    auto& s = shard ();
+    std::lock_guard <beast::SpinLock> lock (s.lock);
+    if (s.free == nullptr && ! steal (s))
+        grow (s);
+
+    auto const block = s.free;
+    s.free = block->next;
+    ++s.inUse;
+    return block;
+}
+
+void
+SlabPool::deallocate (void* p)
+{
+    auto& s = shard ();
+    std::lock_guard <beast::SpinLock> lock (s.lock);
+    auto const block = static_cast <FreeBlock*> (p);
+    block->next = s.free;
+    s.free = block;
+    --s.inUse;
+}
+
+std::size_t
+SlabPool::inUse () const
+{
+    std::ptrdiff_t total = 0;
+    for (auto& s : shards_)
+    {
+        std::lock_guard <beast::SpinLock> lock (s.lock);
+        total += s.inUse;
+    }
+    assert (total >= 0);
+    return static_cast <std::size_t> (total);
+}
+
+std::size_t
+SlabPool::slabs () const
+{
+    std::lock_guard <std::mutex> lock (slabsMutex_);
+    return slabs_.size ();
+}
+
+std::size_t
+SlabPool::trim ()
+{
+    // No slab can be entirely free unless a slab's worth of blocks is
+    std::size_t const total = slabs () * blocksPerSlab_;
+    std::size_t const used = inUse ();
+    if (total < used + blocksPerSlab_)
+        return 0;
+
+    // Take the free lists out, so they are walked with no locks held.
+    // A user whose shard runs dry meanwhile steals or grows as usual.
+    FreeBlock* lists[shardCount];
+    for (std::size_t i = 0; i < shardCount; ++i)
+    {
+        std::lock_guard <beast::SpinLock> lock (shards_[i].lock);
+        lists[i] = shards_[i].free;
+        shards_[i].free = nullptr;
+    }
+
+    // Every block taken out lies in a slab that already existed
+    std::vector <char*> slabs;
+    {
+        std::lock_guard <std::mutex> lock (slabsMutex_);
+        slabs = slabs_;
+    }
+
+    // Count the free blocks in each slab
+    std::sort (slabs.begin (), slabs.end ());
+    std::size_t const slabBytes = blockSize_ * blocksPerSlab_;
+    auto const slabOf = [&](FreeBlock const* block)
+    {
+        auto const p = reinterpret_cast <char const*> (block);
+        return std::upper_bound (slabs.begin (), slabs.end (), p) -
+            slabs.begin () - 1;
+    };
+    std::vector <std::size_t> freeCount (slabs.size (), 0);
+    for (auto list : lists)
+        for (auto block = list; block; block = block->next)
+            ++freeCount[slabOf (block)];
+
+    // Unlink the blocks of slabs with nothing in use
+    std::vector <char*> released;
+    for (std::size_t i = 0; i < slabs.size (); ++i)
+        if (freeCount[i] == blocksPerSlab_)
+            released.push_back (slabs[i]);
+
+    FreeBlock** tails[shardCount];
+    for (std::size_t i = 0; i < shardCount; ++i)
+    {
+        auto link = &lists[i];
+        while (*link)
+        {
+            if (freeCount[slabOf (*link)] == blocksPerSlab_)
+                *link = (*link)->next;
+            else
+                link = &(*link)->next;
+        }
+        tails[i] = link;
+    }
+
+    // Put the remaining blocks back in front of any freed meanwhile
+    for (std::size_t i = 0; i < shardCount; ++i)
+    {
+        if (lists[i] == nullptr)
+            continue;
+        std::lock_guard <beast::SpinLock> lock (shards_[i].lock);
+        *tails[i] = shards_[i].free;
+        shards_[i].free = lists[i];
+    }
+
+    if (! released.empty ())
+    {
+        {
+            std::lock_guard <std::mutex> lock (slabsMutex_);
+            slabs_.erase (std::remove_if (slabs_.begin (), slabs_.end (),
+                [&released](char* slab)
+                {
+                    return std::binary_search (
+                        released.begin (), released.end (), slab);
+                }), slabs_.end ());
+        }
+        for (auto slab : released)
+            ::operator delete (slab);
+    }
+
+    return released.size () * slabBytes;
+}
+
+std::size_t
+SlabPool::trimAll ()
+{
+    std::lock_guard <std::mutex> lock (poolsMutex ());
+    std::size_t released = 0;
+    for (auto pool : pools ())
+        released += pool->trim ();
+    return released;
+}
+
+SlabPool::Shard&
+SlabPool::shard ()
+{
+    auto const h = std::hash <std::thread::id> () (
+        std::this_thread::get_id ());
+    return shards_[(h ^ (h >> 16)) % shardCount];
+}
+
+// Called with the shard's lock held. Blocks freed by other threads pile
+// up in their shards, so those are emptied into this one before the pool
+// grows. Busy shards are skipped, since waiting on one while holding
+// this shard's lock could deadlock.
+bool
+SlabPool::steal (Shard& shard)
+{
+    for (auto& other : shards_)
+    {
+        if (&other == &shard || ! other.lock.try_lock ())
+            continue;
+        shard.free = other.free;
+        other.free = nullptr;
+        other.lock.unlock ();
+        if (shard.free != nullptr)
+            return true;
+    }
+    return false;
+}
+
+// Called with the shard's lock held
+void
+SlabPool::grow (Shard& shard)
+{
+    auto const slab = static_cast <char*> (
+        ::operator new (blockSize_ * blocksPerSlab_));
+    {
+        std::lock_guard <std::mutex> lock (slabsMutex_);
+        slabs_.push_back (slab);
+    }
+
+    // Link the new blocks in address order
+    for (std::size_t i = blocksPerSlab_; i-- > 0;)
+    {
+        auto const block = reinterpret_cast <FreeBlock*> (
+            slab + i * blockSize_);
+        block->next = shard.free;
+        shard.free = block;
+    }
+}
+
+} // divvy
@@ -0,0 +1,182 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of divvyd: https://github.com/xdv/divvyd
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <divvy/basics/TaskPool.h>
+#include <beast/threads/Thread.h>
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+namespace divvy {
+
+TaskPool::TaskPool (int threads)
+{
+    threads_.reserve (threads);
+    for (int i = 0; i < threads; ++i)
+        threads_.emplace_back (&TaskPool::run, this);
+}
+
+TaskPool::~TaskPool ()
+{
+    {
+        std::lock_guard <std::mutex> lock (mutex_);
+        stop_ = true;
+        tasks_.clear ();
+    }
+    cond_.notify_all ();
+
+    for (auto& thread : threads_)
+        thread.join ();
+}
+
+void
+TaskPool::post (Task task)
+{
+    {
+        std::lock_guard <std::mutex> lock (mutex_);
+        tasks_.push_back (std::move (task));
+    }
+    cond_.notify_one ();
+}
+
+void
+TaskPool::run ()
+{
+    beast::Thread::setCurrentThreadName ("TaskPool");
+
+    std::unique_lock <std::mutex> lock (mutex_);
+    for (;;)
+    {
+        cond_.wait (lock, [this] { return stop_ || !tasks_.empty (); });
+        if (stop_)
+            return;
+
+        Task task = std::move (tasks_.front ());
+        tasks_.pop_front ();
+
+        lock.unlock ();
+        task ();
+        lock.lock ();
+    }
+}
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+// Shared by the caller and helpers of one forEach. Helpers which only
+// get a thread after the caller has returned find it closed.
+struct ForEachState
+{
+    std::function <void (std::size_t)> const& f;
+    std::size_t const n;
+    std::atomic <std::size_t> next;
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    int active = 0;
+    bool closed = false;
+    std::exception_ptr error;
+
+    ForEachState (std::function <void (std::size_t)> const& f_,
+            std::size_t n_)
+        : f (f_)
+        , n (n_)
+        , next (0)
+    {
+    }
+
+    void
+    run ()
+    {
+        try
+        {
+            std::size_t i;
+            while ((i = next++) < n)
+                f (i);
+        }
+        catch (...)
+        {
+            std::lock_guard <std::mutex> lock (mutex);
+            if (!error)
+                error = std::current_exception ();
+            next = n;
+        }
+    }
+};
+
+}
+
+void
+TaskPool::forEach (std::size_t n, int helpers,
+    std::function <void (std::size_t)> const& f)
+{
+    helpers = std::min <std::size_t> (
+        std::min (helpers, size ()), n > 0 ? n - 1 : 0);
+
+    if (helpers <= 0)
+    {
+        for (std::size_t i = 0; i < n; ++i)
+            f (i);
+        return;
+    }
+
+    auto const state = std::make_shared <ForEachState> (f, n);
+
+    for (int i = 0; i < helpers; ++i)
+    {
+        post ([state]
+        {
+            {
+                std::lock_guard <std::mutex> lock (state->mutex);
+                if (state->closed)
+                    return;
+                ++state->active;
+            }
+
+            state->run ();
+
+            std::lock_guard <std::mutex> lock (state->mutex);
+            if (--state->active == 0)
+                state->cond.notify_all ();
+        });
+    }
+
+    state->run ();
+
+    std::unique_lock <std::mutex> lock (state->mutex);
+    state->closed = true;
+    state->cond.wait (lock, [&state] { return state->active == 0; });
+
+    if (state->error)
+        std::rethrow_exception (state->error);
+}
+
+TaskPool&
+TaskPool::shared ()
+{
+    // Never destroyed: tasks may still be posted by static destructors
+    static TaskPool* const pool = new TaskPool (
+        std::max (1u, std::thread::hardware_concurrency ()));
+    return *pool;
+}
+
+} // divvy
@@ -0,0 +1,165 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of divvyd: https://github.com/xdv/divvyd
+    Copyright (c) 2014 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef RIPPLE_BASICS_MULDIV_H_INCLUDED
+#define RIPPLE_BASICS_MULDIV_H_INCLUDED
+
+#include <cstdint>
+#include <stdexcept>
+
+namespace divvy {
+
+namespace detail {
+
+// A 128-bit unsigned intermediate, as high and low 64-bit halves
+struct uint128_parts
+{
+    std::uint64_t hi;
+    std::uint64_t lo;
+};
+
+// Portable forms, compiled everywhere so they can be tested
+// against the native 128-bit forms where those exist.
+inline
+uint128_parts
+mul64x64Portable (std::uint64_t a, std::uint64_t b)
+{
+    std::uint64_t const aLo = a & 0xffffffff, aHi = a >> 32;
+    std::uint64_t const bLo = b & 0xffffffff, bHi = b >> 32;
+
+    std::uint64_t const ll = aLo * bLo;
+    std::uint64_t const lh = aLo * bHi;
+    std::uint64_t const hl = aHi * bLo;
+    std::uint64_t const hh = aHi * bHi;
+
+    // Sum of the middle terms and the carry out of the low word
+    std::uint64_t const mid = (ll >> 32) + (lh & 0xffffffff) + (hl & 0xffffffff);
+
+    return { hh + (lh >> 32) + (hl >> 32) + (mid >> 32),
+        (mid << 32) | (ll & 0xffffffff) };
+}
+
+// Requires v.hi < d so that the quotient fits in 64 bits
+inline
+std::uint64_t
+div128by64Portable (uint128_parts v, std::uint64_t d)
+{
+    // Restoring shift-subtract division, one quotient bit at a time
+    std::uint64_t rem = v.hi;
+    std::uint64_t quot = 0;
+    for (int i = 63; i >= 0; --i)
+    {
+        bool const carry = (rem >> 63) != 0;
+        rem = (rem << 1) | ((v.lo >> i) & 1);
+        quot <<= 1;
+        if (carry || rem >= d)
+        {
+            rem -= d;
+            quot |= 1;
+        }
+    }
+    return quot;
+}
+
+inline
+uint128_parts
+mul64x64 (std::uint64_t a, std::uint64_t b)
+{
+#ifdef __SIZEOF_INT128__
+    unsigned __int128 const p = static_cast<unsigned __int128> (a) * b;
+    return { static_cast<std::uint64_t> (p >> 64),
+        static_cast<std::uint64_t> (p) };
+#else
+    return mul64x64Portable (a, b);
+#endif
+}
+
+inline
+void
+add64 (uint128_parts& v, std::uint64_t a)
+{
+    v.lo += a;
+    if (v.lo < a)
+        ++v.hi;
+}
+
+// Requires v.hi < d so that the quotient fits in 64 bits
+inline
+std::uint64_t
+div128by64 (uint128_parts v, std::uint64_t d)
+{
+#ifdef __SIZEOF_INT128__
+    return static_cast<std::uint64_t> (
+        ((static_cast<unsigned __int128> (v.hi) << 64) | v.lo) / d);
+#else
+    return div128by64Portable (v, d);
+#endif
+}
+
+inline
+std::uint64_t
+mulDivImpl (std::uint64_t value, std::uint64_t mul, std::uint64_t div,
+    bool roundUp, bool portable)
+{
+    if (div == 0)
+        throw std::runtime_error ("mulDiv division by zero");
+
+    auto v = portable ? mul64x64Portable (value, mul) : mul64x64 (value, mul);
+
+    // Rounding down is automatic when we divide
+    if (roundUp)
+        add64 (v, div - 1);
+
+    if (v.hi >= div)
+        throw std::overflow_error ("mulDiv overflow");
+
+    return portable ? div128by64Portable (v, div) : div128by64 (v, div);
+}
+
+/** mulDiv without the compiler's 128-bit integers. */
+inline
+std::uint64_t
+mulDivPortable (std::uint64_t value, std::uint64_t mul, std::uint64_t div,
+    bool roundUp = false)
+{
+    return mulDivImpl (value, mul, div, roundUp, true);
+}
+
+} // detail
+
+/** Return (value * mul) / div with a 128-bit intermediate.
+
+    The quotient is truncated, or rounded up when roundUp is set. The
+    result is exact for every input whose quotient fits in 64 bits,
+    which is what the STAmount arithmetic relies on.
+
+    @throws std::overflow_error if the quotient does not fit
+    @throws std::runtime_error on division by zero
+*/
+inline
+std::uint64_t
+mulDiv (std::uint64_t value, std::uint64_t mul, std::uint64_t div,
+    bool roundUp = false)
+{
+    return detail::mulDivImpl (value, mul, div, roundUp, false);
+}
+
+} // divvy
+
+#endif
@@ -0,0 +1,102 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of divvyd: https://github.com/xdv/divvyd
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <divvy/basics/FrequencySketch.h>
+#include <beast/unit_test/suite.h>
+
+namespace divvy {
+
+class FrequencySketch_test : public beast::unit_test::suite
+{
+public:
+    void testEstimate ()
+    {
+        testcase ("estimate");
+
+        FrequencySketch sketch (1024);
+        expect (sketch.estimate (1) == 0);
+
+        sketch.increment (1);
+        expect (sketch.estimate (1) == 1);
+        sketch.increment (1);
+        sketch.increment (1);
+        expect (sketch.estimate (1) == 3);
+
+        // Counters saturate
+        for (int i = 0; i < 100; ++i)
+            sketch.increment (2);
+        expect (sketch.estimate (2) == FrequencySketch::maxFrequency);
+
+        // Other keys are counted separately. The sketch may
+        // overestimate, but rarely for a lightly used table.
+        int collisions = 0;
+        for (std::size_t key = 1000; key < 1100; ++key)
+            if (sketch.estimate (key) != 0)
+                ++collisions;
+        expect (collisions < 5);
+
+        sketch.clear ();
+        expect (sketch.estimate (1) == 0);
+        expect (sketch.estimate (2) == 0);
+    }
+
+    void testAging ()
+    {
+        testcase ("aging");
+
+        // Counts are halved after ten times the capacity in additions
+        FrequencySketch sketch (16);
+        for (int i = 0; i < 8; ++i)
+            sketch.increment (7);
+        expect (sketch.estimate (7) == 8);
+
+        for (std::size_t key = 100; key < 100 + 160 - 8; ++key)
+            sketch.increment (key);
+        expect (sketch.estimate (7) >= 4);
+        expect (sketch.estimate (7) < 8);
+    }
+
+    void testEmpty ()
+    {
+        testcase ("empty");
+
+        FrequencySketch sketch;
+        sketch.increment (1);
+        expect (sketch.estimate (1) == 0);
+
+        sketch.resize (64);
+        sketch.increment (1);
+        expect (sketch.estimate (1) == 1);
+
+        sketch.resize (0);
+        expect (sketch.estimate (1) == 0);
+    }
+
+    void run ()
+    {
+        testEstimate ();
+        testAging ();
+        testEmpty ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(FrequencySketch,common,divvy);
+
+}
@@ -88,6 +88,31 @@ public:
             c.sweep ();
             expect (c.size () < 3);
         }
+
+        // Insert four items with a budget of two, the oldest go
+        {
+            Cache c ("test", clock, 0, 60);
+
+            expect (c.insert ("one"));
+            ++clock;
+            expect (c.insert ("two"));
+            ++clock;
+            expect (c.insert ("three"));
+            ++clock;
+            expect (c.insert ("four"));
+            expect (c.bytes () == 4 * Cache::entryBytes);
+            c.sweep ();
+            expect (c.size () == 4);
+
+            c.setTargetBytes (2 * Cache::entryBytes);
+            c.sweep ();
+            expect (c.size () == 2);
+            expect (c.bytes () == 2 * Cache::entryBytes);
+            expect (! c.exists ("one"));
+            expect (! c.exists ("two"));
+            expect (c.exists ("three"));
+            expect (c.exists ("four"));
+        }
     }
 };
 
@@ -0,0 +1,127 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of divvyd: https://github.com/xdv/divvyd
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <divvy/basics/ShardedTaggedCache.h>
+#include <beast/unit_test/suite.h>
+#include <beast/chrono/manual_clock.h>
+#include <string>
+
+namespace divvy {
+
+class ShardedTaggedCache_test : public beast::unit_test::suite
+{
+public:
+    void run ()
+    {
+        beast::Journal const j;
+
+        beast::manual_clock <std::chrono::steady_clock> clock;
+        clock.set (0);
+
+        using Key = int;
+        using Value = std::string;
+        using Cache = ShardedTaggedCache <Key, Value>;
+
+        Cache c ("test", 64, 1, clock, j);
+
+        // Fill every shard, then age everything out
+        {
+            for (int i = 0; i < 256; ++i)
+                expect (! c.insert (i, std::to_string (i)));
+            expect (c.getCacheSize() == 256);
+            expect (c.getTrackSize() == 256);
+
+            for (int i = 0; i < 256; ++i)
+            {
+                std::string s;
+                expect (c.retrieve (i, s));
+                expect (s == std::to_string (i));
+            }
+            expect (c.getHitRate() == 100.0f);
+
+            ++clock;
+            c.sweep ();
+            expect (c.getCacheSize () == 0);
+            expect (c.getTrackSize () == 0);
+        }
+
+        // Target size is kept for the whole cache
+        {
+            expect (c.getTargetSize () == 64);
+            c.setTargetSize (1024);
+            expect (c.getTargetSize () == 1024);
+        }
+
+        // The byte budget is kept for the whole cache and the
+        // bytes held are summed over the shards
+        {
+            expect (c.getTargetBytes () == 0);
+            expect (c.getCacheBytes () == 0);
+            for (int i = 0; i < 64; ++i)
+                expect (! c.insert (i, std::to_string (i)));
+            expect (c.getCacheBytes () >= 64 * sizeof (Value));
+
+            c.setTargetBytes (1);
+            expect (c.getTargetBytes () == 1);
+            c.sweep ();
+            expect (c.getCacheSize () == 0);
+            expect (c.getCacheBytes () == 0);
+
+            c.setTargetBytes (0);
+        }
+
+        // Canonicalize returns the original object, even after it
+        // was swept out of the cache while a reference was held.
+        {
+            expect (! c.insert (4, "four"));
+
+            {
+                Cache::mapped_ptr p1 (c.fetch (4));
+                expect (p1 != nullptr);
+                ++clock;
+                c.sweep ();
+                expect (c.getCacheSize() == 0);
+                expect (c.getTrackSize() == 1);
+
+                Cache::mapped_ptr p2 (std::make_shared <Value> ("four"));
+                expect (c.canonicalize (4, p2, false));
+                expect (c.getCacheSize() == 1);
+                expect (p1.get() == p2.get());
+            }
+
+            ++clock;
+            c.sweep ();
+            expect (c.getCacheSize() == 0);
+            expect (c.getTrackSize() == 0);
+        }
+
+        // Deleted keys are gone from their shard
+        {
+            expect (! c.insert (5, "five"));
+            expect (c.del (5, false));
+            expect (c.fetch (5) == nullptr);
+            expect (c.getTrackSize() == 0);
+        }
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(ShardedTaggedCache,common,divvy);
+
+}
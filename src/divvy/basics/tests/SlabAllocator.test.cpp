@@ -0,0 +1,220 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of divvyd: https://github.com/xdv/divvyd
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <divvy/basics/SlabAllocator.h>
+#include <beast/unit_test/suite.h>
+#include <atomic>
+#include <cstdint>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace divvy {
+
+class SlabAllocator_test : public beast::unit_test::suite
+{
+public:
+    void testPool ()
+    {
+        testcase ("pool");
+
+        SlabPool pool (24, 1024);
+        expect (pool.blockSize () >= 24);
+        expect (pool.blockSize () % alignof (std::max_align_t) == 0);
+        expect (pool.slabs () == 0);
+
+        std::size_t const perSlab = 1024 / pool.blockSize ();
+
+        std::set <void*> blocks;
+        for (std::size_t i = 0; i < perSlab; ++i)
+            blocks.insert (pool.allocate ());
+        expect (blocks.size () == perSlab);
+        expect (pool.inUse () == perSlab);
+        expect (pool.slabs () == 1);
+
+        // The next block needs a new slab
+        void* extra = pool.allocate ();
+        expect (blocks.count (extra) == 0);
+        expect (pool.slabs () == 2);
+
+        // Freed blocks are reused before the pool grows
+        pool.deallocate (extra);
+        expect (pool.allocate () == extra);
+        expect (pool.slabs () == 2);
+
+        pool.deallocate (extra);
+        for (auto p : blocks)
+            pool.deallocate (p);
+        expect (pool.inUse () == 0);
+        expect (pool.slabs () == 2);
+
+        // Trimming only releases slabs with no block in use
+        std::size_t const slabBytes = perSlab * pool.blockSize ();
+        void* kept = pool.allocate ();
+        expect (pool.trim () == slabBytes);
+        expect (pool.slabs () == 1);
+        expect (pool.trim () == 0);
+        pool.deallocate (kept);
+        expect (pool.trim () == slabBytes);
+        expect (pool.slabs () == 0);
+        expect (pool.inUse () == 0);
+    }
+
+    void testThreads ()
+    {
+        testcase ("threads");
+
+        SlabPool pool (24, 1024);
+        std::size_t const count = 4 * (1024 / pool.blockSize ());
+
+        // Blocks freed on one thread are reused by another
+        // instead of growing the pool
+        std::vector <void*> blocks;
+        for (int round = 0; round < 10; ++round)
+        {
+            std::thread ([&]()
+            {
+                for (std::size_t i = 0; i < count; ++i)
+                    blocks.push_back (pool.allocate ());
+            }).join ();
+            std::thread ([&]()
+            {
+                for (auto p : blocks)
+                    pool.deallocate (p);
+            }).join ();
+            blocks.clear ();
+        }
+        expect (pool.slabs () == 4);
+        expect (pool.inUse () == 0);
+
+        // Trimming while other threads allocate and free
+        std::atomic <bool> done (false);
+        std::atomic <int> errors (0);
+        std::thread trimmer ([&]()
+        {
+            while (! done)
+                pool.trim ();
+        });
+        std::vector <std::thread> threads;
+        for (int t = 0; t < 4; ++t)
+        {
+            threads.emplace_back ([&pool, &errors, t]()
+            {
+                std::vector <std::uint64_t*> v;
+                for (int round = 0; round < 200; ++round)
+                {
+                    for (int i = 0; i < 100; ++i)
+                    {
+                        v.push_back (static_cast <std::uint64_t*> (
+                            pool.allocate ()));
+                        *v.back () = t * 1000 + i;
+                    }
+                    for (int i = 0; i < 100; ++i)
+                    {
+                        if (*v[i] != std::uint64_t (t * 1000 + i))
+                            ++errors;
+                        pool.deallocate (v[i]);
+                    }
+                    v.clear ();
+                }
+            });
+        }
+        for (auto& thread : threads)
+            thread.join ();
+        done = true;
+        trimmer.join ();
+        expect (errors == 0);
+        expect (pool.inUse () == 0);
+        pool.trim ();
+        expect (pool.slabs () == 0);
+    }
+
+    struct Probe
+    {
+        static std::atomic <int> live;
+        std::uint64_t value[5];
+
+        explicit Probe (std::uint64_t v)
+        {
+            for (auto& x : value)
+                x = v;
+            ++live;
+        }
+
+        ~Probe ()
+        {
+            --live;
+        }
+    };
+
+    void testShared ()
+    {
+        testcase ("shared");
+
+        {
+            auto p = make_pooled <Probe> (7);
+            expect (Probe::live == 1);
+            expect (p->value[4] == 7);
+
+            std::shared_ptr <Probe> q = p;
+            p.reset ();
+            expect (Probe::live == 1);
+            q.reset ();
+            expect (Probe::live == 0);
+        }
+
+        // Many threads allocating and freeing at once
+        std::vector <std::thread> threads;
+        std::atomic <int> errors (0);
+        for (int t = 0; t < 4; ++t)
+        {
+            threads.emplace_back ([&errors, t]()
+            {
+                std::vector <std::shared_ptr <Probe>> v;
+                for (int round = 0; round < 20; ++round)
+                {
+                    for (int i = 0; i < 500; ++i)
+                        v.push_back (make_pooled <Probe> (t * 1000 + i));
+                    for (int i = 0; i < 500; ++i)
+                        if (v[i]->value[0] != std::uint64_t (t * 1000 + i))
+                            ++errors;
+                    v.clear ();
+                }
+            });
+        }
+        for (auto& thread : threads)
+            thread.join ();
+        expect (errors == 0);
+        expect (Probe::live == 0);
+    }
+
+    void run ()
+    {
+        testPool ();
+        testThreads ();
+        testShared ();
+    }
+};
+
+std::atomic <int> SlabAllocator_test::Probe::live (0);
+
+BEAST_DEFINE_TESTSUITE(SlabAllocator,common,divvy);
+
+}
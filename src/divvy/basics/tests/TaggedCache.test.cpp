@@ -143,6 +143,103 @@ public:
             expect (c.getCacheSize() == 0);
             expect (c.getTrackSize() == 0);
         }
+
+        // Give the cache a byte budget and make sure the large, idle
+        // object is evicted before the small, recently used ones.
+        {
+            Cache b ("bytes", 0, 60, clock, j);
+            expect (b.getCacheBytes () == 0);
+            expect (! b.insert (1, std::string (4096, 'x')));
+            std::size_t const big = b.getCacheBytes ();
+            expect (big > 4096);
+
+            ++clock;
+            expect (! b.insert (2, "two"));
+            expect (! b.insert (3, "three"));
+            expect (! b.insert (4, "four"));
+            std::size_t const all = b.getCacheBytes ();
+            expect (all > big);
+
+            // No budget, nothing is old enough to expire
+            ++clock;
+            b.sweep ();
+            expect (b.getCacheSize () == 4);
+            expect (b.getCacheBytes () == all);
+
+            b.setTargetBytes (all - big);
+            expect (b.getTargetBytes () == all - big);
+            b.sweep ();
+            expect (b.getCacheSize () == 3);
+            expect (b.getTrackSize () == 3);
+            expect (b.getCacheBytes () == all - big);
+            expect (b.fetch (1) == nullptr);
+            expect (b.fetch (2) != nullptr);
+
+            std::size_t const before = b.getCacheBytes ();
+            expect (b.del (2, false));
+            expect (b.getCacheBytes () < before);
+
+            b.clear ();
+            expect (b.getCacheBytes () == 0);
+        }
+
+        // Among many equally idle objects, the largest go first
+        {
+            Cache b ("many", 0, 60, clock, j);
+            std::size_t keep = 0;
+            for (int i = 1; i <= 100; ++i)
+            {
+                b.insert (i, std::string (i * 10, 'x'));
+                if (i == 50)
+                    keep = b.getCacheBytes ();
+            }
+
+            ++clock;
+            b.setTargetBytes (keep);
+            b.sweep ();
+            expect (b.getCacheSize () == 50);
+            expect (b.getCacheBytes () == keep);
+            expect (b.fetch (50) != nullptr);
+            expect (b.fetch (51) == nullptr);
+        }
+
+        // With admission enabled, a full cache only takes objects
+        // which have been fetched before.
+        {
+            Cache a ("admit", 2, 60, clock, j);
+            a.setAdmission (true);
+
+            Cache::mapped_ptr p1 (std::make_shared <Value> ("one"));
+            Cache::mapped_ptr p2 (std::make_shared <Value> ("two"));
+            expect (! a.admit (1, p1));
+            expect (! a.admit (2, p2));
+            expect (a.getCacheSize () == 2);
+
+            // Missed once, turned away
+            expect (a.fetch (3) == nullptr);
+            Cache::mapped_ptr p3 (std::make_shared <Value> ("three"));
+            expect (! a.admit (3, p3));
+            expect (a.getCacheSize () == 2);
+            expect (a.getTrackSize () == 2);
+            expect (a.getRejections () == 1);
+
+            // Missed twice, admitted
+            expect (a.fetch (3) == nullptr);
+            expect (! a.admit (3, p3));
+            expect (a.getCacheSize () == 3);
+            expect (a.fetch (3) == p3);
+
+            // Present keys are canonicalized as usual
+            Cache::mapped_ptr p4 (std::make_shared <Value> ("one"));
+            expect (a.admit (1, p4));
+            expect (p4 == p1);
+
+            // Without admission, everything goes in
+            a.setAdmission (false);
+            Cache::mapped_ptr p5 (std::make_shared <Value> ("five"));
+            expect (! a.admit (5, p5));
+            expect (a.getCacheSize () == 4);
+        }
     }
 };
 
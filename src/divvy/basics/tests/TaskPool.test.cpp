@@ -0,0 +1,118 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of divvyd: https://github.com/xdv/divvyd
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <divvy/basics/TaskPool.h>
+#include <beast/unit_test/suite.h>
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+namespace divvy {
+
+class TaskPool_test : public beast::unit_test::suite
+{
+public:
+    void testPost ()
+    {
+        testcase ("post");
+
+        std::mutex mutex;
+        std::condition_variable cond;
+        int done = 0;
+        {
+            TaskPool pool (3);
+            expect (pool.size () == 3);
+            for (int i = 0; i < 100; ++i)
+            {
+                pool.post ([&]
+                {
+                    std::lock_guard <std::mutex> lock (mutex);
+                    ++done;
+                    cond.notify_all ();
+                });
+            }
+
+            std::unique_lock <std::mutex> lock (mutex);
+            cond.wait (lock, [&done] { return done == 100; });
+        }
+        expect (done == 100);
+    }
+
+    void testForEach ()
+    {
+        testcase ("forEach");
+
+        TaskPool pool (4);
+
+        std::vector <std::atomic <int>> hits (1000);
+        for (auto& h : hits)
+            h = 0;
+        pool.forEach (hits.size (), 3,
+            [&hits] (std::size_t i) { ++hits[i]; });
+
+        bool once = true;
+        for (auto const& h : hits)
+            once = once && h == 1;
+        expect (once, "every index runs exactly once");
+
+        // No helpers runs everything on the caller
+        std::thread::id const caller = std::this_thread::get_id ();
+        bool inline_ = true;
+        pool.forEach (10, 0, [&] (std::size_t)
+        {
+            inline_ = inline_ && std::this_thread::get_id () == caller;
+        });
+        expect (inline_);
+
+        // Errors come back to the caller
+        bool caught = false;
+        try
+        {
+            pool.forEach (100, 3, [] (std::size_t i)
+            {
+                if (i == 50)
+                    throw std::runtime_error ("forEach");
+            });
+        }
+        catch (std::runtime_error const&)
+        {
+            caught = true;
+        }
+        expect (caught);
+
+        // Nested calls on a busy pool still finish
+        std::atomic <int> inner (0);
+        pool.forEach (8, 4, [&] (std::size_t)
+        {
+            pool.forEach (8, 4, [&] (std::size_t) { ++inner; });
+        });
+        expect (inner == 64);
+    }
+
+    void run ()
+    {
+        testPost ();
+        testForEach ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(TaskPool,common,divvy);
+
+}
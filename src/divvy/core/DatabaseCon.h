@@ -23,8 +23,11 @@
 #include <divvy/core/Config.h>
 #include <divvy/core/SociDB.h>
 #include <boost/filesystem/path.hpp>
+#include <atomic>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <vector>
 
 
 namespace soci {
@@ -46,6 +49,10 @@ public:
     LockedPointer (T* it, mutex& m) : it_ (it), lock_ (m)
     {
     }
+    LockedPointer (T* it, std::unique_lock<mutex>&& lock)
+        : it_ (it), lock_ (std::move (lock))
+    {
+    }
     LockedPointer (LockedPointer&& rhs) noexcept
         : it_ (rhs.it_), lock_ (std::move (rhs.lock_))
     {
@@ -82,6 +89,11 @@ public:
         Config::StartUpType startUp = Config::NORMAL;
         bool standAlone = false;
         boost::filesystem::path dataDir;
+
+        /** Number of read-only sessions to open for queries.
+            Zero sends reads through the writer session.
+        */
+        std::size_t readers = 0;
     };
 
     DatabaseCon (Setup const& setup,
@@ -94,18 +106,43 @@ public:
         return session_;
     }
 
+    /** Check out the writer session.
+        Anything that modifies the database must use this session.
+    */
     LockedSociSession checkoutDb ()
     {
         return LockedSociSession (&session_, lock_);
     }
 
+    /** Check out a session for queries that do not modify the database.
+        Read sessions come from a pool of read-only connections to the
+        same file. In WAL mode they run concurrently with each other and
+        with the writer. Without a pool this is the writer session.
+    */
+    LockedSociSession checkoutReadDb ();
+
+    /** Run a PRAGMA on the writer and on every read session.
+        Settings such as cache_size belong to the session that sets
+        them, so the readers need them as well.
+    */
+    void pragma (std::string const& sql);
+
     void setupCheckpointing (JobQueue*);
 
 private:
+    struct Reader
+    {
+        LockedSociSession::mutex lock;
+        soci::session session;
+    };
+
     LockedSociSession::mutex lock_;
 
     soci::session session_;
     std::unique_ptr<Checkpointer> checkpointer_;
+
+    std::vector<std::unique_ptr<Reader>> readers_;
+    std::atomic<std::size_t> nextReader_;
 };
 
 DatabaseCon::Setup
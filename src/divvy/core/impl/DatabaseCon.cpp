@@ -22,6 +22,7 @@
 #include <divvy/core/SociDB.h>
 #include <divvy/basics/Log.h>
 #include <beast/cxx14/memory.h>  // <memory>
+#include <cstring>
 
 namespace divvy {
 
@@ -30,6 +31,7 @@ DatabaseCon::DatabaseCon (
     std::string const& strName,
     const char* initStrings[],
     int initCount)
+    : nextReader_ (0)
 {
     auto const useTempFiles  // Use temporary files or regular DB files?
         = setup.standAlone &&
@@ -52,6 +54,69 @@ DatabaseCon::DatabaseCon (
             // ignore errors
         }
     }
+
+    // A temporary database is private to its connection,
+    // so only a database file can be shared with readers
+    if (pPath.empty ())
+        return;
+
+    readers_.reserve (setup.readers);
+    for (std::size_t n = 0; n < setup.readers; ++n)
+    {
+        auto reader = std::make_unique<Reader> ();
+        open (reader->session, "sqlite", pPath.string());
+
+        // Connection settings such as the page cache and mmap
+        // size are per session, so apply them here too
+        for (int i = 0; i < initCount; ++i)
+        {
+            if (std::strncmp (initStrings[i], "PRAGMA", 6) != 0)
+                continue;
+            try
+            {
+                reader->session << initStrings[i];
+            }
+            catch (soci::soci_error&)
+            {
+                // ignore errors
+            }
+        }
+
+        reader->session << "PRAGMA query_only=1;";
+        readers_.push_back (std::move (reader));
+    }
+}
+
+LockedSociSession DatabaseCon::checkoutReadDb ()
+{
+    if (readers_.empty ())
+        return checkoutDb ();
+
+    // Take the first idle reader, starting from a different
+    // one each time to spread the load
+    std::size_t const start = nextReader_++ % readers_.size ();
+    for (std::size_t i = 0; i < readers_.size (); ++i)
+    {
+        auto& reader = *readers_[(start + i) % readers_.size ()];
+        std::unique_lock<LockedSociSession::mutex> lock (
+            reader.lock, std::try_to_lock);
+        if (lock.owns_lock ())
+            return LockedSociSession (&reader.session, std::move (lock));
+    }
+
+    // Every reader is busy, wait for ours
+    auto& reader = *readers_[start];
+    return LockedSociSession (&reader.session, reader.lock);
+}
+
+void DatabaseCon::pragma (std::string const& sql)
+{
+    *checkoutDb () << sql;
+    for (auto& reader : readers_)
+    {
+        std::lock_guard<LockedSociSession::mutex> lock (reader->lock);
+        reader->session << sql;
+    }
 }
 
 DatabaseCon::Setup setup_DatabaseCon (Config const& c)
@@ -61,6 +126,7 @@ DatabaseCon::Setup setup_DatabaseCon (Config const& c)
     setup.startUp = c.START_UP;
     setup.standAlone = c.RUN_STANDALONE;
     setup.dataDir = c.legacy ("database_path");
+    setup.readers = get<std::size_t> (c.section ("sqdb"), "readers", 4);
 
     return setup;
 }
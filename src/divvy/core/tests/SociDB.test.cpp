@@ -20,6 +20,7 @@
 #include <BeastConfig.h>
 
 #include <divvy/core/ConfigSections.h>
+#include <divvy/core/DatabaseCon.h>
 #include <divvy/core/SociDB.h>
 #include <divvy/basics/TestSuite.h>
 #include <divvy/basics/BasicConfig.h>
@@ -361,12 +362,89 @@ public:
         if (is_regular_file (dbPath))
             remove (dbPath);
     }
+    void testDatabaseConReaders ()
+    {
+        testcase ("readers");
+        DatabaseCon::Setup setup;
+        setup.dataDir = getDatabasePath ();
+        setup.readers = 2;
+        const char* dbInit[] = {
+            "PRAGMA journal_mode=WAL;",
+            "CREATE TABLE IF NOT EXISTS Ledgers (       \
+                LedgerHash      CHARACTER(64) PRIMARY KEY,  \
+                LedgerSeq       BIGINT UNSIGNED             \
+            );"};
+        int const dbInitCount = std::extent<decltype(dbInit)>::value;
+        {
+            DatabaseCon dbCon (setup, "DatabaseConTest.db",
+                dbInit, dbInitCount);
+
+            auto writer = dbCon.checkoutDb ();
+            *writer << "BEGIN TRANSACTION;";
+            *writer << "INSERT INTO Ledgers VALUES ('a', 1);";
+
+            // Readers are not blocked by an open write transaction
+            // and only see what has been committed
+            int count = -1;
+            {
+                auto reader = dbCon.checkoutReadDb ();
+                *reader << "SELECT COUNT(*) FROM Ledgers;", soci::into (count);
+            }
+            expect (count == 0, "reader saw uncommitted data");
+
+            *writer << "COMMIT;";
+            {
+                auto r1 = dbCon.checkoutReadDb ();
+                auto r2 = dbCon.checkoutReadDb ();
+                expect (r1.get () != r2.get (), "readers not pooled");
+                expect (r1.get () != writer.get (), "reader is the writer");
+                *r2 << "SELECT COUNT(*) FROM Ledgers;", soci::into (count);
+                expect (count == 1, "reader missed committed data");
+
+                bool threw = false;
+                try
+                {
+                    *r1 << "INSERT INTO Ledgers VALUES ('b', 2);";
+                }
+                catch (soci::soci_error&)
+                {
+                    threw = true;
+                }
+                expect (threw, "reader is writable");
+            }
+
+            // Connection settings reach every session
+            dbCon.pragma ("PRAGMA cache_size=-1234;");
+            {
+                auto r1 = dbCon.checkoutReadDb ();
+                auto r2 = dbCon.checkoutReadDb ();
+                int s1 = 0;
+                int s2 = 0;
+                *r1 << "PRAGMA cache_size;", soci::into (s1);
+                *r2 << "PRAGMA cache_size;", soci::into (s2);
+                expect (s1 == -1234 && s2 == -1234,
+                    "reader cache size not set");
+            }
+            int size = 0;
+            *writer << "PRAGMA cache_size;", soci::into (size);
+            expect (size == -1234, "writer cache size not set");
+        }
+        using namespace boost::filesystem;
+        path dbPath (getDatabasePath () / "DatabaseConTest.db");
+        for (auto const suffix : {"", "-wal", "-shm"})
+        {
+            path p (dbPath.string () + suffix);
+            if (is_regular_file (p))
+                remove (p);
+        }
+    }
     void testSQLite ()
     {
         testSQLiteFileNames ();
         testSQLiteSession ();
         testSQLiteSelect ();
         testSQLiteDeleteWithSubselect();
+        testDatabaseConReaders ();
     }
     void run ()
     {
@@ -70,10 +70,18 @@ public:
     bool
     canFetchBatch() = 0;
 
-    /** Fetch a batch synchronously. */
+    /** Fetch a batch synchronously.
+        @note This will be called concurrently.
+        @param n The number of keys.
+        @param keys Pointers to the key data.
+        @param status [out] The result for each key, in the same order.
+        @return One entry per key, in the same order. An entry is
+                `nullptr` unless its status is `ok`.
+    */
     virtual
     std::vector<std::shared_ptr<NodeObject>>
-    fetchBatch (std::size_t n, void const* const* keys) = 0;
+    fetchBatch (std::size_t n, void const* const* keys,
+        std::vector<Status>& status) = 0;
 
     /** Store a single object.
         Depending on the implementation this may happen immediately
@@ -84,8 +92,8 @@ public:
     virtual void store (std::shared_ptr<NodeObject> const& object) = 0;
 
     /** Store a group of objects.
-        @note This function will not be called concurrently with
-              itself or @ref store.
+        @note This function may be called concurrently with itself
+              or @ref store.
     */
     virtual void storeBatch (Batch const& batch) = 0;
 
@@ -100,9 +108,22 @@ public:
     /** Estimate the number of write operations pending. */
     virtual int getWriteLoad () = 0;
 
+    /** Estimate the number of objects stored.
+        This is taken from the backend's own bookkeeping, without
+        visiting the objects, and may be off in either direction.
+    */
+    virtual std::size_t estimateKeys () = 0;
+
     /** Remove contents on disk upon destruction. */
     virtual void setDeletePath() = 0;
 
+    /** Make previously stored objects durable.
+        Backends which buffer writes in memory without a log flush them
+        to disk here. Backends whose writes are already durable do nothing.
+        @note This may block until the flush completes.
+    */
+    virtual void sync() = 0;
+
     /** Perform consistency checks on database .*/
     virtual void verify() = 0;
 };
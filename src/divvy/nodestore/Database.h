@@ -65,26 +65,48 @@ public:
         database during the fetch, or failed to load correctly during the fetch,
         `nullptr` is returned.
 
+        An object loaded from the backend is added to the cache if the
+        cache's admission policy accepts it, unless the calling thread
+        holds a ScopedUncachedReads.
+
         @note This can be called concurrently.
+        @see ScopedUncachedReads
         @param hash The key of the object to retrieve.
         @return The object, or nullptr if it couldn't be retrieved.
     */
     virtual std::shared_ptr<NodeObject> fetch (uint256 const& hash) = 0;
 
+    /** Fetch a batch of objects.
+        Objects which are not in the cache are retrieved from the backend
+        together, which is considerably cheaper than fetching them one at
+        a time when the backend supports batch fetches.
+
+        @note This can be called concurrently.
+        @param hashes The keys of the objects to retrieve.
+        @return One entry per key, in the same order. An entry is `nullptr`
+                if the corresponding object couldn't be retrieved.
+    */
+    virtual std::vector<std::shared_ptr<NodeObject>> fetchBatch (
+        std::vector<uint256> const& hashes) = 0;
+
     /** Fetch an object without waiting.
         If I/O is required to determine whether or not the object is present,
         `false` is returned. Otherwise, `true` is returned and `object` is set
         to refer to the object, or `nullptr` if the object is not present.
-        If I/O is required, the I/O is scheduled.
+        If I/O is required, the I/O is scheduled at the calling thread's
+        read priority.
 
         @note This can be called concurrently.
+        @see ScopedReadPriority
         @param hash The key of the object to retrieve
         @param object The object retrieved
         @return Whether the operation completed
     */
     virtual bool asyncFetch (uint256 const& hash, std::shared_ptr<NodeObject>& object) = 0;
 
-    /** Wait for all currently pending async reads to complete.
+    /** Wait for currently pending async reads to complete.
+        Only reads at the calling thread's read priority or a more
+        urgent one are waited for.
     */
     virtual void waitReads () = 0;
 
@@ -109,6 +131,25 @@ public:
                         Blob&& data,
                         uint256 const& hash) = 0;
 
+    /** Store a group of objects.
+        Each object is canonicalized into the positive cache and the
+        whole group is handed to the backend in a single write, which
+        is cheaper than storing the objects one at a time.
+
+        @param batch The objects to store.
+    */
+    virtual void storeBatch (Batch const& batch) = 0;
+
+    /** Store a group of objects without waiting for the write.
+        Each object is canonicalized into the positive cache, so it can
+        be fetched at once, and the group is queued to be written to the
+        backend by a scheduled task.
+
+        @see sync
+        @param batch The objects to store.
+    */
+    virtual void asyncStoreBatch (Batch const& batch) = 0;
+
     /** Visit every object in the database
         This is usually called during import.
 
@@ -126,6 +167,12 @@ public:
     */
     virtual std::int32_t getWriteLoad() const = 0;
 
+    /** Make previously stored objects durable.
+        This is called when a ledger is validated.
+        @see Backend::sync
+    */
+    virtual void sync() = 0;
+
     /** Get the positive cache hits to total attempts ratio. */
     virtual float getCacheHitRate () = 0;
 
@@ -136,9 +183,21 @@ public:
     */
     virtual void tune (int size, int age) = 0;
 
+    /** Set the memory budget of the positive cache.
+
+        @param bytes Approximate bytes held by cached objects (0 = ignore)
+    */
+    virtual void tuneBytes (std::size_t bytes) = 0;
+
+    /** Return the approximate bytes held by the positive and negative caches. */
+    virtual std::size_t getCacheBytes () = 0;
+
     /** Remove expired entries from the positive and negative caches. */
     virtual void sweep () = 0;
 
+    /** Return the keys of the objects in the positive cache. */
+    virtual std::vector <uint256> getCacheKeys () = 0;
+
     /** Gather statistics pertaining to read and write activities.
         Return the reads and writes, and total read and written bytes.
      */
@@ -21,6 +21,7 @@
 #define RIPPLE_NODESTORE_DATABASEROTATING_H_INCLUDED
 
 #include <divvy/nodestore/Database.h>
+#include <divvy/basics/ShardedTaggedCache.h>
 
 namespace divvy {
 namespace NodeStore {
@@ -35,7 +36,7 @@ class DatabaseRotating
 public:
     virtual ~DatabaseRotating() = default;
 
-    virtual TaggedCache <uint256, NodeObject>& getPositiveCache() = 0;
+    virtual ShardedTaggedCache <uint256, NodeObject>& getPositiveCache() = 0;
 
     virtual std::mutex& peekMutex() const = 0;
 
@@ -48,6 +49,12 @@ public:
 
     /** Ensure that node is in writableBackend */
     virtual std::shared_ptr<NodeObject> fetchNode (uint256 const& hash) = 0;
+
+    /** Ensure that a batch of nodes is in writableBackend
+        Nodes found only in the archive are written in a single batch.
+    */
+    virtual std::vector<std::shared_ptr<NodeObject>> fetchNodes (
+        std::vector<uint256> const& hashes) = 0;
 };
 
 }
@@ -0,0 +1,56 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of divvyd: https://github.com/xdv/divvyd
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef RIPPLE_NODESTORE_HOTKEYS_H_INCLUDED
+#define RIPPLE_NODESTORE_HOTKEYS_H_INCLUDED
+
+#include <divvy/nodestore/Database.h>
+#include <divvy/basics/base_uint.h>
+#include <string>
+#include <vector>
+
+namespace divvy {
+namespace NodeStore {
+
+/** Write the keys of objects worth having in cache after a restart.
+    Duplicates are dropped and at most hotKeysMax keys are written,
+    earlier ones first.
+    @return `true` if the file was written.
+*/
+bool
+saveHotKeys (std::string const& path, std::vector <uint256> const& keys);
+
+/** Read keys written by saveHotKeys.
+    @return The keys, or none if the file is missing or not ours.
+*/
+std::vector <uint256>
+loadHotKeys (std::string const& path);
+
+/** Read objects into the database's cache ahead of use.
+    Reads are queued through asyncFetch, so the database's read threads
+    perform them in parallel. Returns once they have been done.
+    @return The number of keys which were not already cached.
+*/
+std::size_t
+prefetchHotKeys (Database& db, std::vector <uint256> const& keys);
+
+}
+}
+
+#endif
@@ -105,6 +105,16 @@ private:
     Blob mData;
 };
 
+/** Returns the approximate memory used by a NodeObject.
+    @see cacheFootprint
+*/
+inline
+std::size_t
+cacheFootprint (NodeObject const& object)
+{
+    return sizeof (object) + object.getData ().capacity ();
+}
+
 }
 
 #endif
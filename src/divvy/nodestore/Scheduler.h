@@ -30,6 +30,10 @@ namespace NodeStore {
 struct FetchReport
 {
     std::chrono::milliseconds elapsed;
+
+    // The number of objects read, more than one for a batch
+    int fetchCount;
+
     bool isAsync;
     bool wentToDisk;
     bool wasFound;
@@ -0,0 +1,53 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of divvyd: https://github.com/xdv/divvyd
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef RIPPLE_NODESTORE_SCOPEDREADPRIORITY_H_INCLUDED
+#define RIPPLE_NODESTORE_SCOPEDREADPRIORITY_H_INCLUDED
+
+#include <divvy/nodestore/Types.h>
+
+namespace divvy {
+namespace NodeStore {
+
+/** RAII setting of the priority of async reads made by the calling thread.
+    Without one, a thread's async reads have priority readAcquire.
+*/
+class ScopedReadPriority
+{
+private:
+    ScopedReadPriority* prev_;
+    ReadPriority priority_;
+
+public:
+    explicit ScopedReadPriority (ReadPriority priority);
+    ~ScopedReadPriority ();
+
+    ScopedReadPriority (ScopedReadPriority const&) = delete;
+    ScopedReadPriority& operator= (ScopedReadPriority const&) = delete;
+
+    /** Return the priority of the calling thread's async reads. */
+    static
+    ReadPriority
+    get ();
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,57 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of divvyd: https://github.com/xdv/divvyd
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef RIPPLE_NODESTORE_SCOPEDUNCACHEDREADS_H_INCLUDED
+#define RIPPLE_NODESTORE_SCOPEDUNCACHEDREADS_H_INCLUDED
+
+namespace divvy {
+namespace NodeStore {
+
+/** RAII marking of the calling thread's reads as uncached.
+
+    While one exists, objects that Database::fetch and Database::fetchBatch
+    load from the backend are returned without being added to the positive
+    cache, and SHAMap does not add the tree nodes built from them to the
+    tree node cache. Objects which are already cached are still used.
+
+    Jobs that walk a whole ledger, and so touch each object once, use this
+    to avoid pushing the working set out of the caches.
+*/
+class ScopedUncachedReads
+{
+private:
+    ScopedUncachedReads* prev_;
+
+public:
+    ScopedUncachedReads ();
+    ~ScopedUncachedReads ();
+
+    ScopedUncachedReads (ScopedUncachedReads const&) = delete;
+    ScopedUncachedReads& operator= (ScopedUncachedReads const&) = delete;
+
+    /** Return `true` if the calling thread's reads are uncached. */
+    static
+    bool
+    active ();
+};
+
+}
+}
+
+#endif
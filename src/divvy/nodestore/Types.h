@@ -48,6 +48,19 @@ enum Status
 
 /** A batch of NodeObjects to write at once. */
 using Batch = std::vector <std::shared_ptr<NodeObject>>;
+
+/** How urgently an asynchronous read is needed.
+    Queued reads of a more urgent class are always serviced first.
+    @see ScopedReadPriority
+*/
+enum ReadPriority
+{
+    readCritical,       // The consensus round is waiting on it
+    readAcquire,        // Acquiring a recent ledger
+    readBackground,     // History backfill, RPC and other bulk prefetch
+
+    readPriorityCount
+};
 }
 }
 
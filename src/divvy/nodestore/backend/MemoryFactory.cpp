@@ -135,7 +135,8 @@ public:
     }
 
     std::vector<std::shared_ptr<NodeObject>>
-    fetchBatch (std::size_t n, void const* const* keys) override
+    fetchBatch (std::size_t n, void const* const* keys,
+        std::vector<Status>& status) override
     {
         throw std::runtime_error("pure virtual called");
         return {};
@@ -168,11 +169,23 @@ public:
         return 0;
     }
 
+    std::size_t
+    estimateKeys() override
+    {
+        std::lock_guard<std::mutex> _(db_->mutex);
+        return db_->table.size ();
+    }
+
     void
     setDeletePath() override
     {
     }
 
+    void
+    sync() override
+    {
+    }
+
     void
     verify() override
     {
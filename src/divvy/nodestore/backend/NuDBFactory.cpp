@@ -19,9 +19,11 @@
 
 #include <BeastConfig.h>
 
+#include <divvy/basics/TaskPool.h>
 #include <divvy/nodestore/Factory.h>
 #include <divvy/nodestore/Manager.h>
 #include <divvy/nodestore/impl/codec.h>
+#include <divvy/nodestore/impl/CompressionDictionary.h>
 #include <divvy/nodestore/impl/DecodedBlob.h>
 #include <divvy/nodestore/impl/EncodedBlob.h>
 #include <beast/nudb.h>
@@ -29,12 +31,15 @@
 #include <beast/nudb/visit.h>
 #include <beast/hash/xxhasher.h>
 #include <boost/filesystem.hpp>
+#include <algorithm>
 #include <cassert>
 #include <chrono>
 #include <cstdio>
 #include <cstdint>
 #include <exception>
+#include <functional>
 #include <memory>
+#include <vector>
 
 namespace divvy {
 namespace NodeStore {
@@ -49,6 +54,14 @@ public:
         // distribution of data sizes.
         arena_alloc_size = 16 * 1024 * 1024,
 
+        // Bytes of stored leaves sampled to
+        // train a compression dictionary.
+        dictionary_sample_size = 4 * 1024 * 1024,
+
+        // Fewest objects per thread when a batch
+        // is encoded and compressed in parallel.
+        batch_grain = 64,
+
         currentType = 1
     };
 
@@ -61,6 +74,7 @@ public:
     api::store db_;
     std::atomic <bool> deletePath_;
     Scheduler& scheduler_;
+    std::shared_ptr <CompressionDictionary const> dictionary_;
 
     NuDBBackend (int keyBytes, Section const& keyValues,
         Scheduler& scheduler, beast::Journal journal)
@@ -83,8 +97,15 @@ public:
             currentType, make_salt(), keyBytes,
                 beast::nudb::block_size(kp),
             0.50);
+        bool mmap = false;
+        get_if_exists (keyValues, "mmap", mmap);
+        db_.map_files (mmap);
         try
         {
+            bool dictionary = false;
+            get_if_exists (keyValues, "dictionary", dictionary);
+            openDictionary ((folder / "nudb.dict").string (),
+                dp, dictionary);
             if (! db_.open (dp, kp, lp,
                     arena_alloc_size))
                 throw std::runtime_error(
@@ -92,6 +113,7 @@ public:
             if (db_.appnum() != currentType)
                 throw std::runtime_error(
                     "nodestore: unknown appnum");
+            db_.codec().dictionary (dictionary_.get());
         }
         catch (std::exception const& e)
         {
@@ -106,6 +128,65 @@ public:
         close();
     }
 
+    // Make the dictionaries this backend's records were written with
+    // available for reads, and choose the one new records use.
+    void
+    openDictionary (std::string const& path,
+        std::string const& dp, bool enable)
+    {
+        auto dictionaries = CompressionDictionary::load (path);
+        for (auto const& d : dictionaries)
+            CompressionDictionary::add (d);
+
+        if (! enable)
+            return;
+
+        if (! dictionaries.empty ())
+        {
+            dictionary_ = dictionaries.back ();
+            return;
+        }
+
+        // A backend with too little stored to sample, such as one just
+        // created by a rotation, writes plain records until a later open
+        // finds enough to train its own dictionary.
+        dictionary_ = trainDictionary (dp);
+        if (! dictionary_)
+            return;
+
+        CompressionDictionary::add (dictionary_);
+        dictionaries.push_back (dictionary_);
+        CompressionDictionary::save (path, dictionaries);
+        if (journal_.info) journal_.info <<
+            "Compression dictionary " << dictionary_->id () <<
+            " for " << name_;
+    }
+
+    std::shared_ptr <CompressionDictionary const>
+    trainDictionary (std::string const& dp)
+    {
+        std::vector <Blob> samples;
+        std::size_t bytes = 0;
+        api::visit (dp,
+            [&](void const* key, std::size_t key_bytes,
+                void const* data, std::size_t size)
+            {
+                auto const p = static_cast <
+                    std::uint8_t const*> (data);
+                // Inner nodes have their own encoding
+                if (size == 525 && ((std::uint32_t (p[9]) << 24) |
+                    (std::uint32_t (p[10]) << 16) |
+                        (std::uint32_t (p[11]) << 8) |
+                            std::uint32_t (p[12])) ==
+                                HashPrefix::innerNode)
+                    return true;
+                samples.emplace_back (p, p + size);
+                bytes += size;
+                return bytes < dictionary_sample_size;
+            });
+        return CompressionDictionary::train (samples);
+    }
+
     std::string
     getName()
     {
@@ -151,14 +232,29 @@ public:
     bool
     canFetchBatch() override
     {
-        return false;
+        return true;
     }
 
     std::vector<std::shared_ptr<NodeObject>>
-    fetchBatch (std::size_t n, void const* const* keys) override
+    fetchBatch (std::size_t n, void const* const* keys,
+        std::vector<Status>& status) override
     {
-        throw std::runtime_error("pure virtual called");
-        return {};
+        std::vector<std::shared_ptr<NodeObject>> result (n);
+        status.assign (n, notFound);
+        db_.fetch_batch (n, keys,
+            [keys, &result, &status](std::size_t i,
+                void const* data, std::size_t size)
+            {
+                DecodedBlob decoded (keys[i], data, size);
+                if (! decoded.wasOk ())
+                {
+                    status[i] = dataCorrupt;
+                    return;
+                }
+                result[i] = decoded.createObject();
+                status[i] = ok;
+            });
+        return result;
     }
 
     void
@@ -188,12 +284,36 @@ public:
     storeBatch (Batch const& batch) override
     {
         BatchWriteReport report;
-        EncodedBlob encoded;
         report.writeCount = batch.size();
         auto const start =
             std::chrono::steady_clock::now();
-        for (auto const& e : batch)
-            do_insert (e);
+        // Only this thread writes batches, so the encoding and
+        // compression are spread over the shared pool. Each object
+        // has its own slot and only the bucket inserts are serial.
+        auto& pool = TaskPool::shared();
+        int const helpers = static_cast<int> (std::min<std::size_t> (
+            pool.size() - 1, batch.size() / batch_grain));
+        auto const forEach =
+            [&pool, helpers](std::size_t n,
+                std::function<void(std::size_t)> const& f)
+            {
+                pool.forEach (n, helpers, f);
+            };
+
+        std::vector<EncodedBlob> encoded (batch.size());
+        std::vector<void const*> keys (batch.size());
+        std::vector<void const*> data (batch.size());
+        std::vector<std::size_t> sizes (batch.size());
+        forEach (batch.size(),
+            [&](std::size_t i)
+            {
+                encoded[i].prepare (batch[i]);
+                keys[i] = encoded[i].getKey();
+                data[i] = encoded[i].getData();
+                sizes[i] = encoded[i].getSize();
+            });
+        db_.insert_batch (batch.size(),
+            keys.data(), data.data(), sizes.data(), forEach);
         report.elapsed = std::chrono::duration_cast <
             std::chrono::milliseconds>(
                 std::chrono::steady_clock::now() - start);
@@ -221,6 +341,7 @@ public:
             });
         db_.open (dp, kp, lp,
             arena_alloc_size);
+        db_.codec().dictionary (dictionary_.get());
     }
 
     int
@@ -229,12 +350,25 @@ public:
         return 0;
     }
 
+    std::size_t
+    estimateKeys () override
+    {
+        return db_.key_count_estimate();
+    }
+
     void
     setDeletePath() override
     {
         deletePath_ = true;
     }
 
+    void
+    sync() override
+    {
+        // The store commits and fsyncs pending inserts
+        // on its own schedule, there is nothing to force.
+    }
+
     void
     verify() override
     {
@@ -245,6 +379,7 @@ public:
         api::verify (dp, kp);
         db_.open (dp, kp, lp,
             arena_alloc_size);
+        db_.codec().dictionary (dictionary_.get());
     }
 };
 
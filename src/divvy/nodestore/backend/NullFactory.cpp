@@ -60,7 +60,8 @@ public:
     }
 
     std::vector<std::shared_ptr<NodeObject>>
-    fetchBatch (std::size_t n, void const* const* keys) override
+    fetchBatch (std::size_t n, void const* const* keys,
+        std::vector<Status>& status) override
     {
         throw std::runtime_error("pure virtual called");
         return {};
@@ -87,11 +88,22 @@ public:
         return 0;
     }
 
+    std::size_t
+    estimateKeys () override
+    {
+        return 0;
+    }
+
     void
     setDeletePath() override
     {
     }
 
+    void
+    sync() override
+    {
+    }
+
     void
     verify() override
     {
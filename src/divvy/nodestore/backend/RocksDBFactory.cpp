@@ -31,6 +31,7 @@
 #include <divvy/nodestore/impl/EncodedBlob.h>
 #include <beast/threads/Thread.h>
 #include <atomic>
+#include <chrono>
 #include <beast/cxx14/memory.h> // <memory>
 
 namespace divvy {
@@ -91,6 +92,12 @@ class RocksDBBackend
 private:
     std::atomic <bool> m_deletePath;
 
+    // When set, stores bypass the BatchWriter and go straight to the
+    // memtable with the write ahead log disabled. Durability comes
+    // from the explicit flush in sync() instead.
+    bool m_direct;
+    std::atomic <int> m_writeLoad;
+
 public:
     beast::Journal m_journal;
     size_t const m_keyBytes;
@@ -102,6 +109,8 @@ public:
     RocksDBBackend (int keyBytes, Section const& keyValues,
         Scheduler& scheduler, beast::Journal journal, RocksDBEnv* env)
         : m_deletePath (false)
+        , m_direct (false)
+        , m_writeLoad (0)
         , m_journal (journal)
         , m_keyBytes (keyBytes)
         , m_scheduler (scheduler)
@@ -110,6 +119,12 @@ public:
         if (!get_if_exists(keyValues, "path", m_name))
             throw std::runtime_error ("Missing path in RocksDBFactory backend");
 
+        if (keyValues.exists ("direct_write") &&
+            (get<int>(keyValues, "direct_write") != 0))
+        {
+            m_direct = true;
+        }
+
         rocksdb::Options options;
         rocksdb::BlockBasedTableOptions table_options;
         options.create_if_missing = true;
@@ -199,6 +214,8 @@ public:
     {
         if (m_db)
         {
+            if (m_direct)
+                sync();
             m_db.reset();
             if (m_deletePath)
             {
@@ -273,7 +290,8 @@ public:
     }
 
     std::vector<std::shared_ptr<NodeObject>>
-    fetchBatch (std::size_t n, void const* const* keys) override
+    fetchBatch (std::size_t n, void const* const* keys,
+        std::vector<Status>& status) override
     {
         throw std::runtime_error("pure virtual called");
         return {};
@@ -282,11 +300,45 @@ public:
     void
     store (std::shared_ptr<NodeObject> const& object)
     {
-        m_batch.store (object);
+        if (m_direct)
+            storeBatch (Batch{object});
+        else
+            m_batch.store (object);
     }
 
     void
     storeBatch (Batch const& batch)
+    {
+        if (! m_direct)
+            return write (batch);
+
+        // The memtable is the only queue, so time spent in Write
+        // is time spent stalled behind RocksDB's background flushes.
+        // Report it the same way the BatchWriter would.
+        BatchWriteReport report;
+        report.writeCount = batch.size();
+        auto const before = std::chrono::steady_clock::now();
+
+        ++m_writeLoad;
+        try
+        {
+            write (batch);
+        }
+        catch (...)
+        {
+            --m_writeLoad;
+            throw;
+        }
+        --m_writeLoad;
+
+        report.elapsed = std::chrono::duration_cast <std::chrono::milliseconds>
+            (std::chrono::steady_clock::now() - before);
+
+        m_scheduler.onBatchWrite (report);
+    }
+
+    void
+    write (Batch const& batch)
     {
         rocksdb::WriteBatch wb;
 
@@ -303,7 +355,8 @@ public:
                     encoded.getData ()), encoded.getSize ()));
         }
 
-        rocksdb::WriteOptions const options;
+        rocksdb::WriteOptions options;
+        options.disableWAL = m_direct;
 
         auto ret = m_db->Write (options, &wb);
 
@@ -351,15 +404,42 @@ public:
     int
     getWriteLoad ()
     {
+        if (m_direct)
+            return m_writeLoad;
         return m_batch.getWriteLoad ();
     }
 
+    std::size_t
+    estimateKeys () override
+    {
+        std::uint64_t keys = 0;
+        if (! m_db->GetIntProperty ("rocksdb.estimate-num-keys", &keys))
+            return 0;
+        return static_cast <std::size_t> (keys);
+    }
+
     void
     setDeletePath() override
     {
         m_deletePath = true;
     }
 
+    void
+    sync() override
+    {
+        // With the write ahead log on, every write is already durable
+        if (! m_direct)
+            return;
+
+        rocksdb::FlushOptions options;
+        options.wait = true;
+
+        auto ret = m_db->Flush (options);
+
+        if (!ret.ok ())
+            m_journal.error << "Flush failed: " << ret.ToString ();
+    }
+
     //--------------------------------------------------------------------------
 
     void
@@ -263,7 +263,8 @@ public:
     }
 
     std::vector<std::shared_ptr<NodeObject>>
-    fetchBatch (std::size_t n, void const* const* keys) override
+    fetchBatch (std::size_t n, void const* const* keys,
+        std::vector<Status>& status) override
     {
         throw std::runtime_error("pure virtual called");
         return {};
@@ -341,12 +342,34 @@ public:
         return 0;
     }
 
+    std::size_t
+    estimateKeys () override
+    {
+        std::uint64_t keys = 0;
+        if (! m_db->GetIntProperty ("rocksdb.estimate-num-keys", &keys))
+            return 0;
+        return static_cast <std::size_t> (keys);
+    }
+
     void
     setDeletePath() override
     {
         m_deletePath = true;
     }
 
+    void
+    sync() override
+    {
+        // Writes skip the write ahead log, so flush the memtable
+        rocksdb::FlushOptions options;
+        options.wait = true;
+
+        auto ret = m_db->Flush (options);
+
+        if (!ret.ok ())
+            m_journal.error << "Flush failed: " << ret.ToString ();
+    }
+
     //--------------------------------------------------------------------------
 
     void
@@ -52,8 +52,26 @@ BatchWriter::store (std::shared_ptr<NodeObject> const& object)
     }
 }
 
+void
+BatchWriter::store (Batch const& batch)
+{
+    if (batch.empty ())
+        return;
+
+    std::lock_guard<decltype(mWriteMutex)> sl (mWriteMutex);
+
+    mWriteSet.insert (mWriteSet.end (), batch.begin (), batch.end ());
+
+    if (! mWritePending)
+    {
+        mWritePending = true;
+
+        m_scheduler.scheduleTask (*this);
+    }
+}
+
 int
-BatchWriter::getWriteLoad ()
+BatchWriter::getWriteLoad () const
 {
     std::lock_guard<decltype(mWriteMutex)> sl (mWriteMutex);
 
@@ -62,13 +62,21 @@ public:
     */
     void store (std::shared_ptr<NodeObject> const& object);
 
+    /** Store a group of objects.
+
+        Like store, but the objects are added to the batch together.
+    */
+    void store (Batch const& batch);
+
     /** Get an estimate of the amount of writing I/O pending. */
-    int getWriteLoad ();
+    int getWriteLoad () const;
+
+    /** Wait until everything stored so far has been written. */
+    void waitForWriting ();
 
 private:
     void performScheduledTask ();
     void writeBatch ();
-    void waitForWriting ();
 
 private:
     using LockType = std::recursive_mutex;
@@ -76,7 +84,7 @@ private:
 
     Callback& m_callback;
     Scheduler& m_scheduler;
-    LockType mWriteMutex;
+    mutable LockType mWriteMutex;
     CondvarType mWriteCondition;
     int mWriteLoad;
     bool mWritePending;
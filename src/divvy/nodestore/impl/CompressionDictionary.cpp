@@ -0,0 +1,380 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of divvyd: https://github.com/xdv/divvyd
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <divvy/nodestore/impl/CompressionDictionary.h>
+#include <beast/hash/xxhasher.h>
+#include <boost/filesystem.hpp>
+#include <boost/thread/tss.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <queue>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace divvy {
+namespace NodeStore {
+
+namespace {
+
+std::uint32_t
+hashOf (Blob const& data)
+{
+    beast::xxhasher h;
+    h (data.data (), data.size ());
+    return static_cast <std::uint32_t> (static_cast <std::size_t> (h));
+}
+
+// The process wide set of dictionaries. Lookups walk a list which is
+// only ever prepended to, so they need no lock.
+struct Node
+{
+    std::shared_ptr <CompressionDictionary const> dictionary;
+    Node* next;
+};
+
+std::atomic <Node*> head (nullptr);
+std::mutex addMutex;
+
+std::atomic <std::uint64_t> nextSerial (1);
+
+// The hash table of an LZ4_stream_t, followed by its position fields.
+std::size_t const hashEntries = std::size_t (1) << (LZ4_MEMORY_USAGE - 2);
+std::size_t const tailBytes = sizeof (LZ4_stream_t) -
+    hashEntries * sizeof (std::uint32_t);
+
+// The slot LZ4 keeps a position in, as its byU32 tables hash it.
+std::size_t
+hashSlot (std::uint8_t const* p)
+{
+    if (sizeof (void*) == 8)
+    {
+        std::uint64_t v;
+        std::memcpy (&v, p, sizeof (v));
+        return static_cast <std::size_t> ((v * 889523592379ULL) >>
+            (40 - (LZ4_MEMORY_USAGE - 2))) & (hashEntries - 1);
+    }
+    std::uint32_t v;
+    std::memcpy (&v, p, sizeof (v));
+    return (v * 2654435761U) >> (32 - (LZ4_MEMORY_USAGE - 2));
+}
+
+// A thread's working copy of the last dictionary stream it used.
+struct WorkingStream
+{
+    std::uint64_t serial = 0;
+    LZ4_stream_t stream;
+};
+
+boost::thread_specific_ptr <WorkingStream> workingStream;
+
+// Identifies the dictionary file format
+char const fileMagic[8] = { 'D', 'V', 'D', 'I', 'C', 'T', '0', '1' };
+
+void
+writeUInt32 (std::ostream& out, std::uint32_t v)
+{
+    char const b[4] = {
+        char (v >> 24), char (v >> 16), char (v >> 8), char (v) };
+    out.write (b, sizeof (b));
+}
+
+bool
+readUInt32 (std::istream& in, std::uint32_t& v)
+{
+    unsigned char b[4];
+    if (! in.read (reinterpret_cast <char*> (b), sizeof (b)))
+        return false;
+    v = (std::uint32_t (b[0]) << 24) | (std::uint32_t (b[1]) << 16) |
+        (std::uint32_t (b[2]) << 8) | std::uint32_t (b[3]);
+    return true;
+}
+
+}
+
+CompressionDictionary::CompressionDictionary (Blob data)
+    : data_ (std::move (data))
+    , id_ (hashOf (data_))
+    , serial_ (nextSerial++)
+{
+    LZ4_resetStream (&stream_);
+    LZ4_loadDict (&stream_, reinterpret_cast <char const*> (data_.data ()),
+        static_cast <int> (data_.size ()));
+}
+
+int
+CompressionDictionary::compress (
+    void const* in, int inSize, void* out, int outMax) const
+{
+    auto ws = workingStream.get ();
+    if (! ws)
+    {
+        ws = new WorkingStream;
+        workingStream.reset (ws);
+    }
+    if (ws->serial != serial_)
+    {
+        ws->stream = stream_;
+        ws->serial = serial_;
+    }
+
+    auto const result = LZ4_compress_fast_continue (&ws->stream,
+        static_cast <char const*> (in), static_cast <char*> (out),
+            inSize, outMax, 1);
+
+    // Compressing only wrote the slots of positions in the input, and
+    // the fields after the table. Putting those back leaves the stream
+    // as loaded, which costs far less than copying all of it per call.
+    auto const table = reinterpret_cast <std::uint32_t*> (&ws->stream);
+    auto const loaded = reinterpret_cast <std::uint32_t const*> (&stream_);
+    auto const p = static_cast <std::uint8_t const*> (in);
+    for (int i = 0; i + 8 <= inSize; ++i)
+    {
+        auto const slot = hashSlot (p + i);
+        table[slot] = loaded[slot];
+    }
+    std::memcpy (table + hashEntries, loaded + hashEntries, tailBytes);
+    return result;
+}
+
+int
+CompressionDictionary::decompress (
+    void const* in, int inSize, void* out, int outSize) const
+{
+    return LZ4_decompress_safe_usingDict (
+        static_cast <char const*> (in), static_cast <char*> (out),
+            inSize, outSize, reinterpret_cast <char const*> (data_.data ()),
+                static_cast <int> (data_.size ()));
+}
+
+std::shared_ptr <CompressionDictionary const>
+CompressionDictionary::train (std::vector <Blob> const& samples,
+    std::size_t size)
+{
+    // This is a simplified form of the COVER algorithm. Each sample is
+    // cut into fixed size segments, and a segment is worth the number of
+    // times its k-mers occur across all samples. The best segments are
+    // taken greedily, and the k-mers of a taken segment stop counting
+    // towards the others so that the dictionary does not repeat itself.
+    std::size_t const k = 6;
+    std::size_t const d = 48;
+    std::size_t const minSamples = 100;
+
+    size = std::min (size, maxSize);
+    if (samples.size () < minSamples || size < d)
+        return nullptr;
+
+    auto const kmer = [](std::uint8_t const* p)
+    {
+        std::uint64_t v = 0;
+        std::memcpy (&v, p, k);
+        return v;
+    };
+
+    std::unordered_map <std::uint64_t, std::uint32_t> freq;
+    for (auto const& s : samples)
+        for (std::size_t i = 0; i + k <= s.size (); ++i)
+            ++freq[kmer (s.data () + i)];
+
+    struct Segment
+    {
+        std::uint64_t score;
+        std::uint32_t sample;
+        std::uint32_t offset;
+        std::uint32_t length;
+
+        bool
+        operator< (Segment const& other) const
+        {
+            return score < other.score;
+        }
+    };
+
+    auto const score = [&](Segment const& seg)
+    {
+        std::uint64_t total = 0;
+        auto const p = samples[seg.sample].data () + seg.offset;
+        for (std::size_t i = 0; i + k <= seg.length; ++i)
+        {
+            auto const iter = freq.find (kmer (p + i));
+            if (iter != freq.end ())
+                total += iter->second;
+        }
+        return total;
+    };
+
+    std::priority_queue <Segment> heap;
+    for (std::uint32_t i = 0; i < samples.size (); ++i)
+    {
+        auto const n = samples[i].size ();
+        for (std::size_t offset = 0; offset + k <= n; offset += d)
+        {
+            Segment seg {0, i, static_cast <std::uint32_t> (offset),
+                static_cast <std::uint32_t> (std::min (d, n - offset))};
+            seg.score = score (seg);
+            if (seg.score > 0)
+                heap.push (seg);
+        }
+    }
+
+    std::vector <Segment> taken;
+    std::size_t total = 0;
+    while (! heap.empty () && total < size)
+    {
+        auto seg = heap.top ();
+        heap.pop ();
+
+        // Scores only fall as segments are taken, so a segment which
+        // still beats the best stale score is the best one left.
+        seg.score = score (seg);
+        if (seg.score == 0)
+            continue;
+        if (! heap.empty () && seg.score < heap.top ().score)
+        {
+            heap.push (seg);
+            continue;
+        }
+
+        auto const p = samples[seg.sample].data () + seg.offset;
+        for (std::size_t i = 0; i + k <= seg.length; ++i)
+            freq.erase (kmer (p + i));
+        taken.push_back (seg);
+        total += seg.length;
+    }
+
+    if (taken.empty ())
+        return nullptr;
+
+    // LZ4 encodes nearer matches more cheaply, so the best segments go
+    // at the end of the dictionary, closest to the data.
+    Blob data;
+    data.reserve (total);
+    for (auto iter = taken.rbegin (); iter != taken.rend (); ++iter)
+    {
+        auto const p = samples[iter->sample].data () + iter->offset;
+        data.insert (data.end (), p, p + iter->length);
+    }
+    if (data.size () > size)
+        data.erase (data.begin (), data.begin () + (data.size () - size));
+
+    return std::make_shared <CompressionDictionary> (std::move (data));
+}
+
+void
+CompressionDictionary::add (
+    std::shared_ptr <CompressionDictionary const> const& dictionary)
+{
+    std::lock_guard <std::mutex> lock (addMutex);
+
+    for (auto node = head.load (); node; node = node->next)
+    {
+        if (node->dictionary->id () == dictionary->id ())
+        {
+            if (node->dictionary->data () != dictionary->data ())
+                throw std::runtime_error (
+                    "nodestore: compression dictionary id collision");
+            return;
+        }
+    }
+
+    head.store (new Node {dictionary, head.load ()});
+}
+
+CompressionDictionary const*
+CompressionDictionary::find (std::uint32_t id)
+{
+    for (auto node = head.load (); node; node = node->next)
+        if (node->dictionary->id () == id)
+            return node->dictionary.get ();
+    return nullptr;
+}
+
+std::vector <std::shared_ptr <CompressionDictionary const>>
+CompressionDictionary::load (std::string const& path)
+{
+    std::vector <std::shared_ptr <CompressionDictionary const>> result;
+
+    std::ifstream in (path, std::ios::binary);
+    if (! in)
+        return result;
+
+    char magic[sizeof (fileMagic)];
+    if (! in.read (magic, sizeof (magic)) ||
+            std::memcmp (magic, fileMagic, sizeof (magic)) != 0)
+        throw std::runtime_error (
+            "nodestore: bad compression dictionary file " + path);
+
+    for (;;)
+    {
+        std::uint32_t id;
+        if (! readUInt32 (in, id))
+            break;
+
+        std::uint32_t size;
+        if (! readUInt32 (in, size) || size > maxSize)
+            throw std::runtime_error (
+                "nodestore: bad compression dictionary file " + path);
+
+        Blob data (size);
+        if (! in.read (reinterpret_cast <char*> (data.data ()), size))
+            throw std::runtime_error (
+                "nodestore: bad compression dictionary file " + path);
+
+        auto dictionary = std::make_shared <CompressionDictionary> (
+            std::move (data));
+        if (dictionary->id () != id)
+            throw std::runtime_error (
+                "nodestore: bad compression dictionary file " + path);
+        result.push_back (std::move (dictionary));
+    }
+
+    return result;
+}
+
+void
+CompressionDictionary::save (std::string const& path, std::vector <
+    std::shared_ptr <CompressionDictionary const>> const& dictionaries)
+{
+    // Write a new file and move it into place, so that a failure can
+    // never lose a dictionary that stored records depend on.
+    auto const temp = path + ".tmp";
+    {
+        std::ofstream out (temp, std::ios::binary | std::ios::trunc);
+        out.write (fileMagic, sizeof (fileMagic));
+        for (auto const& dictionary : dictionaries)
+        {
+            writeUInt32 (out, dictionary->id ());
+            writeUInt32 (out,
+                static_cast <std::uint32_t> (dictionary->data ().size ()));
+            out.write (reinterpret_cast <char const*> (
+                dictionary->data ().data ()), dictionary->data ().size ());
+        }
+        out.close ();
+        if (out.fail ())
+            throw std::runtime_error (
+                "nodestore: unable to write " + temp);
+    }
+    boost::filesystem::rename (temp, path);
+}
+
+}
+}
@@ -0,0 +1,132 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of divvyd: https://github.com/xdv/divvyd
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef RIPPLE_NODESTORE_COMPRESSIONDICTIONARY_H_INCLUDED
+#define RIPPLE_NODESTORE_COMPRESSIONDICTIONARY_H_INCLUDED
+
+#include <divvy/basics/Blob.h>
+#include <lz4/lib/lz4.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace divvy {
+namespace NodeStore {
+
+/** A shared dictionary for compressing small NodeObjects.
+
+    Ledger entries are too small for LZ4 to find much repetition inside
+    any one of them, but they repeat field headers, account IDs and
+    amounts across each other. A dictionary built from a sample of stored
+    objects gives the compressor that shared context.
+
+    Compressed records name their dictionary by id, a hash of its
+    contents, so a record can be decompressed by any process that has
+    loaded the dictionary it was written with. Dictionaries are kept in
+    a process wide set for this, and are never removed from it.
+*/
+class CompressionDictionary
+{
+public:
+    /** The largest useful dictionary, which is the LZ4 window. */
+    static std::size_t const maxSize = 64 * 1024;
+
+    explicit
+    CompressionDictionary (Blob data);
+
+    CompressionDictionary (CompressionDictionary const&) = delete;
+    CompressionDictionary& operator= (CompressionDictionary const&) = delete;
+
+    std::uint32_t
+    id () const
+    {
+        return id_;
+    }
+
+    Blob const&
+    data () const
+    {
+        return data_;
+    }
+
+    /** Compress with this dictionary.
+        Each thread compresses with its own copy of the dictionary's
+        stream, which is loaded once and reused between calls.
+        @return The number of bytes written, or zero on failure.
+    */
+    int
+    compress (void const* in, int inSize, void* out, int outMax) const;
+
+    /** Decompress data written by compress.
+        @return The number of bytes written, negative on corrupt input.
+    */
+    int
+    decompress (void const* in, int inSize, void* out, int outSize) const;
+
+    /** Build a dictionary from sample values.
+        @return `nullptr` if there are too few samples.
+    */
+    static
+    std::shared_ptr <CompressionDictionary const>
+    train (std::vector <Blob> const& samples, std::size_t size = maxSize);
+
+    /** Make a dictionary available to find.
+        Throws if a different dictionary has the same id.
+    */
+    static
+    void
+    add (std::shared_ptr <CompressionDictionary const> const& dictionary);
+
+    /** Return the dictionary with the id, or `nullptr`. */
+    static
+    CompressionDictionary const*
+    find (std::uint32_t id);
+
+    /** Read the dictionaries kept with a backend, oldest first.
+        A missing file holds no dictionaries. Throws if the file is
+        damaged, since records may depend on what it held.
+    */
+    static
+    std::vector <std::shared_ptr <CompressionDictionary const>>
+    load (std::string const& path);
+
+    /** Replace the dictionaries kept with a backend. */
+    static
+    void
+    save (std::string const& path, std::vector <
+        std::shared_ptr <CompressionDictionary const>> const& dictionaries);
+
+private:
+    Blob const data_;
+    std::uint32_t const id_;
+
+    // Tells apart dictionaries which reuse an address, so a
+    // thread's stream is never taken for a newer dictionary's.
+    std::uint64_t const serial_;
+
+    // A stream with data_ loaded. A thread's stream starts as a
+    // copy of this one and is restored from it after each use.
+    LZ4_stream_t stream_;
+};
+
+}
+}
+
+#endif
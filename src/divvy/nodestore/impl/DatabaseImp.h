@@ -22,18 +22,21 @@
 
 #include <divvy/nodestore/Database.h>
 #include <divvy/nodestore/Scheduler.h>
+#include <divvy/nodestore/ScopedReadPriority.h>
+#include <divvy/nodestore/ScopedUncachedReads.h>
+#include <divvy/nodestore/impl/BatchWriter.h>
+#include <divvy/nodestore/impl/ReadQueue.h>
 #include <divvy/nodestore/impl/Tuning.h>
 #include <divvy/basics/KeyCache.h>
 #include <divvy/basics/Log.h>
 #include <divvy/basics/seconds_clock.h>
 #include <divvy/basics/SHA512Half.h>
 #include <divvy/basics/Slice.h>
-#include <divvy/basics/TaggedCache.h>
+#include <divvy/basics/ShardedTaggedCache.h>
 #include <beast/threads/Thread.h>
 #include <divvy/nodestore/ScopedMetrics.h>
+#include <algorithm>
 #include <chrono>
-#include <condition_variable>
-#include <set>
 #include <thread>
 
 namespace divvy {
@@ -41,27 +44,24 @@ namespace NodeStore {
 
 class DatabaseImp
     : public Database
+    , private BatchWriter::Callback
 {
 private:
     beast::Journal m_journal;
     Scheduler& m_scheduler;
     // Persistent key/value storage.
     std::unique_ptr <Backend> m_backend;
+    // Writes queued by asyncStoreBatch
+    BatchWriter m_writer;
 protected:
     // Positive cache
-    TaggedCache <uint256, NodeObject> m_cache;
+    ShardedTaggedCache <uint256, NodeObject> m_cache;
 
     // Negative cache
     KeyCache <uint256> m_negCache;
 private:
-    std::mutex                m_readLock;
-    std::condition_variable   m_readCondVar;
-    std::condition_variable   m_readGenCondVar;
-    std::set <uint256>        m_readSet;        // set of reads to do
-    uint256                   m_readLast;       // last hash read
+    ReadQueue                 m_readQueue;      // reads to do
     std::vector <std::thread> m_readThreads;
-    bool                      m_readShut;
-    uint64_t                  m_readGen;        // current read generation
 public:
     DatabaseImp (std::string const& name,
                  Scheduler& scheduler,
@@ -71,31 +71,32 @@ public:
         : m_journal (journal)
         , m_scheduler (scheduler)
         , m_backend (std::move (backend))
+        , m_writer (*this, scheduler)
         , m_cache ("NodeStore", cacheTargetSize, cacheTargetSeconds,
             get_seconds_clock (), deprecatedLogs().journal("TaggedCache"))
         , m_negCache ("NodeStore", get_seconds_clock (),
             cacheTargetSize, cacheTargetSeconds)
-        , m_readShut (false)
-        , m_readGen (0)
         , m_storeCount (0)
         , m_fetchTotalCount (0)
         , m_fetchHitCount (0)
         , m_storeSize (0)
         , m_fetchSize (0)
     {
+        // Objects read from the backend must earn their place in a full
+        // cache, so that one pass over the state can't flush it.
+        m_cache.setAdmission (true);
+
+        // With more than one thread, the first never takes background
+        // reads so that a critical read need not wait for bulk prefetch.
         for (int i = 0; i < readThreads; ++i)
             m_readThreads.push_back (std::thread (&DatabaseImp::threadEntry,
-                    this));
+                    this, i != 0 || readThreads == 1));
     }
 
     ~DatabaseImp ()
     {
-        {
-            std::unique_lock <std::mutex> lock (m_readLock);
-            m_readShut = true;
-            m_readCondVar.notify_all ();
-            m_readGenCondVar.notify_all ();
-        }
+        m_writer.waitForWriting ();
+        m_readQueue.close ();
 
         for (auto& e : m_readThreads)
             e.join();
@@ -112,6 +113,7 @@ public:
     {
         if (m_backend)
         {
+            m_writer.waitForWriting ();
             m_backend->close();
             m_backend = nullptr;
         }
@@ -126,28 +128,15 @@ public:
         if (object || m_negCache.touch_if_exists (hash))
             return true;
 
-        {
-            // No. Post a read
-            std::unique_lock <std::mutex> lock (m_readLock);
-            if (m_readSet.insert (hash).second)
-                m_readCondVar.notify_one ();
-        }
+        // No. Post a read
+        m_readQueue.push (hash, ScopedReadPriority::get ());
 
         return false;
     }
 
     void waitReads() override
     {
-        {
-            std::unique_lock <std::mutex> lock (m_readLock);
-
-            // Wake in two generations
-            std::uint64_t const wakeGeneration = m_readGen + 2;
-
-            while (!m_readShut && !m_readSet.empty () && (m_readGen < wakeGeneration))
-                m_readGenCondVar.wait (lock);
-        }
-
+        m_readQueue.wait (ScopedReadPriority::get ());
     }
 
     int getDesiredAsyncReadCount ()
@@ -165,10 +154,92 @@ public:
         return doTimedFetch (hash, false);
     }
 
+    std::vector<std::shared_ptr<NodeObject>>
+    fetchBatch (std::vector<uint256> const& hashes) override
+    {
+        for (std::size_t i = 0; i < hashes.size(); ++i)
+            ScopedMetrics::incrementThreadFetches ();
+
+        return doTimedFetchBatch (hashes, false);
+    }
+
+    // Look in the cache. An async read was already counted when
+    // asyncFetch missed, so counting it again here would let one
+    // request meet the admission frequency on its own.
+    std::shared_ptr<NodeObject> probe (uint256 const& hash, bool isAsync)
+    {
+        return isAsync ? m_cache.refetch (hash) : m_cache.fetch (hash);
+    }
+
+    /** Perform a batch fetch and report the time it took */
+    std::vector<std::shared_ptr<NodeObject>>
+    doTimedFetchBatch (std::vector<uint256> const& hashes, bool isAsync)
+    {
+        std::vector<std::shared_ptr<NodeObject>> ret (hashes.size());
+
+        // Satisfy what we can from the caches
+        std::vector<uint256> missing;
+        std::vector<std::size_t> index;
+        for (std::size_t i = 0; i < hashes.size(); ++i)
+        {
+            ret[i] = probe (hashes[i], isAsync);
+            if (ret[i] == nullptr && ! m_negCache.touch_if_exists (hashes[i]))
+            {
+                missing.push_back (hashes[i]);
+                index.push_back (i);
+            }
+        }
+
+        if (missing.empty ())
+            return ret;
+
+        FetchReport report;
+        report.fetchCount = static_cast<int> (missing.size ());
+        report.isAsync = isAsync;
+        report.wentToDisk = true;
+        report.wasFound = false;
+
+        bool const uncached = ScopedUncachedReads::active ();
+        auto const before = std::chrono::steady_clock::now();
+        auto objects = fetchBatchFrom (missing);
+        report.elapsed = std::chrono::duration_cast <std::chrono::milliseconds>
+            (std::chrono::steady_clock::now() - before);
+
+        m_fetchTotalCount += missing.size ();
+        for (std::size_t i = 0; i < missing.size (); ++i)
+        {
+            auto& obj = objects[i];
+            if (obj == nullptr)
+            {
+                // Just in case a write occurred
+                obj = m_cache.refetch (missing[i]);
+
+                if (obj == nullptr)
+                    m_negCache.insert (missing[i]);
+            }
+            else
+            {
+                // Ensure all threads get the same object
+                if (! uncached)
+                    m_cache.admit (missing[i], obj);
+                report.wasFound = true;
+            }
+            ret[index[i]] = std::move (obj);
+        }
+
+        if (m_journal.trace) m_journal.trace <<
+            "HOS: batch of " << missing.size () << " fetched from db";
+
+        m_scheduler.onFetch (report);
+
+        return ret;
+    }
+
     /** Perform a fetch and report the time it took */
     std::shared_ptr<NodeObject> doTimedFetch (uint256 const& hash, bool isAsync)
     {
         FetchReport report;
+        report.fetchCount = 1;
         report.isAsync = isAsync;
         report.wentToDisk = false;
 
@@ -187,7 +258,7 @@ public:
     {
         // See if the object already exists in the cache
         //
-        std::shared_ptr<NodeObject> obj = m_cache.fetch (hash);
+        std::shared_ptr<NodeObject> obj = probe (hash, report.isAsync);
 
         if (obj != nullptr)
             return obj;
@@ -213,7 +284,7 @@ public:
         {
 
             // Just in case a write occurred
-            obj = m_cache.fetch (hash);
+            obj = m_cache.refetch (hash);
 
             if (obj == nullptr)
             {
@@ -223,9 +294,11 @@ public:
         }
         else
         {
-            // Ensure all threads get the same object
+            // Ensure all threads get the same object, unless the
+            // caller asked that its reads leave the cache alone.
             //
-            m_cache.canonicalize (hash, obj);
+            if (! ScopedUncachedReads::active ())
+                m_cache.admit (hash, obj);
 
             // Since this was a 'hard' fetch, we will log it.
             //
@@ -241,13 +314,58 @@ public:
         return fetchInternal (*m_backend, hash);
     }
 
+    virtual bool canFetchBatch ()
+    {
+        return m_backend->canFetchBatch ();
+    }
+
+    virtual std::vector<std::shared_ptr<NodeObject>> fetchBatchFrom (
+        std::vector<uint256> const& hashes)
+    {
+        return fetchBatchInternal (*m_backend, hashes);
+    }
+
+    std::vector<std::shared_ptr<NodeObject>> fetchBatchInternal (
+        Backend& backend, std::vector<uint256> const& hashes)
+    {
+        if (! backend.canFetchBatch ())
+        {
+            std::vector<std::shared_ptr<NodeObject>> objects;
+            objects.reserve (hashes.size ());
+            for (auto const& hash : hashes)
+                objects.push_back (fetchInternal (backend, hash));
+            return objects;
+        }
+
+        std::vector<void const*> keys;
+        keys.reserve (hashes.size ());
+        for (auto const& hash : hashes)
+            keys.push_back (hash.begin ());
+
+        std::vector<Status> status;
+        auto objects = backend.fetchBatch (keys.size (), keys.data (), status);
+
+        for (std::size_t i = 0; i < objects.size (); ++i)
+            onFetched (status[i], hashes[i], objects[i].get ());
+
+        return objects;
+    }
+
     std::shared_ptr<NodeObject> fetchInternal (Backend& backend,
         uint256 const& hash)
     {
         std::shared_ptr<NodeObject> object;
 
         Status const status = backend.fetch (hash.begin (), &object);
+        onFetched (status, hash, object.get ());
+
+        return object;
+    }
 
+    // Count a backend read, and log the ones which went wrong
+    void onFetched (Status status, uint256 const& hash,
+        NodeObject const* object)
+    {
         switch (status)
         {
         case ok:
@@ -269,8 +387,6 @@ public:
                 "Unknown status=" << status;
             break;
         }
-
-        return object;
     }
 
     //------------------------------------------------------------------------------
@@ -304,6 +420,67 @@ public:
         m_negCache.erase (hash);
     }
 
+    void storeBatch (Batch const& batch) override
+    {
+        storeBatchInternal (batch, *m_backend.get());
+    }
+
+    void storeBatchInternal (Batch const& batch, Backend& backend)
+    {
+        if (batch.empty ())
+            return;
+
+        cacheBatch (batch);
+        backend.storeBatch (batch);
+    }
+
+    void asyncStoreBatch (Batch const& batch) override
+    {
+        if (batch.empty ())
+            return;
+
+        cacheBatch (batch);
+        m_writer.store (batch);
+    }
+
+    // Make a batch visible to fetches before it is written
+    void cacheBatch (Batch const& batch)
+    {
+        for (auto const& e : batch)
+        {
+            uint256 const& hash = e->getHash ();
+
+            #if RIPPLE_VERIFY_NODEOBJECT_KEYS
+            assert (hash == sha512Hash(make_Slice(e->getData())));
+            #endif
+
+            std::shared_ptr<NodeObject> object = e;
+            m_cache.canonicalize (hash, object, true);
+
+            m_storeSize += e->getData().size();
+            m_negCache.erase (hash);
+        }
+
+        m_storeCount += batch.size();
+    }
+
+    // Called by the BatchWriter on a scheduled task
+    void writeBatch (Batch const& batch) override
+    {
+        m_backend->storeBatch (batch);
+    }
+
+    // Wait for the writes queued by asyncStoreBatch
+    void waitForWrites ()
+    {
+        m_writer.waitForWriting ();
+    }
+
+    int getQueuedWriteLoad () const
+    {
+        return m_writer.getWriteLoad ();
+    }
+
     //------------------------------------------------------------------------------
 
     float getCacheHitRate ()
@@ -319,60 +496,71 @@ public:
         m_negCache.setTargetAge (age);
     }
 
+    void tuneBytes (std::size_t bytes) override
+    {
+        m_cache.setTargetBytes (bytes);
+    }
+
+    std::size_t getCacheBytes () override
+    {
+        return m_cache.getCacheBytes () + m_negCache.bytes ();
+    }
+
     void sweep ()
     {
         m_cache.sweep ();
         m_negCache.sweep ();
     }
 
+    std::vector <uint256> getCacheKeys () override
+    {
+        return m_cache.getKeys ();
+    }
+
     std::int32_t getWriteLoad() const override
     {
-        return m_backend->getWriteLoad();
+        return std::max (m_backend->getWriteLoad(), getQueuedWriteLoad());
+    }
+
+    void sync() override
+    {
+        m_writer.waitForWriting ();
+        m_backend->sync();
     }
 
     //------------------------------------------------------------------------------
 
     // Entry point for async read threads
-    void threadEntry ()
+    void threadEntry (bool background)
     {
         beast::Thread::setCurrentThreadName ("prefetch");
-        while (1)
-        {
-            uint256 hash;
+        std::vector <uint256> hashes;
+        hashes.reserve (asyncReadBatch);
+        ReadPriority priority;
+        std::size_t limit = 1;
 
+        while (m_readQueue.pop (hashes, priority, limit, background))
+        {
+            // Perform the read
+            if (hashes.size () == 1)
+            {
+                doTimedFetch (hashes.front (), true);
+            }
+            else
             {
-                std::unique_lock <std::mutex> lock (m_readLock);
-
-                while (!m_readShut && m_readSet.empty ())
-                {
-                    // all work is done
-                    m_readGenCondVar.notify_all ();
-                    m_readCondVar.wait (lock);
-                }
-
-                if (m_readShut)
-                    break;
-
                 // Read in key order to make the back end more efficient
-                std::set <uint256>::iterator it = m_readSet.lower_bound (m_readLast);
-                if (it == m_readSet.end ())
-                {
-                    it = m_readSet.begin ();
-
-                    // A generation has completed
-                    ++m_readGen;
-                    m_readGenCondVar.notify_all ();
-                }
-
-                hash = *it;
-                m_readSet.erase (it);
-                m_readLast = hash;
+                std::sort (hashes.begin (), hashes.end ());
+                doTimedFetchBatch (hashes, true);
             }
 
-            // Perform the read
-            doTimedFetch (hash, true);
-         }
-     }
+            m_readQueue.finish (hashes, priority);
+
+            // Take a run of keys if the backend can read them together.
+            // This is not asked before the first read, which may come
+            // while a derived class is still being constructed.
+            limit = canFetchBatch () ? asyncReadBatch : 1;
+        }
+    }
 
     //------------------------------------------------------------------------------
 
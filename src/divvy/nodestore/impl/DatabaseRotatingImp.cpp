@@ -36,6 +36,8 @@ std::shared_ptr <Backend> DatabaseRotatingImp::rotateBackends (
 
 std::shared_ptr<NodeObject> DatabaseRotatingImp::fetchFrom (uint256 const& hash)
 {
+    // Each backend's key filter turns away keys it never stored, so a key
+    // held only by the archive costs no disk read on the writable backend.
     Backends b = getBackends();
     std::shared_ptr<NodeObject> object = fetchInternal (*b.writableBackend, hash);
     if (!object)
@@ -50,6 +52,45 @@ std::shared_ptr<NodeObject> DatabaseRotatingImp::fetchFrom (uint256 const& hash)
 
     return object;
 }
+
+std::vector<std::shared_ptr<NodeObject>> DatabaseRotatingImp::fetchBatchFrom (
+        std::vector<uint256> const& hashes)
+{
+    Backends b = getBackends();
+    auto objects = fetchBatchInternal (*b.writableBackend, hashes);
+
+    std::vector<uint256> missing;
+    std::vector<std::size_t> index;
+    for (std::size_t i = 0; i < objects.size(); ++i)
+    {
+        if (!objects[i])
+        {
+            missing.push_back (hashes[i]);
+            index.push_back (i);
+        }
+    }
+
+    if (!missing.empty())
+    {
+        auto archived = fetchBatchInternal (*b.archiveBackend, missing);
+        Batch copied;
+        for (std::size_t i = 0; i < archived.size(); ++i)
+        {
+            if (archived[i])
+            {
+                copied.push_back (archived[i]);
+                m_negCache.erase (missing[i]);
+                objects[index[i]] = std::move (archived[i]);
+            }
+        }
+
+        if (!copied.empty())
+            getWritableBackend()->storeBatch (copied);
+    }
+
+    return objects;
+}
+
 }
 
 }
@@ -59,6 +59,12 @@ public:
             , archiveBackend_ (archiveBackend)
     {}
 
+    ~DatabaseRotatingImp ()
+    {
+        // Queued writes need the backends, which go first
+        waitForWrites ();
+    }
+
     std::shared_ptr <Backend> const& getWritableBackend() const override
     {
         std::lock_guard <std::mutex> lock (rotateMutex_);
@@ -92,7 +98,15 @@ public:
 
     std::int32_t getWriteLoad() const override
     {
-        return getWritableBackend()->getWriteLoad();
+        return std::max (getWritableBackend()->getWriteLoad(),
+            getQueuedWriteLoad());
+    }
+
+    void sync() override
+    {
+        // Only the writable backend receives new objects
+        waitForWrites ();
+        getWritableBackend()->sync();
     }
 
     void for_each (std::function <void(std::shared_ptr<NodeObject>)> f) override
@@ -115,13 +129,36 @@ public:
                 *getWritableBackend());
     }
 
+    void storeBatch (Batch const& batch) override
+    {
+        storeBatchInternal (batch, *getWritableBackend());
+    }
+
+    void writeBatch (Batch const& batch) override
+    {
+        getWritableBackend()->storeBatch (batch);
+    }
+
     std::shared_ptr<NodeObject> fetchNode (uint256 const& hash) override
     {
         return fetchFrom (hash);
     }
 
+    std::vector<std::shared_ptr<NodeObject>> fetchNodes (
+        std::vector<uint256> const& hashes) override
+    {
+        return fetchBatchFrom (hashes);
+    }
+
     std::shared_ptr<NodeObject> fetchFrom (uint256 const& hash) override;
-    TaggedCache <uint256, NodeObject>& getPositiveCache() override
+    std::vector<std::shared_ptr<NodeObject>> fetchBatchFrom (
+        std::vector<uint256> const& hashes) override;
+
+    bool canFetchBatch () override
+    {
+        return getWritableBackend()->canFetchBatch ();
+    }
+    ShardedTaggedCache <uint256, NodeObject>& getPositiveCache() override
     {
         return m_cache;
     }
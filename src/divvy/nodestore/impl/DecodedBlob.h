@@ -38,7 +38,11 @@ namespace NodeStore {
 class DecodedBlob
 {
 public:
-    /** Construct the decoded blob from raw data. */
+    /** Construct the decoded blob from raw data.
+        The key and value are not copied, they must remain valid
+        until createObject returns. Backends may pass pointers
+        straight into a memory mapped file.
+    */
     DecodedBlob (void const* key, void const* value, int valueBytes);
 
     /** Determine if the decoding was successful. */
@@ -0,0 +1,238 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of divvyd: https://github.com/xdv/divvyd
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <divvy/nodestore/impl/FilteredBackend.h>
+#include <divvy/nodestore/NodeObject.h>
+#include <beast/cxx14/memory.h> // <memory>
+#include <boost/filesystem.hpp>
+#include <algorithm>
+
+namespace divvy {
+namespace NodeStore {
+
+FilteredBackend::FilteredBackend (std::unique_ptr <Backend> backend,
+    std::string const& path, int bitsPerKey, std::size_t minKeys,
+        beast::Journal journal)
+    : backend_ (std::move (backend))
+    , filterPath_ (! path.empty () && boost::filesystem::is_directory (path)
+        ? (boost::filesystem::path (path) / "keys.filter").string ()
+        : std::string ())
+    , bitsPerKey_ (bitsPerKey)
+    , head_ (nullptr)
+    , deletePath_ (false)
+    , journal_ (journal)
+{
+    std::unique_ptr <KeyFilter> filter;
+
+    if (! filterPath_.empty ())
+    {
+        filter = KeyFilter::load (filterPath_);
+
+        // The saved filter only describes the backend as it was when it
+        // was written. Remove it so that it is never trusted again after
+        // stores it has not seen.
+        boost::system::error_code ec;
+        boost::filesystem::remove (filterPath_, ec);
+
+        if (filter && (filter->bitsPerKey () != bitsPerKey_ ||
+            filter->size () > filter->capacity ()))
+        {
+            filter.reset ();
+        }
+    }
+
+    if (filter)
+        head_ = new Layer {std::move (filter), nullptr};
+    else
+        rebuild (minKeys);
+}
+
+FilteredBackend::~FilteredBackend ()
+{
+    Layer* layer = head_.load ();
+
+    if (! deletePath_ && ! filterPath_.empty ())
+    {
+        if (layer->next != nullptr)
+        {
+            if (journal_.info) journal_.info <<
+                "Key filter for " << backend_->getName () <<
+                " grew to " << layers () << " layers and will be rebuilt";
+        }
+        else if (! layer->filter->save (filterPath_))
+        {
+            if (journal_.warning) journal_.warning <<
+                "Unable to save key filter " << filterPath_;
+            boost::system::error_code ec;
+            boost::filesystem::remove (filterPath_, ec);
+        }
+    }
+
+    while (layer != nullptr)
+    {
+        Layer* const next = layer->next;
+        delete layer;
+        layer = next;
+    }
+}
+
+void
+FilteredBackend::rebuild (std::size_t minKeys)
+{
+    // Size from the backend's own count so that one visit to each
+    // object is enough, leaving room for the backend to grow. If the
+    // count was low, the filter grows while it is being filled.
+    std::size_t const estimate = backend_->estimateKeys ();
+    head_ = new Layer {std::make_unique <KeyFilter> (
+        std::max (minKeys, estimate * 2), bitsPerKey_), nullptr};
+
+    std::size_t count = 0;
+    backend_->for_each (
+        [&](std::shared_ptr<NodeObject> object)
+        {
+            insert (object->getHash ().begin ());
+            ++count;
+        });
+
+    if (journal_.info) journal_.info <<
+        "Built key filter for " << backend_->getName () <<
+        " from " << count << " objects, " << estimate << " estimated";
+}
+
+void
+FilteredBackend::insert (void const* key)
+{
+    Layer* const head = head_.load ();
+    head->filter->insert (key);
+    if (head->filter->size () > head->filter->capacity ())
+        grow (head);
+}
+
+// Add a filter of twice the capacity in front of a full one
+void
+FilteredBackend::grow (Layer* full)
+{
+    std::lock_guard <std::mutex> lock (growMutex_);
+
+    // Another thread may have got here first
+    if (head_.load () != full)
+        return;
+
+    head_ = new Layer {std::make_unique <KeyFilter> (
+        full->filter->capacity () * 2, bitsPerKey_), full};
+
+    if (journal_.debug) journal_.debug <<
+        "Key filter for " << backend_->getName () <<
+        " grew to " << full->filter->capacity () * 2 << " keys";
+}
+
+bool
+FilteredBackend::mayContain (void const* key) const
+{
+    for (Layer* layer = head_.load (); layer != nullptr; layer = layer->next)
+    {
+        if (layer->filter->mayContain (key))
+            return true;
+    }
+    return false;
+}
+
+std::size_t
+FilteredBackend::layers () const
+{
+    std::size_t n = 0;
+    for (Layer* layer = head_.load (); layer != nullptr; layer = layer->next)
+        ++n;
+    return n;
+}
+
+Status
+FilteredBackend::fetch (void const* key, std::shared_ptr<NodeObject>* pObject)
+{
+    if (! mayContain (key))
+    {
+        pObject->reset ();
+        return notFound;
+    }
+
+    return backend_->fetch (key, pObject);
+}
+
+std::vector<std::shared_ptr<NodeObject>>
+FilteredBackend::fetchBatch (std::size_t n, void const* const* keys,
+    std::vector<Status>& status)
+{
+    std::vector<std::shared_ptr<NodeObject>> objects (n);
+    status.assign (n, notFound);
+
+    std::vector<void const*> present;
+    std::vector<std::size_t> index;
+    present.reserve (n);
+    index.reserve (n);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        if (mayContain (keys[i]))
+        {
+            present.push_back (keys[i]);
+            index.push_back (i);
+        }
+    }
+
+    if (! present.empty ())
+    {
+        std::vector<Status> foundStatus;
+        auto found = backend_->fetchBatch (
+            present.size (), present.data (), foundStatus);
+        for (std::size_t i = 0; i < found.size (); ++i)
+        {
+            objects[index[i]] = std::move (found[i]);
+            status[index[i]] = foundStatus[i];
+        }
+    }
+
+    return objects;
+}
+
+void
+FilteredBackend::store (std::shared_ptr<NodeObject> const& object)
+{
+    // The key goes into the filter first, so a concurrent fetch can never
+    // be turned away for an object the backend already holds.
+    insert (object->getHash ().begin ());
+    backend_->store (object);
+}
+
+void
+FilteredBackend::storeBatch (Batch const& batch)
+{
+    for (auto const& object : batch)
+        insert (object->getHash ().begin ());
+    backend_->storeBatch (batch);
+}
+
+void
+FilteredBackend::setDeletePath ()
+{
+    deletePath_ = true;
+    backend_->setDeletePath ();
+}
+
+}
+}
@@ -0,0 +1,173 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of divvyd: https://github.com/xdv/divvyd
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef RIPPLE_NODESTORE_FILTEREDBACKEND_H_INCLUDED
+#define RIPPLE_NODESTORE_FILTEREDBACKEND_H_INCLUDED
+
+#include <divvy/nodestore/Backend.h>
+#include <divvy/nodestore/impl/KeyFilter.h>
+#include <beast/utility/Journal.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace divvy {
+namespace NodeStore {
+
+/** A Backend that answers for keys it definitely does not hold.
+
+    Every key stored through this backend is added to a KeyFilter. A fetch
+    for a key the filter has never seen returns notFound without touching
+    the wrapped backend, which is the common case for lookups during sync
+    and for the writable backend of a rotating database.
+
+    The filter is sized from the backend's estimate of its key count. When
+    more keys than that have been stored, a filter of twice the capacity is
+    added for the new keys, and fetches consult every filter.
+
+    The filter is written to a file in the backend's directory when the
+    backend is destroyed and read back when it is opened again. The file is
+    removed once it has been read, so a process that stops without writing
+    it rebuilds the filter with one visit to every stored object. A filter
+    which grew while open is not saved, so the next open builds a single
+    filter of the right size. That visit happens in the constructor, so
+    the Manager only wraps a backend whose configuration sets
+    key_filter_bits.
+*/
+class FilteredBackend : public Backend
+{
+public:
+    /** Wrap a backend.
+        @param backend The backend which holds the objects.
+        @param path The backend's directory, or empty if it has none.
+        @param bitsPerKey The number of filter bits per key.
+        @param minKeys The smallest number of keys to size the filter for.
+    */
+    FilteredBackend (std::unique_ptr <Backend> backend,
+        std::string const& path, int bitsPerKey, std::size_t minKeys,
+            beast::Journal journal);
+
+    ~FilteredBackend ();
+
+    std::string
+    getName () override
+    {
+        return backend_->getName ();
+    }
+
+    void
+    close () override
+    {
+        backend_->close ();
+    }
+
+    Status
+    fetch (void const* key, std::shared_ptr<NodeObject>* pObject) override;
+
+    bool
+    canFetchBatch () override
+    {
+        return backend_->canFetchBatch ();
+    }
+
+    std::vector<std::shared_ptr<NodeObject>>
+    fetchBatch (std::size_t n, void const* const* keys,
+        std::vector<Status>& status) override;
+
+    void
+    store (std::shared_ptr<NodeObject> const& object) override;
+
+    void
+    storeBatch (Batch const& batch) override;
+
+    void
+    for_each (std::function <void (std::shared_ptr<NodeObject>)> f) override
+    {
+        backend_->for_each (f);
+    }
+
+    int
+    getWriteLoad () override
+    {
+        return backend_->getWriteLoad ();
+    }
+
+    std::size_t
+    estimateKeys () override
+    {
+        return backend_->estimateKeys ();
+    }
+
+    void
+    setDeletePath () override;
+
+    void
+    sync () override
+    {
+        backend_->sync ();
+    }
+
+    void
+    verify () override
+    {
+        backend_->verify ();
+    }
+
+    /** Return `false` if the backend definitely does not hold the key. */
+    bool
+    mayContain (void const* key) const;
+
+    /** Return the number of filters, which is more than one once the
+        backend has outgrown the first.
+    */
+    std::size_t
+    layers () const;
+
+private:
+    // Filters are only added while the backend is open. Keys go into
+    // the newest, and a fetch is turned away only if none has the key.
+    struct Layer
+    {
+        std::unique_ptr <KeyFilter> filter;
+        Layer* next;
+    };
+
+    void
+    rebuild (std::size_t minKeys);
+
+    void
+    insert (void const* key);
+
+    void
+    grow (Layer* full);
+
+    std::unique_ptr <Backend> backend_;
+    std::string const filterPath_;
+    int const bitsPerKey_;
+    std::atomic <Layer*> head_;
+    std::mutex growMutex_;
+    bool deletePath_;
+    beast::Journal journal_;
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,112 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of divvyd: https://github.com/xdv/divvyd
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <divvy/nodestore/HotKeys.h>
+#include <divvy/nodestore/impl/Tuning.h>
+#include <divvy/basics/UnorderedContainers.h>
+#include <fstream>
+
+namespace divvy {
+namespace NodeStore {
+
+namespace {
+
+// Identifies the file format
+std::uint64_t const hotKeysMagic = 0x314b485944564944; // "DIVDYHK1"
+
+}
+
+bool
+saveHotKeys (std::string const& path, std::vector <uint256> const& keys)
+{
+    std::vector <uint256> unique;
+    unique.reserve (std::min <std::size_t> (keys.size (), hotKeysMax));
+    hash_set <uint256> seen;
+    for (auto const& key : keys)
+    {
+        if (unique.size () >= hotKeysMax)
+            break;
+        if (seen.insert (key).second)
+            unique.push_back (key);
+    }
+
+    std::ofstream out (path, std::ios::binary | std::ios::trunc);
+    if (! out)
+        return false;
+
+    std::uint64_t const header[] = {
+        hotKeysMagic,
+        unique.size () };
+    out.write (reinterpret_cast <char const*> (header), sizeof (header));
+
+    for (auto const& key : unique)
+        out.write (reinterpret_cast <char const*> (key.begin ()), key.size ());
+
+    out.close ();
+    return ! out.fail ();
+}
+
+std::vector <uint256>
+loadHotKeys (std::string const& path)
+{
+    std::vector <uint256> keys;
+
+    std::ifstream in (path, std::ios::binary);
+    if (! in)
+        return keys;
+
+    std::uint64_t header[2];
+    if (! in.read (reinterpret_cast <char*> (header), sizeof (header)) ||
+        header[0] != hotKeysMagic || header[1] > hotKeysMax)
+        return keys;
+
+    keys.resize (static_cast <std::size_t> (header[1]));
+    for (auto& key : keys)
+    {
+        if (! in.read (reinterpret_cast <char*> (key.begin ()), key.size ()))
+        {
+            keys.clear ();
+            return keys;
+        }
+    }
+
+    return keys;
+}
+
+std::size_t
+prefetchHotKeys (Database& db, std::vector <uint256> const& keys)
+{
+    std::size_t reads = 0;
+    std::shared_ptr <NodeObject> object;
+
+    for (auto const& key : keys)
+    {
+        if (! db.asyncFetch (key, object))
+            ++reads;
+    }
+
+    if (reads != 0)
+        db.waitReads ();
+
+    return reads;
+}
+
+}
+}
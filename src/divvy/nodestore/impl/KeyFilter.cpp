@@ -0,0 +1,169 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of divvyd: https://github.com/xdv/divvyd
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <divvy/nodestore/impl/KeyFilter.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+namespace divvy {
+namespace NodeStore {
+
+namespace {
+
+// Identifies the file format. A filter written on a host with the other
+// byte order reads back with the wrong magic and is rejected.
+std::uint64_t const filterMagic = 0x31464b5944564944; // "DIVDYKF1"
+
+struct Probe
+{
+    std::uint64_t h1;
+    std::uint64_t h2;
+
+    explicit
+    Probe (void const* key)
+    {
+        std::memcpy (&h1, key, sizeof (h1));
+        std::memcpy (&h2, static_cast <char const*> (key) + sizeof (h1),
+            sizeof (h2));
+        // An odd step visits distinct positions for every probe
+        h2 |= 1;
+    }
+
+    std::uint64_t
+    operator() (int i, std::uint64_t bits) const
+    {
+        return (h1 + i * h2) % bits;
+    }
+};
+
+}
+
+KeyFilter::KeyFilter (std::size_t capacity, int bitsPerKey)
+    : capacity_ (std::max <std::size_t> (capacity, 1))
+    , bitsPerKey_ (std::max (bitsPerKey, 1))
+    , probes_ (std::min (std::max (static_cast <int> (
+        std::lround (bitsPerKey_ * 0.69)), 1), 30))
+    , bits_ (((static_cast <std::uint64_t> (capacity_) * bitsPerKey_
+        + 63) / 64) * 64)
+    , words_ (new std::atomic <std::uint64_t>[bits_ / 64])
+    , size_ (0)
+{
+    for (std::uint64_t i = 0; i < bits_ / 64; ++i)
+        words_[i].store (0, std::memory_order_relaxed);
+}
+
+void
+KeyFilter::insert (void const* key)
+{
+    Probe const probe (key);
+    bool added = false;
+
+    for (int i = 0; i < probes_; ++i)
+    {
+        auto const bit = probe (i, bits_);
+        auto const mask = std::uint64_t (1) << (bit % 64);
+        auto const prior = words_[bit / 64].fetch_or (
+            mask, std::memory_order_release);
+        if ((prior & mask) == 0)
+            added = true;
+    }
+
+    if (added)
+        size_.fetch_add (1, std::memory_order_relaxed);
+}
+
+bool
+KeyFilter::mayContain (void const* key) const
+{
+    Probe const probe (key);
+
+    for (int i = 0; i < probes_; ++i)
+    {
+        auto const bit = probe (i, bits_);
+        auto const mask = std::uint64_t (1) << (bit % 64);
+        if ((words_[bit / 64].load (std::memory_order_acquire) & mask) == 0)
+            return false;
+    }
+
+    return true;
+}
+
+bool
+KeyFilter::save (std::string const& path) const
+{
+    std::ofstream out (path, std::ios::binary | std::ios::trunc);
+    if (! out)
+        return false;
+
+    std::uint64_t const header[] = {
+        filterMagic,
+        capacity_,
+        static_cast <std::uint64_t> (bitsPerKey_),
+        size () };
+    out.write (reinterpret_cast <char const*> (header), sizeof (header));
+
+    for (std::uint64_t i = 0; i < bits_ / 64 && out; ++i)
+    {
+        auto const word = words_[i].load (std::memory_order_relaxed);
+        out.write (reinterpret_cast <char const*> (&word), sizeof (word));
+    }
+
+    out.close ();
+    return ! out.fail ();
+}
+
+std::unique_ptr <KeyFilter>
+KeyFilter::load (std::string const& path)
+{
+    std::ifstream in (path, std::ios::binary);
+    if (! in)
+        return nullptr;
+
+    std::uint64_t header[4];
+    if (! in.read (reinterpret_cast <char*> (header), sizeof (header)) ||
+        header[0] != filterMagic || header[1] == 0 ||
+            header[2] == 0 || header[2] > 64)
+        return nullptr;
+
+    std::unique_ptr <KeyFilter> filter (new KeyFilter (
+        static_cast <std::size_t> (header[1]),
+            static_cast <int> (header[2])));
+
+    for (std::uint64_t i = 0; i < filter->bits_ / 64; ++i)
+    {
+        std::uint64_t word;
+        if (! in.read (reinterpret_cast <char*> (&word), sizeof (word)))
+            return nullptr;
+        filter->words_[i].store (word, std::memory_order_relaxed);
+    }
+
+    // Anything past the bit array means the file is not ours
+    if (in.peek () != std::ifstream::traits_type::eof ())
+        return nullptr;
+
+    filter->size_.store (static_cast <std::size_t> (header[3]),
+        std::memory_order_relaxed);
+    return filter;
+}
+
+}
+}
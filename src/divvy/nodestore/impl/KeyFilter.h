@@ -0,0 +1,111 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of divvyd: https://github.com/xdv/divvyd
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef RIPPLE_NODESTORE_KEYFILTER_H_INCLUDED
+#define RIPPLE_NODESTORE_KEYFILTER_H_INCLUDED
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace divvy {
+namespace NodeStore {
+
+/** An approximate membership filter over NodeStore keys.
+
+    This is a Bloom filter. A negative answer from mayContain is exact: the
+    key was never inserted. A positive answer may be wrong, at a rate set by
+    the number of bits per key, and rising once more keys than the capacity
+    have been inserted.
+
+    Keys are the leading bytes of a SHA-512 hash and are already uniformly
+    distributed, so the probe positions are taken directly from them.
+
+    @note insert and mayContain may be called concurrently.
+*/
+class KeyFilter
+{
+public:
+    /** Create an empty filter.
+        @param capacity The number of keys the filter is sized for.
+        @param bitsPerKey The number of filter bits per key.
+    */
+    KeyFilter (std::size_t capacity, int bitsPerKey);
+
+    KeyFilter (KeyFilter const&) = delete;
+    KeyFilter& operator= (KeyFilter const&) = delete;
+
+    /** Add a key of at least 16 bytes to the filter. */
+    void
+    insert (void const* key);
+
+    /** Return `false` if the key was definitely never inserted. */
+    bool
+    mayContain (void const* key) const;
+
+    /** The number of keys the filter was sized for. */
+    std::size_t
+    capacity () const
+    {
+        return capacity_;
+    }
+
+    /** The number of bits per key the filter was sized with. */
+    int
+    bitsPerKey () const
+    {
+        return bitsPerKey_;
+    }
+
+    /** The approximate number of distinct keys inserted. */
+    std::size_t
+    size () const
+    {
+        return size_.load (std::memory_order_relaxed);
+    }
+
+    /** Write the filter to a file.
+        @return `true` on success.
+    */
+    bool
+    save (std::string const& path) const;
+
+    /** Read a filter written by save.
+        @return `nullptr` if the file is missing, truncated or was
+                written on an incompatible platform.
+    */
+    static
+    std::unique_ptr <KeyFilter>
+    load (std::string const& path);
+
+private:
+    std::size_t const capacity_;
+    int const bitsPerKey_;
+    int const probes_;
+    std::uint64_t const bits_;
+    std::unique_ptr <std::atomic <std::uint64_t>[]> words_;
+    std::atomic <std::size_t> size_;
+};
+
+}
+}
+
+#endif
@@ -21,6 +21,8 @@
 #include <divvy/nodestore/impl/ManagerImp.h>
 #include <divvy/nodestore/impl/DatabaseImp.h>
 #include <divvy/nodestore/impl/DatabaseRotatingImp.h>
+#include <divvy/nodestore/impl/FilteredBackend.h>
+#include <divvy/nodestore/impl/Tuning.h>
 #include <divvy/basics/StringUtilities.h>
 #include <beast/utility/ci_char_traits.h>
 #include <beast/cxx14/memory.h> // <memory>
@@ -82,6 +84,19 @@ ManagerImp::make_Backend (
         missing_backend ();
     }
 
+    int bitsPerKey = filterBitsPerKey;
+    get_if_exists (parameters, "key_filter_bits", bitsPerKey);
+
+    if (bitsPerKey > 0 && ! beast::ci_equal (type, std::string ("none")))
+    {
+        std::size_t minKeys = filterMinKeys;
+        get_if_exists (parameters, "key_filter_keys", minKeys);
+
+        backend = std::make_unique <FilteredBackend> (std::move (backend),
+            get<std::string> (parameters, "path"), bitsPerKey, minKeys,
+                journal);
+    }
+
     return backend;
 }
 
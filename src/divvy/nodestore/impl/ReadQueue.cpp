@@ -0,0 +1,173 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of divvyd: https://github.com/xdv/divvyd
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <divvy/nodestore/impl/ReadQueue.h>
+#include <algorithm>
+#include <iterator>
+
+namespace divvy {
+namespace NodeStore {
+
+ReadQueue::ReadQueue ()
+    : closed_ (false)
+{
+    std::fill (std::begin (queued_), std::end (queued_), 0);
+    std::fill (std::begin (retired_), std::end (retired_), 0);
+}
+
+bool
+ReadQueue::push (uint256 const& hash, ReadPriority priority)
+{
+    {
+        std::lock_guard <std::mutex> lock (mutex_);
+
+        auto const result = pending_.emplace (hash, Entry {priority, false});
+        if (! result.second)
+        {
+            Entry& entry = result.first->second;
+            if (entry.reading || entry.priority <= priority)
+                return false;
+
+            // Move it up. The entry in the old queue goes stale.
+            entry.priority = priority;
+        }
+
+        queues_[priority].push_back (hash);
+        ++queued_[priority];
+    }
+
+    // Readers which skip background reads must not absorb the wakeup
+    if (priority == readBackground)
+        readable_.notify_all ();
+    else
+        readable_.notify_one ();
+
+    return true;
+}
+
+bool
+ReadQueue::pop (std::vector <uint256>& hashes, ReadPriority& priority,
+    std::size_t limit, bool background)
+{
+    hashes.clear ();
+
+    std::unique_lock <std::mutex> lock (mutex_);
+    std::uint64_t stale = 0;
+
+    for (;;)
+    {
+        if (closed_)
+            return false;
+
+        int const end = background ? readPriorityCount : readBackground;
+        for (int i = 0; i < end; ++i)
+        {
+            auto& queue = queues_[i];
+            while (! queue.empty () && hashes.size () < limit)
+            {
+                auto const iter = pending_.find (queue.front ());
+                if (iter != pending_.end () &&
+                    iter->second.priority == i && ! iter->second.reading)
+                {
+                    iter->second.reading = true;
+                    hashes.push_back (queue.front ());
+                }
+                else
+                {
+                    ++retired_[i];
+                    ++stale;
+                }
+                queue.pop_front ();
+            }
+
+            if (! hashes.empty ())
+            {
+                priority = static_cast <ReadPriority> (i);
+                break;
+            }
+        }
+
+        if (stale != 0)
+        {
+            stale = 0;
+            finished_.notify_all ();
+        }
+
+        if (! hashes.empty ())
+            return true;
+
+        readable_.wait (lock);
+    }
+}
+
+void
+ReadQueue::finish (std::vector <uint256> const& hashes, ReadPriority priority)
+{
+    {
+        std::lock_guard <std::mutex> lock (mutex_);
+        for (auto const& hash : hashes)
+            pending_.erase (hash);
+        retired_[priority] += hashes.size ();
+    }
+
+    finished_.notify_all ();
+}
+
+void
+ReadQueue::wait (ReadPriority priority)
+{
+    std::unique_lock <std::mutex> lock (mutex_);
+
+    std::uint64_t target[readPriorityCount];
+    std::copy (std::begin (queued_), std::end (queued_), std::begin (target));
+
+    auto const done = [&]
+    {
+        for (int i = 0; i <= priority; ++i)
+            if (retired_[i] < target[i])
+                return false;
+        return true;
+    };
+
+    while (! closed_ && ! done ())
+        finished_.wait (lock);
+}
+
+void
+ReadQueue::close ()
+{
+    {
+        std::lock_guard <std::mutex> lock (mutex_);
+        closed_ = true;
+    }
+
+    readable_.notify_all ();
+    finished_.notify_all ();
+}
+
+std::size_t
+ReadQueue::size () const
+{
+    std::lock_guard <std::mutex> lock (mutex_);
+    return pending_.size ();
+}
+
+}
+}
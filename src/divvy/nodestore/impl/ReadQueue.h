@@ -0,0 +1,114 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of divvyd: https://github.com/xdv/divvyd
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef RIPPLE_NODESTORE_READQUEUE_H_INCLUDED
+#define RIPPLE_NODESTORE_READQUEUE_H_INCLUDED
+
+#include <divvy/nodestore/Types.h>
+#include <divvy/basics/base_uint.h>
+#include <divvy/basics/UnorderedContainers.h>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace divvy {
+namespace NodeStore {
+
+/** The queue of pending async reads.
+
+    There is a FIFO queue for each ReadPriority. Readers always take
+    from the most urgent non-empty queue. A key is queued at most once:
+    a request for a key which is already queued or being read is
+    coalesced with it. A more urgent request for a key still sitting in
+    a less urgent queue moves it up, leaving a stale entry behind which
+    readers skip.
+
+    The lock is only held to push or pop keys, never during a read.
+
+    @note All members may be called concurrently.
+*/
+class ReadQueue
+{
+public:
+    ReadQueue ();
+
+    ReadQueue (ReadQueue const&) = delete;
+    ReadQueue& operator= (ReadQueue const&) = delete;
+
+    /** Queue a read.
+        @return `false` if the read was coalesced with a pending one.
+    */
+    bool
+    push (uint256 const& hash, ReadPriority priority);
+
+    /** Take reads of the most urgent class available, blocking if none.
+        @param hashes [out] Up to `limit` keys to read.
+        @param priority [out] The class the keys were taken from.
+        @param background `false` to never take readBackground keys.
+        @return `false` if the queue was closed.
+    */
+    bool
+    pop (std::vector <uint256>& hashes, ReadPriority& priority,
+        std::size_t limit, bool background);
+
+    /** Retire keys returned by pop once they have been read. */
+    void
+    finish (std::vector <uint256> const& hashes, ReadPriority priority);
+
+    /** Wait for reads queued before the call to finish.
+        Only reads at `priority` or a more urgent class are waited for.
+        @note Reads finish out of order, so this returns once as many
+              reads have finished as had been queued, which need not
+              be exactly the same reads.
+    */
+    void
+    wait (ReadPriority priority);
+
+    /** Wake all waiting threads and make pop return `false`. */
+    void
+    close ();
+
+    /** Return the number of keys queued or being read. */
+    std::size_t
+    size () const;
+
+private:
+    struct Entry
+    {
+        ReadPriority priority;
+        bool reading;
+    };
+
+    mutable std::mutex mutex_;
+    std::condition_variable readable_;
+    std::condition_variable finished_;
+    std::deque <uint256> queues_[readPriorityCount];
+    hash_map <uint256, Entry> pending_;
+    // Entries ever pushed to and retired from each queue
+    std::uint64_t queued_[readPriorityCount];
+    std::uint64_t retired_[readPriorityCount];
+    bool closed_;
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,53 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of divvyd: https://github.com/xdv/divvyd
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <divvy/nodestore/ScopedUncachedReads.h>
+#include <boost/thread/tss.hpp>
+
+namespace divvy {
+namespace NodeStore {
+
+static
+void
+cleanup (ScopedUncachedReads*)
+{
+}
+
+static
+boost::thread_specific_ptr<ScopedUncachedReads> scopedUncachedReadsPtr (&cleanup);
+
+ScopedUncachedReads::ScopedUncachedReads ()
+    : prev_ (scopedUncachedReadsPtr.get ())
+{
+    scopedUncachedReadsPtr.reset (this);
+}
+
+ScopedUncachedReads::~ScopedUncachedReads ()
+{
+    scopedUncachedReadsPtr.reset (prev_);
+}
+
+bool
+ScopedUncachedReads::active ()
+{
+    return scopedUncachedReadsPtr.get () != nullptr;
+}
+
+}
+}
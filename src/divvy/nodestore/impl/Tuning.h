@@ -33,6 +33,24 @@ enum
 
     // Fraction of the cache one query source can take
     ,asyncDivider = 8
+
+    // Maximum number of queued reads an async
+    // read thread takes from the read set at once
+    ,asyncReadBatch = 64
+
+    // Default bits per key of a backend's key filter. Zero leaves the
+    // filter off, since without a saved filter every object is read
+    // at open to build it. Ten bits gives about 1% false positives.
+    ,filterBitsPerKey = 0
+
+    // Smallest number of keys a backend's key filter is sized for
+    ,filterMinKeys = 16 * 1024 * 1024
+
+    // Most keys saved for prefetching after a restart
+    ,hotKeysMax = 256 * 1024
+
+    // Levels of the state map below the root whose keys are saved
+    ,hotKeysStateDepth = 4
 };
 
 }
@@ -21,6 +21,7 @@
 #define RIPPLE_NODESTORE_CODEC_H_INCLUDED
 
 #include <divvy/nodestore/NodeObject.h>
+#include <divvy/nodestore/impl/CompressionDictionary.h>
 #include <divvy/protocol/HashPrefix.h>
 #include <beast/nudb/common.h>
 #include <beast/nudb/detail/field.h>
@@ -138,6 +139,7 @@ lz4_compress (void const* in,
     1 = lz4 compressed
     2 = inner node compressed
     3 = full inner node
+    4 = lz4 compressed with a dictionary
 */
 
 template <class BufferFactory>
@@ -234,6 +236,39 @@ nodeobject_decompress (void const* in,
         write(os, is(512), 512);
         break;
     }
+    case 4: // lz4 with dictionary
+    {
+        if (in_size < field<std::uint32_t>::size)
+            throw codec_error(
+                "nodeobject codec: short dictionary id");
+        istream is(p, in_size);
+        std::uint32_t id;
+        read<std::uint32_t>(is, id);        // Dictionary
+        p += field<std::uint32_t>::size;
+        in_size -= field<std::uint32_t>::size;
+        auto const dictionary =
+            CompressionDictionary::find(id);
+        if (! dictionary)
+            throw codec_error(
+                "nodeobject codec: unknown dictionary=" +
+                    std::to_string(id));
+        std::size_t size;
+        auto const vn = read_varint(
+            p, in_size, size);              // Size
+        if (vn == 0)
+            throw codec_error(
+                "nodeobject decompress");
+        p += vn;
+        in_size -= vn;
+        void* const out = bf(size);
+        result.first = out;
+        result.second = size;
+        if (dictionary->decompress(p, in_size, out, size) !=
+                static_cast<int>(size))
+            throw codec_error(
+                "nodeobject codec: bad dictionary data");
+        break;
+    }
     default:
         throw codec_error(
             "nodeobject codec: bad type=" +
@@ -259,7 +294,8 @@ zero32()
 template <class BufferFactory>
 std::pair<void const*, std::size_t>
 nodeobject_compress (void const* in,
-    std::size_t in_size, BufferFactory&& bf)
+    std::size_t in_size, BufferFactory&& bf,
+        CompressionDictionary const* dictionary = nullptr)
 {
     using beast::nudb::codec_error;
     using namespace beast::nudb::detail;
@@ -331,6 +367,30 @@ nodeobject_compress (void const* in,
         }
     }
 
+    if (dictionary)
+    {
+        // 4 = lz4 with dictionary
+        auto const type = 4U;
+        auto const vs =
+            size_varint(type) +
+            field<std::uint32_t>::size +    // dictionary
+            size_varint(in_size);           // size
+        auto const out_max =
+            LZ4_compressBound(in_size);
+        std::uint8_t* out = reinterpret_cast<
+            std::uint8_t*>(bf(vs + out_max));
+        ostream os(out, vs);
+        write<varint>(os, type);
+        write<std::uint32_t>(os, dictionary->id());
+        write<varint>(os, in_size);
+        auto const n = dictionary->compress(
+            in, in_size, out + vs, out_max);
+        if (n <= 0)
+            throw codec_error(
+                "nodeobject compress");
+        return std::make_pair(out, vs + n);
+    }
+
     std::array<std::uint8_t, varint_traits<
         std::size_t>::max> vi;
     auto const vn = write_varint(
@@ -476,6 +536,9 @@ public:
 
 class nodeobject_codec
 {
+private:
+    CompressionDictionary const* dictionary_ = nullptr;
+
 public:
     template <class... Args>
     explicit
@@ -483,6 +546,17 @@ public:
     {
     }
 
+    /** Compress leaf objects with a dictionary.
+        Decompression finds dictionaries by the id in each record,
+        so this only affects new records. The dictionary must
+        outlive the codec.
+    */
+    void
+    dictionary (CompressionDictionary const* dictionary)
+    {
+        dictionary_ = dictionary;
+    }
+
     char const*
     name() const
     {
@@ -504,7 +578,7 @@ public:
         std::size_t in_size, BufferFactory&& bf) const
     {
         return detail::nodeobject_compress(
-            in, in_size, bf);
+            in, in_size, bf, dictionary_);
     }
 };
 
@@ -21,6 +21,7 @@
 #include <divvy/nodestore/tests/Base.test.h>
 #include <divvy/nodestore/DummyScheduler.h>
 #include <divvy/nodestore/Manager.h>
+#include <divvy/nodestore/impl/CompressionDictionary.h>
 #include <beast/module/core/diagnostic/UnitTestUtilities.h>
 
 namespace divvy {
@@ -32,16 +33,22 @@ class Backend_test : public TestBase
 {
 public:
     void testBackend (std::string const& type, std::int64_t const seedValue,
-                      int numObjectsToTest = 2000)
+                      int numObjectsToTest = 2000,
+                      std::string const& option = "")
     {
         DummyScheduler scheduler;
 
-        testcase ("Backend type=" + type);
+        testcase ("Backend type=" + type +
+            (option.empty () ? "" : " " + option));
 
         Section params;
         beast::UnitTestUtilities::TempDirectory path ("node_db");
+        auto const dictionaryPath = path.getFullPathName ().toStdString () +
+            "/nudb.dict";
         params.set ("type", type);
         params.set ("path", path.getFullPathName ().toStdString ());
+        if (! option.empty ())
+            params.set (option, "1");
 
         // Create a batch
         Batch batch;
@@ -54,8 +61,12 @@ public:
             std::unique_ptr <Backend> backend =
                 Manager::instance().make_Backend (params, scheduler, j);
 
+            // An empty backend has nothing to train a dictionary with
+            expect (CompressionDictionary::load (dictionaryPath).empty ());
+
             // Write the batch
             storeBatch (*backend, batch);
+            backend->sync ();
 
             {
                 // Read it back in
@@ -71,6 +82,14 @@ public:
                 fetchCopyOfBatch (*backend, &copy, batch);
                 expect (areBatchesEqual (batch, copy), "Should be equal");
             }
+
+            if (backend->canFetchBatch ())
+            {
+                // Read it back in as a single batch
+                Batch copy;
+                fetchBatchCopyOfBatch (*backend, &copy, batch);
+                expect (areBatchesEqual (batch, copy), "Should be equal");
+            }
         }
 
         {
@@ -85,6 +104,32 @@ public:
             std::sort (batch.begin (), batch.end (), LessThan{});
             std::sort (copy.begin (), copy.end (), LessThan{});
             expect (areBatchesEqual (batch, copy), "Should be equal");
+
+            // Objects stored now may use a dictionary trained
+            // from the ones stored before, and never one from
+            // another backend
+            if (option == "dictionary")
+                expect (CompressionDictionary::load (
+                    dictionaryPath).size () == 1, "Should train");
+            else
+                expect (CompressionDictionary::load (
+                    dictionaryPath).empty ());
+            Batch more;
+            createPredictableBatch (more, numObjectsToTest, seedValue + 1);
+            storeBatch (*backend, more);
+            batch.insert (batch.end (), more.begin (), more.end ());
+        }
+
+        {
+            // Re-open the backend again
+            std::unique_ptr <Backend> backend = Manager::instance().make_Backend (
+                params, scheduler, j);
+
+            Batch copy;
+            fetchCopyOfBatch (*backend, &copy, batch);
+            std::sort (batch.begin (), batch.end (), LessThan{});
+            std::sort (copy.begin (), copy.end (), LessThan{});
+            expect (areBatchesEqual (batch, copy), "Should be equal");
         }
     }
 
@@ -95,9 +140,11 @@ public:
         int const seedValue = 50;
 
         testBackend ("nudb", seedValue);
+        testBackend ("nudb", seedValue, 2000, "dictionary");
 
     #if RIPPLE_ROCKSDB_AVAILABLE
         testBackend ("rocksdb", seedValue);
+        testBackend ("rocksdb", seedValue, 2000, "direct_write");
     #endif
 
     #ifdef RIPPLE_ENABLE_SQLITE_BACKEND_TESTS
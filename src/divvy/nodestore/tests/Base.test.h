@@ -25,6 +25,7 @@
 #include <beast/unit_test/suite.h>
 #include <beast/module/core/maths/Random.h>
 #include <boost/algorithm/string.hpp>
+#include <algorithm>
 #include <iomanip>
 
 namespace divvy {
@@ -180,6 +181,35 @@ public:
         }
     }
 
+    // Get a copy of a batch in a backend using a single batch fetch
+    void fetchBatchCopyOfBatch (Backend& backend, Batch* pCopy, Batch const& batch)
+    {
+        pCopy->clear ();
+        pCopy->reserve (batch.size ());
+
+        std::vector <void const*> keys;
+        keys.reserve (batch.size ());
+        for (int i = 0; i < batch.size (); ++i)
+            keys.push_back (batch [i]->getHash ().cbegin ());
+
+        std::vector <Status> status;
+        auto const objects = backend.fetchBatch (
+            keys.size (), keys.data (), status);
+
+        expect (objects.size () == batch.size (), "Wrong size");
+        expect (status.size () == batch.size (), "Wrong size");
+        expect (std::all_of (status.begin (), status.end (),
+            [](Status s) { return s == ok; }), "Should be ok");
+
+        for (auto const& object : objects)
+        {
+            expect (object != nullptr, "Should not be null");
+
+            if (object != nullptr)
+                pCopy->push_back (object);
+        }
+    }
+
     void fetchMissing(Backend& backend, Batch const& batch)
     {
         for (int i = 0; i < batch.size (); ++i)
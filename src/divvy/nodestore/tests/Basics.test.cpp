@@ -21,8 +21,12 @@
 #include <divvy/nodestore/tests/Base.test.h>
 #include <divvy/nodestore/DummyScheduler.h>
 #include <divvy/nodestore/Manager.h>
+#include <divvy/nodestore/impl/codec.h>
 #include <divvy/nodestore/impl/DecodedBlob.h>
 #include <divvy/nodestore/impl/EncodedBlob.h>
+#include <beast/module/core/diagnostic/UnitTestUtilities.h>
+#include <beast/nudb/detail/buffer.h>
+#include <boost/filesystem.hpp>
 
 namespace divvy {
 namespace NodeStore {
@@ -77,6 +81,118 @@ public:
         }
     }
 
+    // Small values which share structure, like ledger entries
+    static std::vector <Blob> makeLeaves (int count, std::int64_t seedValue)
+    {
+        beast::Random r (seedValue);
+        std::vector <Blob> leaves;
+        for (int i = 0; i < count; ++i)
+        {
+            Blob leaf (9, 0);
+            leaf[8] = hotACCOUNT_NODE;
+            for (int field = 0; field < 6; ++field)
+            {
+                static char const header[] = "\x11\x00\x61\x22\x00\x00";
+                leaf.insert (leaf.end (), header, header + 6);
+                leaf.push_back (static_cast <std::uint8_t> (field));
+                auto const n = leaf.size ();
+                leaf.resize (n + 4 + r.nextInt (8));
+                r.fillBitsRandomly (&leaf[n], leaf.size () - n);
+            }
+            leaves.push_back (std::move (leaf));
+        }
+        return leaves;
+    }
+
+    void testDictionary (std::int64_t const seedValue)
+    {
+        testcase ("dictionary");
+
+        using beast::nudb::detail::buffer;
+
+        auto const leaves = makeLeaves (1000, seedValue);
+        auto const dictionary = CompressionDictionary::train (leaves);
+        if (! expect (dictionary != nullptr, "Should train"))
+            return;
+        expect (dictionary->data ().size () <= CompressionDictionary::maxSize);
+        expect (! CompressionDictionary::train (makeLeaves (10, seedValue)),
+            "Too few samples");
+
+        CompressionDictionary::add (dictionary);
+        expect (CompressionDictionary::find (dictionary->id ()) ==
+            dictionary.get ());
+
+        nodeobject_codec plain;
+        nodeobject_codec shared;
+        shared.dictionary (dictionary.get ());
+
+        auto const leaves2 = makeLeaves (200, seedValue + 1);
+        Blob first;
+        {
+            buffer b;
+            auto const c = shared.compress (
+                leaves2[0].data (), leaves2[0].size (), b);
+            auto const p = static_cast <std::uint8_t const*> (c.first);
+            first.assign (p, p + c.second);
+        }
+
+        std::size_t plainSize = 0;
+        std::size_t sharedSize = 0;
+        bool same = true;
+        for (auto const& leaf : leaves2)
+        {
+            buffer b1, b2, b3;
+            plainSize += plain.compress (
+                leaf.data (), leaf.size (), b1).second;
+            auto const c = shared.compress (leaf.data (), leaf.size (), b2);
+            sharedSize += c.second;
+            // Any codec reads records written with a dictionary
+            auto const d = plain.decompress (c.first, c.second, b3);
+            same = same && d.second == leaf.size () &&
+                std::memcmp (d.first, leaf.data (), leaf.size ()) == 0;
+        }
+        expect (same, "Should round trip");
+        expect (sharedSize < plainSize, "Dictionary should help");
+
+        {
+            // Earlier compressions leave nothing behind in the stream
+            buffer b;
+            auto const c = shared.compress (
+                leaves2[0].data (), leaves2[0].size (), b);
+            auto const p = static_cast <std::uint8_t const*> (c.first);
+            expect (Blob (p, p + c.second) == first, "Should repeat");
+        }
+
+        // Objects which are not leaves still round trip
+        Batch batch;
+        createPredictableBatch (batch, numObjectsToTest, seedValue);
+        same = true;
+        for (auto const& object : batch)
+        {
+            EncodedBlob encoded;
+            encoded.prepare (object);
+            buffer b1, b2;
+            auto const c = shared.compress (
+                encoded.getData (), encoded.getSize (), b1);
+            auto const d = shared.decompress (c.first, c.second, b2);
+            same = same && d.second == encoded.getSize () &&
+                std::memcmp (d.first, encoded.getData (), d.second) == 0;
+        }
+        expect (same, "Should round trip");
+
+        beast::UnitTestUtilities::TempDirectory dir ("dictionary");
+        boost::filesystem::path const folder (
+            dir.getFullPathName ().toStdString ());
+        boost::filesystem::create_directories (folder);
+        auto const path = (folder / "nudb.dict").string ();
+        expect (CompressionDictionary::load (path).empty ());
+        CompressionDictionary::save (path, { dictionary });
+        auto const loaded = CompressionDictionary::load (path);
+        expect (loaded.size () == 1 &&
+            loaded[0]->id () == dictionary->id () &&
+                loaded[0]->data () == dictionary->data ());
+    }
+
     void run ()
     {
         std::int64_t const seedValue = 50;
@@ -84,6 +200,8 @@ public:
         testBatches (seedValue);
 
         testBlobs (seedValue);
+
+        testDictionary (seedValue);
     }
 };
 
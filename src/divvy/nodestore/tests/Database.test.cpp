@@ -20,8 +20,12 @@
 #include <BeastConfig.h>
 #include <divvy/nodestore/tests/Base.test.h>
 #include <divvy/nodestore/DummyScheduler.h>
+#include <divvy/nodestore/HotKeys.h>
 #include <divvy/nodestore/Manager.h>
+#include <divvy/nodestore/ScopedUncachedReads.h>
 #include <beast/module/core/diagnostic/UnitTestUtilities.h>
+#include <boost/filesystem.hpp>
+#include <algorithm>
 
 namespace divvy {
 namespace NodeStore {
@@ -115,6 +119,7 @@ public:
 
             // Write the batch
             storeBatch (*db, batch);
+            db->sync ();
 
             {
                 // Read it back in
@@ -153,6 +158,247 @@ public:
 
     //--------------------------------------------------------------------------
 
+    void testHotKeys (std::int64_t const seedValue)
+    {
+        testcase ("hot keys");
+
+        DummyScheduler scheduler;
+        beast::Journal j;
+
+        beast::UnitTestUtilities::TempDirectory node_db ("node_db");
+        Section params;
+        params.set ("type", "nudb");
+        params.set ("path", node_db.getFullPathName ().toStdString ());
+
+        Batch batch;
+        createPredictableBatch (batch, numObjectsToTest, seedValue);
+
+        beast::UnitTestUtilities::TempDirectory dir ("hot_keys");
+        boost::filesystem::create_directories (
+            dir.getFullPathName ().toStdString ());
+        std::string const path = dir.getFullPathName ().toStdString () +
+            "/hotkeys";
+
+        {
+            std::unique_ptr <Database> db = Manager::instance().make_Database (
+                "test", scheduler, j, 2, params);
+            storeBatch (*db, batch);
+
+            // Duplicates are only written once
+            auto keys = db->getCacheKeys ();
+            expect (keys.size () == batch.size (), "cache keys");
+            keys.insert (keys.end (), keys.begin (), keys.end ());
+            expect (saveHotKeys (path, keys), "save");
+        }
+
+        auto const keys = loadHotKeys (path);
+        expect (keys.size () == batch.size (), "load");
+        expect (loadHotKeys (path + ".missing").empty (), "missing file");
+
+        {
+            // A fresh database has to read them all
+            std::unique_ptr <Database> db = Manager::instance().make_Database (
+                "test", scheduler, j, 2, params);
+            expect (prefetchHotKeys (*db, keys) == keys.size (), "prefetch");
+            expect (db->getCacheKeys ().size () == keys.size (), "cached");
+            expect (prefetchHotKeys (*db, keys) == 0, "already cached");
+        }
+    }
+
+    //--------------------------------------------------------------------------
+
+    void testCacheAdmission (std::int64_t const seedValue)
+    {
+        testcase ("cache admission");
+
+        DummyScheduler scheduler;
+        beast::Journal j;
+
+        beast::UnitTestUtilities::TempDirectory node_db ("node_db");
+        Section params;
+        params.set ("type", "nudb");
+        params.set ("path", node_db.getFullPathName ().toStdString ());
+
+        Batch batch;
+        createPredictableBatch (batch, numObjectsToTest, seedValue);
+        std::vector <uint256> hashes;
+        for (auto const& object : batch)
+            hashes.push_back (object->getHash ());
+
+        {
+            std::unique_ptr <Database> db = Manager::instance().make_Database (
+                "test", scheduler, j, 2, params);
+            storeBatch (*db, batch);
+        }
+
+        {
+            // Uncached reads find the objects but leave the cache empty
+            std::unique_ptr <Database> db = Manager::instance().make_Database (
+                "test", scheduler, j, 2, params);
+            {
+                ScopedUncachedReads uncached;
+                bool found = true;
+                for (auto const& hash : hashes)
+                    found = found && db->fetch (hash) != nullptr;
+                expect (found, "uncached fetch");
+                auto const objects = db->fetchBatch (hashes);
+                expect (std::count (objects.begin (), objects.end (),
+                    nullptr) == 0, "uncached fetch batch");
+            }
+            expect (db->getCacheKeys ().empty (), "not cached");
+
+            // Until the cache is full everything is admitted
+            db->fetchBatch (hashes);
+            expect (db->getCacheKeys ().size () == hashes.size (), "cached");
+        }
+
+        {
+            // Once full, an object must have been asked for before. The
+            // cache is sharded, so give each shard room for one object.
+            std::unique_ptr <Database> db = Manager::instance().make_Database (
+                "test", scheduler, j, 2, params);
+            db->tune (16, 60);
+            for (auto const& hash : hashes)
+                db->fetch (hash);
+            auto const cached = db->getCacheKeys ();
+            expect (! cached.empty () && cached.size () <= 16, "filled");
+
+            // Find an object that was turned away and ask again
+            auto const iter = std::find_if (hashes.begin (), hashes.end (),
+                [&cached](uint256 const& hash)
+                {
+                    return std::find (cached.begin (), cached.end (),
+                        hash) == cached.end ();
+                });
+            expect (iter != hashes.end (), "rejected");
+            if (iter != hashes.end ())
+            {
+                expect (db->fetch (*iter) != nullptr, "fetch again");
+                expect (db->getCacheKeys ().size () == cached.size () + 1,
+                    "admitted");
+            }
+        }
+
+        {
+            // A single async read of a cold key counts as one request
+            std::unique_ptr <Database> db = Manager::instance().make_Database (
+                "test", scheduler, j, 2, params);
+            db->tune (16, 60);
+            for (std::size_t i = 0; i + 1 < hashes.size (); ++i)
+                db->fetch (hashes[i]);
+            auto const cached = db->getCacheKeys ();
+
+            std::shared_ptr <NodeObject> object;
+            expect (! db->asyncFetch (hashes.back (), object), "posted");
+            db->waitReads ();
+            auto const after = db->getCacheKeys ();
+            expect (after.size () == cached.size () &&
+                std::find (after.begin (), after.end (),
+                    hashes.back ()) == after.end (), "not admitted");
+        }
+    }
+
+    void testAsyncStore (std::int64_t const seedValue)
+    {
+        testcase ("async store batch");
+
+        DummyScheduler scheduler;
+        beast::UnitTestUtilities::TempDirectory node_db ("node_db");
+        Section nodeParams;
+        nodeParams.set ("type", "nudb");
+        nodeParams.set ("path", node_db.getFullPathName ().toStdString ());
+
+        Batch batch;
+        createPredictableBatch (batch, 1000, seedValue);
+
+        beast::Journal j;
+
+        {
+            std::unique_ptr <Database> db = Manager::instance().make_Database (
+                "test", scheduler, j, 2, nodeParams);
+
+            db->asyncStoreBatch (batch);
+            db->sync ();
+            expect (db->getWriteLoad () == 0, "written");
+
+            Batch copy;
+            fetchCopyOfBatch (*db, &copy, batch);
+            expect (areBatchesEqual (batch, copy), "Should be equal");
+        }
+
+        {
+            // The queued writes reached the backend
+            std::unique_ptr <Database> db = Manager::instance().make_Database (
+                "test", scheduler, j, 2, nodeParams);
+
+            Batch copy;
+            fetchCopyOfBatch (*db, &copy, batch);
+            std::sort (batch.begin (), batch.end (), LessThan{});
+            std::sort (copy.begin (), copy.end (), LessThan{});
+            expect (areBatchesEqual (batch, copy), "Should be equal");
+        }
+    }
+
+    //--------------------------------------------------------------------------
+
+    // Counts the objects fetch reports say were read from disk
+    struct CountingScheduler : DummyScheduler
+    {
+        int reads = 0;
+
+        void onFetch (FetchReport const& report) override
+        {
+            if (report.wentToDisk)
+                reads += report.fetchCount;
+        }
+    };
+
+    void testFetchReports (std::int64_t const seedValue)
+    {
+        testcase ("fetch reports");
+
+        CountingScheduler scheduler;
+        beast::UnitTestUtilities::TempDirectory node_db ("node_db");
+        Section nodeParams;
+        nodeParams.set ("type", "nudb");
+        nodeParams.set ("path", node_db.getFullPathName ().toStdString ());
+
+        Batch batch;
+        createPredictableBatch (batch, 100, seedValue);
+        std::vector <uint256> hashes;
+        for (auto const& object : batch)
+            hashes.push_back (object->getHash ());
+
+        beast::Journal j;
+
+        {
+            std::unique_ptr <Database> db = Manager::instance().make_Database (
+                "test", scheduler, j, 2, nodeParams);
+            storeBatch (*db, batch);
+        }
+
+        {
+            std::unique_ptr <Database> db = Manager::instance().make_Database (
+                "test", scheduler, j, 2, nodeParams);
+
+            // A batch is reported as one read per object
+            db->fetchBatch (hashes);
+            expect (scheduler.reads == hashes.size (), "batch reads");
+            expect (db->getFetchHitCount () == hashes.size (), "batch hits");
+
+            // Cached objects do not go to disk again
+            db->fetchBatch (hashes);
+            expect (scheduler.reads == hashes.size (), "cached reads");
+
+            uint256 missing;
+            missing.SetHex ("DEADBEEF");
+            db->fetch (missing);
+            expect (scheduler.reads == hashes.size () + 1, "single read");
+        }
+    }
+
+    //--------------------------------------------------------------------------
+
     void runBackendTests (std::int64_t const seedValue)
     {
         testNodeStore ("nudb", true, seedValue);
@@ -188,6 +434,14 @@ public:
         runBackendTests (seedValue);
 
         runImportTests (seedValue);
+
+        testHotKeys (seedValue);
+
+        testCacheAdmission (seedValue);
+
+        testAsyncStore (seedValue);
+
+        testFetchReports (seedValue);
     }
 };
 
@@ -0,0 +1,271 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of divvyd: https://github.com/xdv/divvyd
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include <BeastConfig.h>
+#include <divvy/nodestore/tests/Base.test.h>
+#include <divvy/nodestore/impl/FilteredBackend.h>
+#include <divvy/nodestore/impl/KeyFilter.h>
+#include <divvy/nodestore/DummyScheduler.h>
+#include <divvy/nodestore/Manager.h>
+#include <beast/module/core/diagnostic/UnitTestUtilities.h>
+#include <boost/filesystem.hpp>
+
+namespace divvy {
+namespace NodeStore {
+
+class KeyFilter_test : public TestBase
+{
+public:
+    void testFilter ()
+    {
+        testcase ("filter");
+
+        Batch stored;
+        createPredictableBatch (stored, 10000, 1);
+        Batch other;
+        createPredictableBatch (other, 10000, 2);
+
+        KeyFilter filter (stored.size (), 10);
+        for (auto const& object : stored)
+            filter.insert (object->getHash ().begin ());
+
+        bool allFound = true;
+        for (auto const& object : stored)
+            allFound = allFound && filter.mayContain (object->getHash ().begin ());
+        expect (allFound, "Stored keys should be found");
+
+        int falsePositives = 0;
+        for (auto const& object : other)
+            if (filter.mayContain (object->getHash ().begin ()))
+                ++falsePositives;
+        expect (falsePositives < 300, "Too many false positives");
+
+        expect (filter.size () > 9900 && filter.size () <= 10000,
+            "Size should count distinct keys");
+    }
+
+    void testSaveLoad ()
+    {
+        testcase ("save and load");
+
+        beast::UnitTestUtilities::TempDirectory dir ("key_filter");
+        boost::filesystem::path const folder (
+            dir.getFullPathName ().toStdString ());
+        boost::filesystem::create_directories (folder);
+        auto const path = (folder / "keys.filter").string ();
+
+        Batch stored;
+        createPredictableBatch (stored, 1000, 3);
+
+        {
+            KeyFilter filter (stored.size (), 12);
+            for (auto const& object : stored)
+                filter.insert (object->getHash ().begin ());
+            expect (filter.save (path), "Should save");
+        }
+
+        auto filter = KeyFilter::load (path);
+        if (! expect (filter != nullptr, "Should load"))
+            return;
+        expect (filter->capacity () == stored.size ());
+        expect (filter->bitsPerKey () == 12);
+        bool allFound = true;
+        for (auto const& object : stored)
+            allFound = allFound && filter->mayContain (object->getHash ().begin ());
+        expect (allFound, "Loaded filter should find stored keys");
+
+        boost::filesystem::resize_file (path,
+            boost::filesystem::file_size (path) - 1);
+        expect (KeyFilter::load (path) == nullptr,
+            "Truncated filter should be rejected");
+    }
+
+    void testBackend (std::string const& type)
+    {
+        testcase ("backend type=" + type);
+
+        DummyScheduler scheduler;
+        beast::Journal j;
+        beast::UnitTestUtilities::TempDirectory dir ("node_db");
+        auto const path = dir.getFullPathName ().toStdString ();
+
+        Section params;
+        params.set ("type", type);
+        params.set ("path", path);
+        params.set ("key_filter_bits", "10");
+        params.set ("key_filter_keys", "1000");
+
+        Batch stored;
+        createPredictableBatch (stored, 1000, 4);
+        Batch other;
+        createPredictableBatch (other, 1000, 5);
+
+        {
+            auto backend = Manager::instance().make_Backend (
+                params, scheduler, j);
+            storeBatch (*backend, stored);
+            fetchMissing (*backend, other);
+
+            auto filtered = dynamic_cast <FilteredBackend*> (backend.get ());
+            if (expect (filtered != nullptr, "Backend should be filtered"))
+            {
+                int turnedAway = 0;
+                for (auto const& object : other)
+                    if (! filtered->mayContain (object->getHash ().begin ()))
+                        ++turnedAway;
+                expect (turnedAway > 900, "Filter should skip missing keys");
+            }
+        }
+
+        auto const filterPath = (boost::filesystem::path (path) /
+            "keys.filter").string ();
+        expect (boost::filesystem::exists (filterPath),
+            "Filter should be saved on close");
+
+        {
+            // Re-open from the saved filter, which is consumed
+            auto backend = Manager::instance().make_Backend (
+                params, scheduler, j);
+            expect (! boost::filesystem::exists (filterPath),
+                "Saved filter should be removed once read");
+            Batch copy;
+            fetchCopyOfBatch (*backend, &copy, stored);
+            expect (areBatchesEqual (stored, copy), "Should be equal");
+        }
+
+        boost::filesystem::remove (filterPath);
+
+        {
+            // Re-open without a saved filter, which rebuilds it
+            auto backend = Manager::instance().make_Backend (
+                params, scheduler, j);
+            Batch copy;
+            fetchCopyOfBatch (*backend, &copy, stored);
+            expect (areBatchesEqual (stored, copy), "Should be equal");
+            fetchMissing (*backend, other);
+        }
+
+        {
+            // A backend with the filter disabled is not wrapped
+            params.set ("key_filter_bits", "0");
+            auto backend = Manager::instance().make_Backend (
+                params, scheduler, j);
+            expect (dynamic_cast <FilteredBackend*> (backend.get ()) == nullptr,
+                "Backend should not be filtered");
+        }
+
+        {
+            // The filter is off unless asked for
+            Section plain;
+            plain.set ("type", type);
+            plain.set ("path", path);
+            auto backend = Manager::instance().make_Backend (
+                plain, scheduler, j);
+            expect (dynamic_cast <FilteredBackend*> (backend.get ()) == nullptr,
+                "Backend should not be filtered by default");
+        }
+    }
+
+    void testGrow (std::string const& type)
+    {
+        testcase ("grow type=" + type);
+
+        DummyScheduler scheduler;
+        beast::Journal j;
+        beast::UnitTestUtilities::TempDirectory dir ("node_db");
+        auto const path = dir.getFullPathName ().toStdString ();
+
+        Section params;
+        params.set ("type", type);
+        params.set ("path", path);
+        params.set ("key_filter_bits", "10");
+        params.set ("key_filter_keys", "100");
+
+        Batch stored;
+        createPredictableBatch (stored, 2000, 6);
+        Batch other;
+        createPredictableBatch (other, 1000, 7);
+
+        auto const turnedAway = [&other](FilteredBackend const& filtered)
+        {
+            int n = 0;
+            for (auto const& object : other)
+                if (! filtered.mayContain (object->getHash ().begin ()))
+                    ++n;
+            return n;
+        };
+
+        auto const filterPath = (boost::filesystem::path (path) /
+            "keys.filter").string ();
+
+        {
+            // Storing more keys than the filter was sized for adds layers
+            auto backend = Manager::instance().make_Backend (
+                params, scheduler, j);
+            storeBatch (*backend, stored);
+
+            auto filtered = dynamic_cast <FilteredBackend*> (backend.get ());
+            if (expect (filtered != nullptr, "Backend should be filtered"))
+            {
+                expect (filtered->layers () > 1, "Filter should grow");
+                expect (turnedAway (*filtered) > 900,
+                    "Grown filter should skip missing keys");
+            }
+
+            Batch copy;
+            fetchCopyOfBatch (*backend, &copy, stored);
+            expect (areBatchesEqual (stored, copy), "Should be equal");
+        }
+
+        expect (! boost::filesystem::exists (filterPath),
+            "A grown filter should not be saved");
+
+        {
+            // Rebuilt in one layer, sized from the backend's key count
+            auto backend = Manager::instance().make_Backend (
+                params, scheduler, j);
+            expect (backend->estimateKeys () >= stored.size () / 2,
+                "Backend should estimate its keys");
+
+            auto filtered = dynamic_cast <FilteredBackend*> (backend.get ());
+            if (expect (filtered != nullptr, "Backend should be filtered"))
+            {
+                expect (filtered->layers () == 1, "Filter should be rebuilt");
+                expect (turnedAway (*filtered) > 900,
+                    "Rebuilt filter should skip missing keys");
+            }
+
+            Batch copy;
+            fetchCopyOfBatch (*backend, &copy, stored);
+            expect (areBatchesEqual (stored, copy), "Should be equal");
+        }
+    }
+
+    void run ()
+    {
+        testFilter ();
+        testSaveLoad ();
+        testBackend ("nudb");
+        testGrow ("nudb");
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(KeyFilter,divvy_core,divvy);
+
+}
+}
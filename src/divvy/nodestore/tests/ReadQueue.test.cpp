@@ -0,0 +1,164 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of divvyd: https://github.com/xdv/divvyd
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <divvy/nodestore/impl/ReadQueue.h>
+#include <beast/unit_test/suite.h>
+#include <thread>
+
+namespace divvy {
+namespace NodeStore {
+
+class ReadQueue_test : public beast::unit_test::suite
+{
+public:
+    static
+    uint256
+    key (int i)
+    {
+        uint256 h;
+        h.begin ()[0] = static_cast <unsigned char> (i);
+        return h;
+    }
+
+    void testPriority ()
+    {
+        testcase ("priority");
+
+        ReadQueue q;
+        expect (q.push (key (1), readBackground));
+        expect (q.push (key (2), readBackground));
+        expect (q.push (key (3), readAcquire));
+        expect (q.push (key (4), readCritical));
+
+        std::vector <uint256> hashes;
+        ReadPriority priority;
+
+        expect (q.pop (hashes, priority, 16, true));
+        expect (priority == readCritical && hashes.size () == 1 &&
+            hashes[0] == key (4), "critical first");
+        q.finish (hashes, priority);
+
+        expect (q.pop (hashes, priority, 16, true));
+        expect (priority == readAcquire && hashes.size () == 1 &&
+            hashes[0] == key (3), "acquire second");
+        q.finish (hashes, priority);
+
+        expect (q.pop (hashes, priority, 16, true));
+        expect (priority == readBackground && hashes.size () == 2 &&
+            hashes[0] == key (1) && hashes[1] == key (2), "background last");
+        q.finish (hashes, priority);
+
+        expect (q.size () == 0);
+    }
+
+    void testCoalesce ()
+    {
+        testcase ("coalesce");
+
+        ReadQueue q;
+        std::vector <uint256> hashes;
+        ReadPriority priority;
+
+        expect (q.push (key (1), readBackground));
+        expect (! q.push (key (1), readBackground), "duplicate");
+        expect (! q.push (key (1), readBackground), "duplicate");
+
+        // A more urgent request moves the key up
+        expect (q.push (key (1), readCritical), "promote");
+        expect (q.size () == 1);
+
+        expect (q.pop (hashes, priority, 16, true));
+        expect (priority == readCritical && hashes.size () == 1);
+
+        // A key being read is not queued again
+        expect (! q.push (key (1), readCritical), "reading");
+        q.finish (hashes, priority);
+        expect (q.size () == 0);
+
+        // The stale background entry is skipped
+        expect (q.push (key (2), readBackground));
+        expect (q.pop (hashes, priority, 16, true));
+        expect (priority == readBackground && hashes.size () == 1 &&
+            hashes[0] == key (2), "stale entry");
+        q.finish (hashes, priority);
+    }
+
+    void testReserved ()
+    {
+        testcase ("reserved");
+
+        ReadQueue q;
+        std::vector <uint256> hashes;
+        ReadPriority priority;
+
+        q.push (key (1), readBackground);
+        q.push (key (2), readAcquire);
+
+        // A reader which skips background reads
+        expect (q.pop (hashes, priority, 16, false));
+        expect (priority == readAcquire && hashes.size () == 1 &&
+            hashes[0] == key (2));
+        q.finish (hashes, priority);
+
+        q.close ();
+        expect (! q.pop (hashes, priority, 16, false), "closed");
+    }
+
+    void testWait ()
+    {
+        testcase ("wait");
+
+        ReadQueue q;
+
+        // Nothing more urgent than the background read is pending
+        q.push (key (1), readBackground);
+        q.wait (readAcquire);
+
+        std::thread reader ([&q]
+        {
+            std::vector <uint256> hashes;
+            ReadPriority priority;
+            while (q.pop (hashes, priority, 2, true))
+                q.finish (hashes, priority);
+        });
+
+        for (int i = 2; i < 100; ++i)
+            q.push (key (i), readAcquire);
+        q.wait (readAcquire);
+        q.wait (readBackground);
+        expect (q.size () == 0, "reads finished");
+
+        q.close ();
+        reader.join ();
+    }
+
+    void run ()
+    {
+        testPriority ();
+        testCoalesce ();
+        testReserved ();
+        testWait ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(ReadQueue,divvy_core,divvy);
+
+}
+}
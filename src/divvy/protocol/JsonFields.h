@@ -45,6 +45,7 @@ JSS ( OfferSequence );              // field.
 JSS ( Paths );                      // in/out: TransactionSign
 JSS ( TransferRate );               // in: TransferRate
 JSS ( historical_perminute );       // historical_perminute
+JSS ( SLE_cache_bytes );            // out: GetCounts
 JSS ( SLE_hit_rate );               // out: GetCounts
 JSS ( SendMax );                    // in: TransactionSign
 JSS ( Sequence );                   // in/out: TransactionSign; field.
@@ -152,6 +153,20 @@ JSS ( fee_base );                   // out: NetworkOPs
 JSS ( fee_mult_max );               // in: TransactionSign
 JSS ( fee_ref );                    // out: NetworkOPs
 JSS ( fetch_pack );                 // out: NetworkOPs
+JSS ( fetch_pack_avg_bytes );       // out: GetCounts
+JSS ( fetch_pack_avg_objects );     // out: GetCounts
+JSS ( fetch_pack_build_ms );        // out: GetCounts
+JSS ( fetch_pack_build_ms_max );    // out: GetCounts
+JSS ( fetch_pack_cache_bytes );     // out: GetCounts
+JSS ( fetch_pack_cache_size );      // out: GetCounts
+JSS ( fetch_pack_evicted );         // out: GetCounts
+JSS ( fetch_pack_hits );            // out: GetCounts
+JSS ( fetch_pack_max_bytes );       // out: GetCounts
+JSS ( fetch_pack_misses );          // out: GetCounts
+JSS ( fetch_pack_prebuilt );        // out: GetCounts
+JSS ( fetch_pack_send_ms );         // out: GetCounts
+JSS ( fetch_pack_send_ms_max );     // out: GetCounts
+JSS ( fetch_pack_sent );            // out: GetCounts
 JSS ( first );                      // out: rpc/Version
 JSS ( fix_txns );                   // in: LedgerCleaner
 JSS ( flags );                      // out: paths/Node, AccountOffers
@@ -159,6 +174,7 @@ JSS ( forward );                    // in: AccountTx
 JSS ( freeze );                     // out: AccountLines
 JSS ( freeze_peer );                // out: AccountLines
 JSS ( full );                       // in: LedgerClearer, handlers/Ledger
+JSS ( fullbelow_bytes );            // out: GetCounts
 JSS ( fullbelow_size );             // in: GetCounts
 JSS ( generator );                  // in: LedgerEntry
 JSS ( good );                       // out: RPCVersion
@@ -247,6 +263,7 @@ JSS ( no_divvy_peer );             // out: AccountLines
 JSS ( node );                       // in: UnlAdd, UnlDelete
                                     // out: LedgerEntrySet, LedgerEntry
 JSS ( node_binary );                // out: LedgerEntry
+JSS ( node_cache_bytes );           // out: GetCounts
 JSS ( node_hit_rate );              // out: GetCounts
 JSS ( node_read_bytes );            // out: GetCounts
 JSS ( node_reads_hit );             // out: GetCounts
@@ -349,6 +366,7 @@ JSS ( transaction );                // in: Tx
 JSS ( transaction_hash );           // out: LedgerProposal, LedgerToJson
 JSS ( transactions );               // out: LedgerToJson,
                                     // in: AccountTx*, Unsubscribe
+JSS ( treenode_cache_bytes );       // out: GetCounts
 JSS ( treenode_cache_size );        // out: GetCounts
 JSS ( treenode_track_size );        // out: GetCounts
 JSS ( tx );                         // out: STTx, AccountTx*
@@ -195,6 +195,7 @@ public:
     std::size_t
     emplace_back(Args&&... args)
     {
+        onChange ();
         v_.emplace_back(std::forward<Args>(args)...);
         return v_.size() - 1;
     }
@@ -229,6 +230,7 @@ public:
     }
     STBase& getIndex(int offset)
     {
+        onChange ();
         return v_[offset].get();
     }
     const STBase* peekAtPIndex (int offset) const
@@ -237,6 +239,7 @@ public:
     }
     STBase* getPIndex (int offset)
     {
+        onChange ();
         return &v_[offset].get();
     }
 
@@ -328,6 +331,14 @@ public:
         return ! (*this == o);
     }
 
+protected:
+    /** Called before the contents can change.
+        Every mutating member and every accessor that hands out a
+        modifiable field calls this, so a derived class which memoizes
+        anything computed from the fields can discard it here.
+    */
+    virtual void onChange () { }
+
 private:
     void add (Serializer & s, bool withSigningFields) const;
 
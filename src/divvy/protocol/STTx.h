@@ -23,6 +23,8 @@
 #include <divvy/protocol/STObject.h>
 #include <divvy/protocol/TxFormats.h>
 #include <boost/logic/tribool.hpp>
+#include <boost/optional.hpp>
+#include <mutex>
 
 namespace divvy {
 
@@ -76,6 +78,8 @@ public:
     }
     std::string getFullText () const override;
 
+    void add (Serializer& s) const override;
+
     // Outer transaction functions / signature functions.
     Blob getSignature () const;
 
@@ -166,9 +170,31 @@ private:
     bool checkSingleSign () const;
     bool checkMultiSign () const;
 
+    void onChange () override;
+
+    // Returns the serialized form, computing it if needed.
+    // The caller must hold cache_.mutex.
+    Blob const& serialized (std::lock_guard<std::mutex> const&) const;
+
     TxType tx_type_;
 
     mutable boost::tribool sig_state_;
+
+    // The serialized form and the hashes derived from it are
+    // computed on first use and dropped by onChange.
+    struct Cache
+    {
+        std::mutex mutable mutex;
+        boost::optional<Blob> data;
+        boost::optional<uint256> txnID;
+        boost::optional<uint256> signingHash;
+
+        Cache () = default;
+        Cache (Cache const& other);
+        Cache& operator= (Cache const&) = delete;
+    };
+
+    mutable Cache cache_;
 };
 
 bool passesLocalChecks (STObject const& st, std::string&);
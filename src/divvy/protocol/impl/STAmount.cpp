@@ -19,8 +19,8 @@
 
 #include <BeastConfig.h>
 #include <divvy/basics/Log.h>
+#include <divvy/basics/mulDiv.h>
 #include <divvy/protocol/JsonFields.h>
-#include <divvy/crypto/CBigNum.h>
 #include <divvy/protocol/SystemParameters.h>
 #include <divvy/protocol/STAmount.h>
 #include <divvy/protocol/UintTypes.h>
@@ -34,7 +34,6 @@
 namespace divvy {
 
 static const std::uint64_t tenTo14 = 100000000000000ull;
-static const std::uint64_t tenTo14m1 = tenTo14 - 1;
 static const std::uint64_t tenTo17 = tenTo14 * 1000;
 
 STAmount const saZero (noIssue(), 0);
@@ -948,20 +947,11 @@ divide (STAmount const& num, STAmount const& den, Issue const& issue)
     }
 
     // Compute (numerator * 10^17) / denominator
-    CBigNum v;
-
-    if ((BN_add_word64 (&v, numVal) != 1) ||
-            (BN_mul_word64 (&v, tenTo17) != 1) ||
-            (BN_div_word64 (&v, denVal) == ((std::uint64_t) - 1)))
-    {
-        throw std::runtime_error ("internal bn error");
-    }
-
     // 10^16 <= quotient <= 10^18
-    assert (BN_num_bytes (&v) <= 64);
+    std::uint64_t const v = mulDiv (numVal, tenTo17, denVal);
 
     // TODO(tom): where do 5 and 17 come from?
-    return STAmount (issue, v.getuint64 () + 5,
+    return STAmount (issue, v + 5,
                      numOffset - denOffset - 17,
                      num.negative() != den.negative());
 }
@@ -1012,21 +1002,11 @@ multiply (STAmount const& v1, STAmount const& v2, Issue const& issue)
     }
 
     // Compute (numerator * denominator) / 10^14 with rounding
-    // 10^16 <= result <= 10^18
-    CBigNum v;
-
-    if ((BN_add_word64 (&v, value1) != 1) ||
-            (BN_mul_word64 (&v, value2) != 1) ||
-            (BN_div_word64 (&v, tenTo14) == ((std::uint64_t) - 1)))
-    {
-        throw std::runtime_error ("internal bn error");
-    }
-
     // 10^16 <= product <= 10^18
-    assert (BN_num_bytes (&v) <= 64);
+    std::uint64_t const v = mulDiv (value1, value2, tenTo14);
 
     // TODO(tom): where do 7 and 14 come from?
-    return STAmount (issue, v.getuint64 () + 7,
+    return STAmount (issue, v + 7,
         offset1 + offset2 + 14, v1.negative() != v2.negative());
 }
 
@@ -1121,22 +1101,9 @@ mulRound (STAmount const& v1, STAmount const& v2,
 
     bool resultNegative = v1.negative() != v2.negative();
     // Compute (numerator * denominator) / 10^14 with rounding
-    // 10^16 <= result <= 10^18
-    CBigNum v;
-
-    if ((BN_add_word64 (&v, value1) != 1) || (BN_mul_word64 (&v, value2) != 1))
-        throw std::runtime_error ("internal bn error");
-
-    if (resultNegative != roundUp) // rounding down is automatic when we divide
-        BN_add_word64 (&v, tenTo14m1);
-
-    if  (BN_div_word64 (&v, tenTo14) == ((std::uint64_t) - 1))
-        throw std::runtime_error ("internal bn error");
-
     // 10^16 <= product <= 10^18
-    assert (BN_num_bytes (&v) <= 64);
-
-    std::uint64_t amount = v.getuint64 ();
+    std::uint64_t amount = mulDiv (
+        value1, value2, tenTo14, resultNegative != roundUp);
     int offset = offset1 + offset2 + 14;
     canonicalizeRound (
         isXDV (issue), amount, offset, resultNegative != roundUp);
@@ -1173,21 +1140,9 @@ divRound (STAmount const& num, STAmount const& den,
 
     bool resultNegative = num.negative() != den.negative();
     // Compute (numerator * 10^17) / denominator
-    CBigNum v;
-
-    if ((BN_add_word64 (&v, numVal) != 1) || (BN_mul_word64 (&v, tenTo17) != 1))
-        throw std::runtime_error ("internal bn error");
-
-    if (resultNegative != roundUp) // Rounding down is automatic when we divide
-        BN_add_word64 (&v, denVal - 1);
-
-    if (BN_div_word64 (&v, denVal) == ((std::uint64_t) - 1))
-        throw std::runtime_error ("internal bn error");
-
     // 10^16 <= quotient <= 10^18
-    assert (BN_num_bytes (&v) <= 64);
-
-    std::uint64_t amount = v.getuint64 ();
+    std::uint64_t amount = mulDiv (
+        numVal, tenTo17, denVal, resultNegative != roundUp);
     int offset = numOffset - denOffset - 17;
     canonicalizeRound (
         isXDV (issue), amount, offset, resultNegative != roundUp);
@@ -91,6 +91,7 @@ STObject::operator= (STObject&& other)
 
 void STObject::set (const SOTemplate& type)
 {
+    onChange ();
     v_.clear();
     v_.reserve(type.size());
     mType = &type;
@@ -106,6 +107,7 @@ void STObject::set (const SOTemplate& type)
 
 bool STObject::setType (const SOTemplate& type)
 {
+    onChange ();
     bool valid = true;
     mType = &type;
     decltype(v_) v;
@@ -197,6 +199,7 @@ bool STObject::set (SerialIter& sit, int depth)
 {
     bool reachedEndOfObject = false;
 
+    onChange ();
     v_.clear();
 
     // Consume data in the pipe until we run out or reach the end
@@ -522,6 +525,7 @@ void STObject::makeFieldAbsent (SField const& field)
 
     if (f.getSType () == STI_NOTPRESENT)
         return;
+    onChange ();
     v_[index] = detail::STVar(
         detail::nonPresentObject, f.getFName());
 }
@@ -539,6 +543,7 @@ bool STObject::delField (SField const& field)
 
 void STObject::delField (int index)
 {
+    onChange ();
     v_.erase (v_.begin () + index);
 }
 
@@ -665,6 +670,7 @@ const STObject& STObject::getFieldObject (SField const& field) const
 void
 STObject::set (std::unique_ptr<STBase> v)
 {
+    onChange ();
     auto const i =
         getFieldIndex(v->getFName());
     if (i != -1)
@@ -163,13 +163,61 @@ static Blob getSigningData (STTx const& that)
 uint256
 STTx::getSigningHash () const
 {
-    return STObject::getSigningHash (HashPrefix::txSign);
+    std::lock_guard<std::mutex> lock (cache_.mutex);
+    if (!cache_.signingHash)
+        cache_.signingHash = STObject::getSigningHash (HashPrefix::txSign);
+    return *cache_.signingHash;
 }
 
 uint256
 STTx::getTransactionID () const
 {
-    return getHash (HashPrefix::transactionID);
+    std::lock_guard<std::mutex> lock (cache_.mutex);
+    if (!cache_.txnID)
+    {
+        Blob const& data = serialized (lock);
+        Serializer s (data.size () + 4);
+        s.add32 (HashPrefix::transactionID);
+        s.addRaw (data);
+        cache_.txnID = s.getSHA512Half ();
+    }
+    return *cache_.txnID;
+}
+
+void
+STTx::add (Serializer& s) const
+{
+    std::lock_guard<std::mutex> lock (cache_.mutex);
+    s.addRaw (serialized (lock));
+}
+
+Blob const&
+STTx::serialized (std::lock_guard<std::mutex> const&) const
+{
+    if (!cache_.data)
+    {
+        Serializer s;
+        STObject::add (s);
+        cache_.data = std::move (s.modData ());
+    }
+    return *cache_.data;
+}
+
+void
+STTx::onChange ()
+{
+    std::lock_guard<std::mutex> lock (cache_.mutex);
+    cache_.data = boost::none;
+    cache_.txnID = boost::none;
+    cache_.signingHash = boost::none;
+}
+
+STTx::Cache::Cache (Cache const& other)
+{
+    std::lock_guard<std::mutex> lock (other.mutex);
+    data = other.data;
+    txnID = other.txnID;
+    signingHash = other.signingHash;
 }
 
 Blob STTx::getSignature () const
@@ -243,7 +291,8 @@ Json::Value STTx::getJson (int options, bool binary) const
     if (binary)
     {
         Json::Value ret;
-        Serializer s = STObject::getSerializer ();
+        Serializer s;
+        add (s);
         ret[jss::tx] = strHex (s.peekData ());
         ret[jss::hash] = to_string (getTransactionID ());
         return ret;
@@ -273,7 +322,7 @@ std::string
 STTx::getMetaSQL (Serializer rawTxn,
     std::uint32_t inLedger, char status, std::string const& escapedMetaData) const
 {
-    static boost::format bfTrans ("('%s', '%s', '%s', '%d', '%d', '%c', %s, %s)");
+    static boost::format bfTrans ("('%s', '%s', '%s', '%u', '%u', '%c', %s, %s)");
     std::string rTxn = sqlEscape (rawTxn.peekData ());
 
     auto format = TxFormats::getInstance().findByType (tx_type_);
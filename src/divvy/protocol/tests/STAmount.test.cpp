@@ -19,8 +19,10 @@
 
 #include <BeastConfig.h>
 #include <divvy/basics/Log.h>
+#include <divvy/basics/mulDiv.h>
 #include <divvy/crypto/CBigNum.h>
 #include <divvy/protocol/STAmount.h>
+#include <beast/random/xor_shift_engine.h>
 #include <beast/unit_test/suite.h>
 
 namespace divvy {
@@ -463,6 +465,89 @@ public:
 
     //--------------------------------------------------------------------------
 
+    // The reference computation that mulDiv replaced
+    static std::uint64_t bnMulDiv (std::uint64_t value, std::uint64_t mul,
+        std::uint64_t div, bool roundUp)
+    {
+        CBigNum v;
+        if ((BN_add_word64 (&v, value) != 1) || (BN_mul_word64 (&v, mul) != 1))
+            throw std::runtime_error ("internal bn error");
+        if (roundUp)
+            BN_add_word64 (&v, div - 1);
+        if (BN_div_word64 (&v, div) == ((std::uint64_t) - 1))
+            throw std::runtime_error ("internal bn error");
+        return v.getuint64 ();
+    }
+
+    void testMulDiv ()
+    {
+        testcase ("mulDiv");
+
+        std::uint64_t const tenTo14 = 100000000000000ull;
+        std::uint64_t const tenTo17 = tenTo14 * 1000;
+
+        beast::xor_shift_engine gen;
+        auto mantissa = [&gen]()
+        {
+            return STAmount::cMinValue +
+                gen () % (STAmount::cMaxValue - STAmount::cMinValue + 1);
+        };
+
+        // The native and portable forms must both agree with BIGNUM
+        int failures = 0;
+        auto check = [&failures, this](std::uint64_t value,
+            std::uint64_t mul, std::uint64_t div, bool roundUp)
+        {
+            auto const expected = bnMulDiv (value, mul, div, roundUp);
+            if (mulDiv (value, mul, div, roundUp) != expected)
+                ++failures;
+            if (detail::mulDivPortable (value, mul, div, roundUp) != expected)
+                ++failures;
+        };
+
+        for (int i = 0; i < 100000; ++i)
+        {
+            bool const roundUp = (i & 1) != 0;
+
+            // The multiply and mulRound shape
+            std::uint64_t const a = mantissa ();
+            std::uint64_t const b = mantissa ();
+            check (a, b, tenTo14, roundUp);
+
+            // The divide and divRound shape
+            std::uint64_t const d = mantissa ();
+            check (a, tenTo17, d, roundUp);
+
+            // Arbitrary operands whose quotient fits
+            std::uint64_t const x = gen ();
+            std::uint64_t const y = gen () >> (gen () % 64);
+            std::uint64_t const z = std::max <std::uint64_t> (y, 1);
+            check (x, y, z, roundUp);
+        }
+        expect (failures == 0, "mulDiv differs from BIGNUM");
+
+        using MulDiv = std::uint64_t (*)(
+            std::uint64_t, std::uint64_t, std::uint64_t, bool);
+        for (MulDiv f : {MulDiv (&mulDiv), MulDiv (&detail::mulDivPortable)})
+        {
+            expect (f (0, 0, 1, false) == 0, "mulDiv zero");
+            expect (f (~0ull, ~0ull, ~0ull, false) == ~0ull, "mulDiv max");
+            expect (f (~0ull, 1, 2, true) == (1ull << 63), "mulDiv round");
+
+            try
+            {
+                f (~0ull, 2, 1, false);
+                fail ("mulDiv overflow not detected");
+            }
+            catch (std::overflow_error const&)
+            {
+                pass ();
+            }
+        }
+    }
+
+    //--------------------------------------------------------------------------
+
     void testUnderflow ()
     {
         testcase ("underflow");
@@ -575,6 +660,7 @@ public:
         testNativeCurrency ();
         testCustomCurrency ();
         testArithmetic ();
+        testMulDiv ();
         testUnderflow ();
         testRounding ();
     }
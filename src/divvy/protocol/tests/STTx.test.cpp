@@ -18,6 +18,7 @@
 //==============================================================================
 
 #include <BeastConfig.h>
+#include <divvy/protocol/HashPrefix.h>
 #include <divvy/protocol/STTx.h>
 #include <divvy/protocol/STParsedJSON.h>
 #include <divvy/json/to_string.h>
@@ -74,6 +75,51 @@ public:
         {
             pass ();
         }
+
+        testCache (j);
+    }
+
+    // The memoized ID, signing hash and serialization must
+    // match a fresh computation, including after a mutation.
+    void testCache (STTx const& txn)
+    {
+        STTx t (txn);
+        expect (t.getTransactionID () == txn.getTransactionID (),
+            "copy has a different ID");
+        expect (t.getTransactionID () ==
+            STObject (t).getHash (HashPrefix::transactionID),
+            "bad cached ID");
+        expect (t.getSigningHash () ==
+            STObject (t).getSigningHash (HashPrefix::txSign),
+            "bad cached signing hash");
+
+        uint256 const id = t.getTransactionID ();
+        uint256 const signingHash = t.getSigningHash ();
+        Serializer before;
+        t.add (before);
+
+        t.setSequence (t.getSequence () + 1);
+        expect (t.getTransactionID () != id, "stale ID");
+        expect (t.getSigningHash () != signingHash, "stale signing hash");
+        expect (t.getTransactionID () ==
+            STObject (t).getHash (HashPrefix::transactionID),
+            "bad ID after mutation");
+
+        Serializer after;
+        t.add (after);
+        expect (after.peekData () != before.peekData (),
+            "stale serialization");
+        expect (after.peekData () == STObject (t).getSerializer ().peekData (),
+            "bad serialization after mutation");
+
+        // Changes through a modifiable field reference also count
+        uint256 const id2 = t.getTransactionID ();
+        auto& seq = dynamic_cast<STUInt32&> (t.getField (sfSequence));
+        seq.setValue (seq.getValue () + 1);
+        expect (t.getTransactionID () != id2, "stale ID after getField");
+        expect (t.getTransactionID () ==
+            STObject (t).getHash (HashPrefix::transactionID),
+            "bad ID after getField");
     }
 };
 
@@ -20,6 +20,7 @@
 #include <BeastConfig.h>
 #include <divvy/core/DatabaseCon.h>
 #include <divvy/app/ledger/AcceptedLedger.h>
+#include <divvy/app/ledger/FetchPackCache.h>
 #include <divvy/app/ledger/InboundLedgers.h>
 #include <divvy/basics/UptimeTimer.h>
 #include <divvy/nodestore/Database.h>
@@ -77,9 +78,21 @@ Json::Value doGetCounts (RPC::Context& context)
     ret[jss::ledger_hit_rate] = app.getLedgerMaster ().getCacheHitRate ();
     ret[jss::AL_hit_rate] = AcceptedLedger::getCacheHitRate ();
 
+    // Byte counts can pass 4 GiB, which a Json::UInt cannot hold
+    ret[jss::SLE_cache_bytes] = static_cast<double> (
+        app.getSLECache ().getCacheBytes ());
+    ret[jss::node_cache_bytes] = static_cast<double> (
+        app.getNodeStore ().getCacheBytes ());
+
     ret[jss::fullbelow_size] = static_cast<int>(app.family().fullbelow().size());
+    ret[jss::fullbelow_bytes] = static_cast<double> (
+        app.family().fullbelow().bytes());
     ret[jss::treenode_cache_size] = app.family().treecache().getCacheSize();
     ret[jss::treenode_track_size] = app.family().treecache().getTrackSize();
+    ret[jss::treenode_cache_bytes] = static_cast<double> (
+        app.family().treecache().getCacheBytes());
+
+    app.getOPs ().getFetchPackCache ().getCounts (ret);
 
     std::string uptime;
     int s = UptimeTimer::getInstance ().getElapsedSeconds ();
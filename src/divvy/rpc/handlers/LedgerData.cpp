@@ -19,6 +19,7 @@
 
 #include <BeastConfig.h>
 #include <divvy/server/Role.h>
+#include <divvy/nodestore/ScopedUncachedReads.h>
 
 namespace divvy {
 
@@ -77,11 +78,12 @@ Json::Value doLedgerData (RPC::Context& context)
     Json::Value& nodes = (jvResult[jss::state] = Json::arrayValue);
     SHAMap& map = *(lpLedger->peekAccountStateMap ());
 
-    for (;;)
+    // A dump pages through the whole state, don't let it fill the caches
+    NodeStore::ScopedUncachedReads uncached;
+
+    for (auto it = map.upper_bound (resumePoint); it != map.end (); ++it)
     {
-       std::shared_ptr<SHAMapItem> item = map.peekNextItem (resumePoint);
-       if (!item)
-           break;
+       auto const& item = *it;
        resumePoint = item->getTag();
 
        if (limit-- <= 0)
@@ -100,7 +102,8 @@ Json::Value doLedgerData (RPC::Context& context)
        }
        else
        {
-           SLE sle (item->peekSerializer(), item->getTag ());
+           SerialIter sit (item->slice ());
+           SLE sle (sit, item->getTag ());
            Json::Value& entry = nodes.append (sle.getJson (0));
            entry[jss::index] = to_string (item->getTag ());
        }
@@ -49,7 +49,7 @@ Json::Value doTxHistory (RPC::Context& context)
                     % startIndex);
 
     {
-        auto db = getApp().getTxnDB ().checkoutDb ();
+        auto db = getApp().getTxnDB ().checkoutReadDb ();
 
         boost::optional<std::uint64_t> ledgerSeq;
         boost::optional<std::string> status;
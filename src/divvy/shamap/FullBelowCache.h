@@ -83,6 +83,24 @@ public:
         return m_cache.size ();
     }
 
+    /** Return the approximate number of bytes used by the cache.
+        Thread safety:
+            Safe to call from any thread.
+    */
+    std::size_t bytes () const
+    {
+        return m_cache.bytes ();
+    }
+
+    /** Set the memory budget of the cache, in bytes (0 = ignore).
+        Thread safety:
+            Safe to call from any thread.
+    */
+    void setTargetBytes (std::size_t bytes)
+    {
+        m_cache.setTargetBytes (bytes);
+    }
+
     /** Remove expired cache items.
         Thread safety:
             Safe to call from any thread.
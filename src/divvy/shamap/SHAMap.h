@@ -38,7 +38,10 @@
 #include <boost/thread/shared_lock_guard.hpp>
 #include <boost/thread/shared_mutex.hpp>
 #include <cassert>
+#include <set>
 #include <stack>
+#include <tuple>
+#include <vector>
 
 namespace divvy {
 
@@ -124,6 +127,12 @@ public:
     iterator begin() const;
     iterator end() const;
 
+    /** Return an iterator to the first item whose key is greater than `id`.
+        The key need not be in the map. This allows a traversal to be
+        resumed from a marker without visiting the preceding items.
+    */
+    iterator upper_bound (uint256 const& id) const;
+
     //--------------------------------------------------------------------------
 
     // Returns a new map that's a snapshot of this one.
@@ -171,9 +180,45 @@ public:
     void visitNodes (std::function<bool (SHAMapAbstractNode&)> const&) const;
     void visitLeaves(std::function<void (std::shared_ptr<SHAMapItem> const&)> const&) const;
 
+    /** Visit every node below one branch of the root.
+        The root itself is not visited. Walks of different branches
+        share no state, so a large map can be visited by several
+        threads at once.
+    */
+    void visitBranch (int branch,
+        std::function<bool (SHAMapAbstractNode&)> const&) const;
+
+    /** Return the hashes of the root and the nodes in the levels below it.
+        @param depth The number of levels below the root to include.
+    */
+    std::vector<uint256> getTopHashes (int depth) const;
+
     // comparison/sync functions
     void getMissingNodes (std::vector<SHAMapNodeID>& nodeIDs, std::vector<uint256>& hashes, int max,
                           SHAMapSyncFilter * filter);
+
+    /** Receives the nodes found by a parallel missing node search.
+        Return `false` to end the search.
+    */
+    using MissingNodesHandler = std::function <bool (
+        std::vector<SHAMapNodeID> const& nodeIDs,
+            std::vector<uint256> const& hashes)>;
+
+    /** Find up to `max` missing nodes using several threads.
+
+        The branches of the root are shared out between the calling thread
+        and up to `threads - 1` helpers from the shared TaskPool, which run
+        at the caller's read priority. Each reads the nodes it needs in
+        batches on its own thread, so it waits only for its own reads.
+        Missing nodes are passed to `handler` on the calling thread as they
+        are found. Delivery happens once enough nodes have collected or a
+        short time has passed.
+
+        @note The filter must be safe to call from several threads.
+        @return The number of missing nodes found.
+    */
+    std::size_t getMissingNodes (int max, SHAMapSyncFilter* filter,
+        int threads, MissingNodesHandler const& handler);
     
     bool getNodeFat (SHAMapNodeID node,
         std::vector<SHAMapNodeID>& nodeIDs,
@@ -201,7 +246,14 @@ public:
     bool compare (std::shared_ptr<SHAMap> const& otherMap,
                   Delta& differences, int maxCount) const;
 
-    int flushDirty (NodeObjectType t, std::uint32_t seq);
+    /** Convert all modified nodes to shared nodes and store them.
+        When parallel is set, the branches of the root are flushed on
+        the shared TaskPool and every node is queued for writing in a
+        single batch.
+        @return The number of nodes flushed.
+    */
+    int flushDirty (NodeObjectType t, std::uint32_t seq,
+        bool parallel = false);
     void walkMap (std::vector<SHAMapMissingNode>& missingNodes, int maxMissing) const;
     bool deepCompare (SHAMap & other) const;
 
@@ -219,6 +271,10 @@ public:
 private:
     using SharedPtrNodeStack =
         std::stack<std::pair<std::shared_ptr<SHAMapAbstractNode>, SHAMapNodeID>>;
+
+    // Inner nodes on the path to a leaf, with the branch taken at each
+    using BranchStack =
+        std::vector<std::pair<std::shared_ptr<SHAMapInnerNode>, int>>;
     using DeltaRef = std::pair<std::shared_ptr<SHAMapItem> const&,
                                std::shared_ptr<SHAMapItem> const&>;
 
@@ -263,9 +319,17 @@ private:
     /** write and canonicalize modified node */
     std::shared_ptr<SHAMapAbstractNode>
         writeNode(NodeObjectType t, std::uint32_t seq,
-                  std::shared_ptr<SHAMapAbstractNode> node) const;
+                  std::shared_ptr<SHAMapAbstractNode> node,
+                  NodeStore::Batch* batch = nullptr) const;
 
     SHAMapTreeNode* firstBelow (SHAMapAbstractNode*) const;
+
+    // Leaf-to-leaf traversal which never restarts from the root
+    std::shared_ptr<SHAMapItem> firstBelow (
+        std::shared_ptr<SHAMapAbstractNode> node, BranchStack& stack) const;
+    std::shared_ptr<SHAMapItem> nextBelow (BranchStack& stack) const;
+    std::shared_ptr<SHAMapItem> upperBound (
+        uint256 const& id, BranchStack& stack) const;
     SHAMapTreeNode* lastBelow (SHAMapAbstractNode*) const;
 
     // Simple descent
@@ -279,6 +343,21 @@ private:
     SHAMapAbstractNode* descendAsync (SHAMapInnerNode* parent, int branch,
         SHAMapNodeID const& childID, SHAMapSyncFilter* filter, bool& pending) const;
 
+    // Descend with filter, never reading from the database. Sets
+    // pending if the child may be in the database.
+    SHAMapAbstractNode* descendNoRead (SHAMapInnerNode* parent, int branch,
+        SHAMapNodeID const& childID, SHAMapSyncFilter* filter, bool& pending) const;
+
+    // Parallel missing node search
+    struct MissingNodesSearch;
+    using DeferredRead = std::tuple <SHAMapInnerNode*, int, SHAMapNodeID>;
+    bool findMissingInBranch (int branch, MissingNodesSearch& search);
+    bool findMissingBelow (SHAMapInnerNode* top, SHAMapNodeID const& topID,
+        MissingNodesSearch& search, std::vector<DeferredRead>& deferred,
+            std::set<uint256>& missing);
+    void readDeferred (std::vector<DeferredRead> const& deferred,
+        MissingNodesSearch& search, std::set<uint256>& missing);
+
     std::pair <SHAMapAbstractNode*, SHAMapNodeID>
         descend (SHAMapInnerNode* parent, SHAMapNodeID const& parentID,
         int branch, SHAMapSyncFilter* filter) const;
@@ -288,6 +367,10 @@ private:
     std::shared_ptr<SHAMapAbstractNode>
         descendNoStore (std::shared_ptr<SHAMapInnerNode> const&, int branch) const;
 
+    // Visit the nodes below an inner node, return true if stopped
+    bool visitChildren (std::shared_ptr<SHAMapInnerNode> node,
+        std::function<bool (SHAMapAbstractNode&)> const&) const;
+
     /** If there is only one leaf below this node, get its contents */
     std::shared_ptr<SHAMapItem> onlyBelow (SHAMapAbstractNode*) const;
 
@@ -298,6 +381,13 @@ private:
                      std::shared_ptr<SHAMapItem> const& otherMapItem, bool isFirstMap,
                      Delta & differences, int & maxCount) const;
     int walkSubTree (bool doWrite, NodeObjectType t, std::uint32_t seq);
+    int walkSubTreeParallel (NodeObjectType t, std::uint32_t seq);
+
+    // Flush the modified nodes at and below an inner node that has
+    // already been prepared with preFlushNode. On return, node is the
+    // shareable replacement. Written nodes go to batch if one is given.
+    int flushInner (std::shared_ptr<SHAMapInnerNode>& node, bool doWrite,
+        NodeObjectType t, std::uint32_t seq, NodeStore::Batch* batch) const;
 };
 
 inline
@@ -362,6 +452,7 @@ private:
     friend class boost::iterator_core_access;
 
     SHAMap const* map_ = nullptr;
+    BranchStack stack_;
     std::shared_ptr<
         SHAMapItem const> item_;
 
@@ -377,12 +468,23 @@ public:
     {
     }
 
+    iterator (SHAMap const& map, BranchStack&& stack,
+        std::shared_ptr<SHAMapItem const> const& item)
+        : map_(&map)
+        , stack_(std::move(stack))
+        , item_(item)
+    {
+    }
+
 private:
     void
     increment()
     {
-        item_ = map_->peekNextItem(
-            item_->key());
+        // Iterators built from a bare item have no path yet
+        if (stack_.empty())
+            item_ = map_->upperBound(item_->key(), stack_);
+        else
+            item_ = map_->nextBelow(stack_);
     }
 
     bool
@@ -404,7 +506,18 @@ inline
 SHAMap::iterator
 SHAMap::begin() const
 {
-    return iterator(*this, peekFirstItem());
+    BranchStack stack;
+    auto item = firstBelow(root_, stack);
+    return iterator(*this, std::move(stack), item);
+}
+
+inline
+SHAMap::iterator
+SHAMap::upper_bound (uint256 const& id) const
+{
+    BranchStack stack;
+    auto item = upperBound(id, stack);
+    return iterator(*this, std::move(stack), item);
 }
 
 inline
@@ -22,6 +22,7 @@
 
 #include <divvy/protocol/Serializer.h>
 #include <divvy/basics/base_uint.h>
+#include <divvy/basics/SlabAllocator.h>
 #include <divvy/basics/Slice.h>
 #include <beast/utility/Journal.h>
 
@@ -30,6 +31,8 @@
 namespace divvy {
 
 // an item stored in a SHAMap
+// Items, like tree nodes, are created and dropped with every ledger and
+// are usually allocated from slab pools with make_pooled.
 class SHAMapItem
 {
 private:
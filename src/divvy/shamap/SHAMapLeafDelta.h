@@ -0,0 +1,161 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of divvyd: https://github.com/xdv/divvyd
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef RIPPLE_SHAMAP_SHAMAPLEAFDELTA_H_INCLUDED
+#define RIPPLE_SHAMAP_SHAMAPLEAFDELTA_H_INCLUDED
+
+#include <divvy/shamap/SHAMap.h>
+#include <divvy/basics/Blob.h>
+#include <divvy/basics/Slice.h>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+namespace divvy {
+
+/** The leaf changes that turn one SHAMap into another.
+
+    A delta is built by comparing two maps, typically the state maps of
+    two consecutive validated ledgers. It lists the items added, changed
+    or removed, together with the root hashes before and after. Applying
+    it to a map with the first root hash produces the second one without
+    fetching any inner nodes, and the resulting root hash is checked.
+
+    Encoded, a delta is:
+
+        uint32      magic
+        uint8       format version
+        uint8       leaf node type
+        uint32      ledger sequence of the target map
+        uint256     root hash before
+        uint256     root hash after
+        uint32      number of changes
+        changes, sorted by key:
+            uint8       0 to remove, 1 to set
+            uint256     key
+            VL          item data, only when set
+
+    In a stream each encoded delta is preceded by its uint32 length so
+    deltas for a run of ledgers can be written to and read from a file
+    one after another.
+*/
+class SHAMapLeafDelta
+{
+public:
+    struct Change
+    {
+        uint256 key;
+
+        // The new item, or null if the item is removed
+        std::shared_ptr<SHAMapItem> item;
+    };
+
+    SHAMapLeafDelta () = default;
+
+    /** Build the delta that turns `from` into `to`.
+        Both maps must be valid and must not change while this runs.
+        @param type The leaf type of items in both maps.
+        @param seq The ledger sequence `to` belongs to.
+    */
+    SHAMapLeafDelta (SHAMap const& from, std::shared_ptr<SHAMap> const& to,
+        SHAMapTreeNode::TNType type, std::uint32_t seq);
+
+    uint256 const&
+    from () const
+    {
+        return from_;
+    }
+
+    uint256 const&
+    to () const
+    {
+        return to_;
+    }
+
+    std::uint32_t
+    seq () const
+    {
+        return seq_;
+    }
+
+    SHAMapTreeNode::TNType
+    type () const
+    {
+        return type_;
+    }
+
+    std::vector<Change> const&
+    changes () const
+    {
+        return changes_;
+    }
+
+    /** Apply the changes to a mutable map.
+        The map must have the root hash this delta starts from. On
+        failure the map is left partly changed, so apply to a snapshot
+        when the original must survive.
+        @param flush If set, the modified nodes are hashed on worker
+                     threads and written to the node store before the
+                     root hash is checked.
+        @return `true` if every change applied and the map now has the
+                root hash this delta ends at.
+    */
+    bool
+    apply (SHAMap& map, bool flush) const;
+
+    Blob
+    serialize () const;
+
+    /** Decode a delta.
+        @return `false` if the data is not a well formed delta.
+    */
+    bool
+    deserialize (Slice const& data);
+
+    /** Append a length prefixed delta to a stream. */
+    void
+    write (std::ostream& out) const;
+
+    /** Read the next length prefixed delta from a stream.
+        @return `false` at the end of the stream or if the next delta
+                is truncated or malformed.
+    */
+    bool
+    read (std::istream& in);
+
+    /** Apply every delta in a stream to a map, in order.
+        Stops at the first delta that fails to read or apply.
+        @return The number of deltas applied.
+    */
+    static
+    std::size_t
+    applyStream (std::istream& in, SHAMap& map, bool flush);
+
+private:
+    uint256 from_;
+    uint256 to_;
+    std::uint32_t seq_ = 0;
+    SHAMapTreeNode::TNType type_ = SHAMapTreeNode::tnACCOUNT_STATE;
+    std::vector<Change> changes_;
+};
+
+} // divvy
+
+#endif
@@ -22,12 +22,14 @@
 
 #include <divvy/shamap/SHAMapItem.h>
 #include <divvy/shamap/SHAMapNodeID.h>
+#include <divvy/basics/SlabAllocator.h>
 #include <divvy/basics/TaggedCache.h>
+#include <beast/threads/SpinLock.h>
 #include <beast/utility/Journal.h>
 
+#include <bitset>
 #include <cstdint>
 #include <memory>
-#include <mutex>
 #include <string>
 
 namespace divvy {
@@ -92,14 +94,41 @@ public:
 class SHAMapInnerNode
     : public SHAMapAbstractNode
 {
-    uint256                         mHashes[16];
-    std::shared_ptr<SHAMapAbstractNode> mChildren[16];
+    // Most inner nodes away from the root have only a few branches.
+    // Those keep just the populated branches, packed in branch order
+    // and located by counting the bits of mIsBranch below the branch.
+    // A node that outgrows sparseLimit switches to all sixteen slots,
+    // indexed by branch.
+    enum
+    {
+        sparseLimit = 6,
+        fullCapacity = 16
+    };
+
+    // The hash of each slot followed by the child of each slot, in
+    // one block taken from the slab pool for the node's capacity.
+    void*                           mSlots = nullptr;
     int                             mIsBranch = 0;
+    std::uint8_t                    mCapacity = 0;
     std::uint32_t                   mFullBelowGen = 0;
 
-    static std::mutex               childLock;
+    // Guards the children, so that readers of different
+    // nodes never contend with each other.
+    mutable beast::SpinLock         mChildLock;
+
+    static uint256 const            zeroHash;
+
+    static int capacityFor (int branches);
+    static SlabPool& slotPool (int capacity);
+    uint256* hashes () const;
+    std::shared_ptr<SHAMapAbstractNode>* children () const;
+    int slot (int m) const;
+    void resize (int capacity);
+    void setHashes (uint256 const (&hashes)[16]);
+
 public:
     SHAMapInnerNode(std::uint32_t seq = 0);
+    ~SHAMapInnerNode ();
     std::shared_ptr<SHAMapAbstractNode> clone(std::uint32_t seq) const override;
 
     bool isEmpty () const;
@@ -118,6 +147,12 @@ public:
     bool isFullBelow (std::uint32_t generation) const;
     void setFullBelowGen (std::uint32_t gen);
 
+    // The number of child slots allocated
+    int getCapacity () const;
+
+    // The bytes allocated for the child slots
+    std::size_t getSlotBytes () const;
+
     bool updateHash () override;
     void updateHashDeep();
     void addRaw (Serializer&, SHANodeFormat format) override;
@@ -251,12 +286,46 @@ SHAMapInnerNode::isEmptyBranch (int m) const
     return (mIsBranch & (1 << m)) == 0;
 }
 
+inline
+uint256*
+SHAMapInnerNode::hashes () const
+{
+    return static_cast<uint256*> (mSlots);
+}
+
+inline
+std::shared_ptr<SHAMapAbstractNode>*
+SHAMapInnerNode::children () const
+{
+    return reinterpret_cast<std::shared_ptr<SHAMapAbstractNode>*> (
+        hashes () + mCapacity);
+}
+
+inline
+int
+SHAMapInnerNode::slot (int m) const
+{
+    if (mCapacity == fullCapacity)
+        return m;
+    return static_cast<int> (
+        std::bitset<16> (mIsBranch & ((1 << m) - 1)).count ());
+}
+
 inline
 uint256 const&
 SHAMapInnerNode::getChildHash (int m) const
 {
     assert ((m >= 0) && (m < 16) && (getType() == tnINNER));
-    return mHashes[m];
+    if (isEmptyBranch (m))
+        return zeroHash;
+    return hashes ()[slot (m)];
+}
+
+inline
+int
+SHAMapInnerNode::getCapacity () const
+{
+    return mCapacity;
 }
 
 inline
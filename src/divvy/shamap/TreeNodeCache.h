@@ -20,13 +20,20 @@
 #ifndef RIPPLE_SHAMAP_TREENODECACHE_H_INCLUDED
 #define RIPPLE_SHAMAP_TREENODECACHE_H_INCLUDED
 
-#include <divvy/basics/TaggedCache.h>
+#include <divvy/basics/ShardedTaggedCache.h>
 
 namespace divvy {
 
 class SHAMapAbstractNode;
 
-using TreeNodeCache = TaggedCache <uint256, SHAMapAbstractNode>;
+/** Returns the approximate memory used by a tree node.
+    Children of inner nodes are not counted, they are cached separately.
+    @see cacheFootprint
+*/
+std::size_t
+cacheFootprint (SHAMapAbstractNode const& node);
+
+using TreeNodeCache = ShardedTaggedCache <uint256, SHAMapAbstractNode>;
 
 } // divvy
 
@@ -19,8 +19,11 @@
 
 #include <BeastConfig.h>
 #include <divvy/shamap/SHAMap.h>
+#include <divvy/basics/TaskPool.h>
+#include <divvy/nodestore/ScopedUncachedReads.h>
 #include <beast/unit_test/suite.h>
 #include <beast/chrono/manual_clock.h>
+#include <iterator>
 
 namespace divvy {
 
@@ -38,7 +41,7 @@ SHAMap::SHAMap (
 {
     assert (seq_ != 0);
 
-    root_ = std::make_shared<SHAMapInnerNode> (seq_);
+    root_ = make_pooled<SHAMapInnerNode> (seq_);
 }
 
 SHAMap::SHAMap (
@@ -53,7 +56,7 @@ SHAMap::SHAMap (
     , state_ (SHAMapState::Synching)
     , type_ (t)
 {
-    root_ = std::make_shared<SHAMapInnerNode> (seq_);
+    root_ = make_pooled<SHAMapInnerNode> (seq_);
 }
 
 SHAMap::~SHAMap ()
@@ -398,6 +401,32 @@ SHAMap::descendAsync (SHAMapInnerNode* parent, int branch,
     return ptr.get ();
 }
 
+SHAMapAbstractNode*
+SHAMap::descendNoRead (SHAMapInnerNode* parent, int branch,
+    SHAMapNodeID const& childID, SHAMapSyncFilter * filter, bool & pending) const
+{
+    pending = false;
+
+    SHAMapAbstractNode* ret = parent->getChildPointer (branch);
+    if (ret)
+        return ret;
+
+    uint256 const& hash = parent->getChildHash (branch);
+
+    std::shared_ptr<SHAMapAbstractNode> ptr = getCache (hash);
+    if (!ptr && filter)
+        ptr = checkFilter (hash, childID, filter);
+
+    if (!ptr)
+    {
+        pending = backed_;
+        return nullptr;
+    }
+
+    ptr = parent->canonicalizeChild (branch, std::move(ptr));
+    return ptr.get ();
+}
+
 template <class Node>
 std::shared_ptr<Node>
 SHAMap::unshareNode (std::shared_ptr<Node> node, SHAMapNodeID const& nodeID)
@@ -472,6 +501,90 @@ SHAMap::lastBelow (SHAMapAbstractNode* node) const
     while (true);
 }
 
+static const std::shared_ptr<SHAMapItem> no_item;
+
+std::shared_ptr<SHAMapItem>
+SHAMap::firstBelow (std::shared_ptr<SHAMapAbstractNode> node,
+    BranchStack& stack) const
+{
+    // Return the first item below this node, recording the path taken
+    while (!node->isLeaf ())
+    {
+        auto inner = std::static_pointer_cast<SHAMapInnerNode>(std::move(node));
+        int branch = 0;
+        while (branch < 16 && inner->isEmptyBranch (branch))
+            ++branch;
+
+        // Only an empty root has no branches
+        if (branch == 16)
+            return no_item;
+
+        node = descendThrow (inner, branch);
+        stack.emplace_back (std::move (inner), branch);
+    }
+
+    return std::static_pointer_cast<SHAMapTreeNode>(node)->peekItem ();
+}
+
+std::shared_ptr<SHAMapItem>
+SHAMap::nextBelow (BranchStack& stack) const
+{
+    // Advance from the leaf at the end of the recorded path
+    // to the next leaf, going up only as far as needed
+    while (!stack.empty ())
+    {
+        auto& inner = stack.back ().first;
+        int branch = stack.back ().second + 1;
+        while (branch < 16 && inner->isEmptyBranch (branch))
+            ++branch;
+
+        if (branch < 16)
+        {
+            stack.back ().second = branch;
+            auto node = descendThrow (inner, branch);
+            auto item = firstBelow (std::move (node), stack);
+
+            if (!item)
+                throw (std::runtime_error ("missing/corrupt node"));
+
+            return item;
+        }
+
+        stack.pop_back ();
+    }
+
+    return no_item;
+}
+
+std::shared_ptr<SHAMapItem>
+SHAMap::upperBound (uint256 const& id, BranchStack& stack) const
+{
+    // Walk towards id, then step to the first leaf past it
+    stack.clear ();
+    std::shared_ptr<SHAMapAbstractNode> node = root_;
+    SHAMapNodeID nodeID;
+
+    while (!node->isLeaf ())
+    {
+        int const branch = nodeID.selectBranch (id);
+        assert (branch >= 0);
+        auto inner = std::static_pointer_cast<SHAMapInnerNode>(std::move(node));
+        stack.emplace_back (inner, branch);
+
+        if (inner->isEmptyBranch (branch))
+            return nextBelow (stack);
+
+        node = descendThrow (inner, branch);
+        nodeID = nodeID.getChildNodeID (branch);
+    }
+
+    auto const& item = std::static_pointer_cast<SHAMapTreeNode>(node)->peekItem ();
+    if (item && item->getTag () > id)
+        return item;
+
+    return nextBelow (stack);
+}
+
 std::shared_ptr<SHAMapItem>
 SHAMap::onlyBelow (SHAMapAbstractNode* node) const
 {
@@ -522,8 +635,6 @@ SHAMap::fetch (uint256 const& key) const
     return leaf->peekItem();
 }
 
-static const std::shared_ptr<SHAMapItem> no_item;
-
 std::shared_ptr<SHAMapItem> SHAMap::peekFirstItem () const
 {
     SHAMapTreeNode* node = firstBelow (root_.get ());
@@ -744,7 +855,7 @@ bool SHAMap::delItem (uint256 const& id)
                             break;
                         }
                     }
-                    prevNode = std::make_shared<SHAMapTreeNode>(item, type, node->getSeq());
+                    prevNode = make_pooled<SHAMapTreeNode> (item, type, node->getSeq());
                     prevHash = prevNode->getNodeHash();
                 }
                 else
@@ -798,7 +909,7 @@ SHAMap::addGiveItem (std::shared_ptr<SHAMapItem> const& item,
         auto inner = std::static_pointer_cast<SHAMapInnerNode>(node);
         int branch = nodeID.selectBranch (tag);
         assert (inner->isEmptyBranch (branch));
-        auto newNode = std::make_shared<SHAMapTreeNode> (item, type, seq_);
+        auto newNode = make_pooled<SHAMapTreeNode> (item, type, seq_);
         inner->setChild (branch, newNode);
     }
     else
@@ -808,7 +919,7 @@ SHAMap::addGiveItem (std::shared_ptr<SHAMapItem> const& item,
         std::shared_ptr<SHAMapItem> otherItem = leaf->peekItem ();
         assert (otherItem && (tag != otherItem->getTag ()));
 
-        node = std::make_shared<SHAMapInnerNode>(node->getSeq());
+        node = make_pooled<SHAMapInnerNode> (node->getSeq());
 
         int b1, b2;
 
@@ -819,19 +930,19 @@ SHAMap::addGiveItem (std::shared_ptr<SHAMapItem> const& item,
 
             // we need a new inner node, since both go on same branch at this level
             nodeID = nodeID.getChildNodeID (b1);
-            node = std::make_shared<SHAMapInnerNode> (seq_);
+            node = make_pooled<SHAMapInnerNode> (seq_);
         }
 
         // we can add the two leaf nodes here
         assert (node->isInner ());
 
         std::shared_ptr<SHAMapTreeNode> newNode =
-            std::make_shared<SHAMapTreeNode> (item, type, seq_);
+            make_pooled<SHAMapTreeNode> (item, type, seq_);
         assert (newNode->isValid () && newNode->isLeaf ());
         auto inner = std::static_pointer_cast<SHAMapInnerNode>(node);
         inner->setChild (b1, newNode);
 
-        newNode = std::make_shared<SHAMapTreeNode> (otherItem, type, seq_);
+        newNode = make_pooled<SHAMapTreeNode> (otherItem, type, seq_);
         assert (newNode->isValid () && newNode->isLeaf ());
         inner->setChild (b2, newNode);
     }
@@ -842,7 +953,7 @@ SHAMap::addGiveItem (std::shared_ptr<SHAMapItem> const& item,
 
 bool SHAMap::addItem (const SHAMapItem& i, bool isTransaction, bool hasMetaData)
 {
-    return addGiveItem (std::make_shared<SHAMapItem> (i), isTransaction, hasMetaData);
+    return addGiveItem (make_pooled<SHAMapItem> (i), isTransaction, hasMetaData);
 }
 
 uint256
@@ -942,7 +1053,8 @@ bool SHAMap::fetchRoot (uint256 const& hash, SHAMapSyncFilter* filter)
 // a mutable snapshot of a mutable SHAMap.
 std::shared_ptr<SHAMapAbstractNode>
 SHAMap::writeNode (
-    NodeObjectType t, std::uint32_t seq, std::shared_ptr<SHAMapAbstractNode> node) const
+    NodeObjectType t, std::uint32_t seq, std::shared_ptr<SHAMapAbstractNode> node,
+    NodeStore::Batch* batch) const
 {
     // Node is ours, so we can just make it shareable
     assert (node->getSeq() == seq_);
@@ -953,8 +1065,12 @@ SHAMap::writeNode (
 
     Serializer s;
     node->addRaw (s, snfPREFIX);
-    f_.db().store (t,
-        std::move (s.modData ()), node->getNodeHash ());
+    if (batch)
+        batch->push_back (NodeObject::createObject (t,
+            std::move (s.modData ()), node->getNodeHash ()));
+    else
+        f_.db().store (t,
+            std::move (s.modData ()), node->getNodeHash ());
     return node;
 }
 
@@ -985,8 +1101,10 @@ int SHAMap::unshare ()
 
 /** Convert all modified nodes to shared nodes */
 // If requested, write them to the node store
-int SHAMap::flushDirty (NodeObjectType t, std::uint32_t seq)
+int SHAMap::flushDirty (NodeObjectType t, std::uint32_t seq, bool parallel)
 {
+    if (parallel && backed_)
+        return walkSubTreeParallel (t, seq);
     return walkSubTree (true, t, seq);
 }
 
@@ -994,7 +1112,6 @@ int
 SHAMap::walkSubTree (bool doWrite, NodeObjectType t, std::uint32_t seq)
 {
     int flushed = 0;
-    Serializer s;
 
     if (!root_ || (root_->getSeq() == 0))
         return flushed;
@@ -1010,13 +1127,112 @@ SHAMap::walkSubTree (bool doWrite, NodeObjectType t, std::uint32_t seq)
     if (node->isEmpty())
         return flushed;
 
+    node = preFlushNode(std::move(node));
+    flushed = flushInner (node, doWrite, t, seq, nullptr);
+
+    // Last inner node is the new root_
+    root_ = std::move (node);
+
+    return flushed;
+}
+
+// Each modified branch of the root is an independent subtree, so the
+// branches are hashed and serialized on the shared TaskPool. The root is
+// finished once they are all done and everything goes out in one batch.
+int
+SHAMap::walkSubTreeParallel (NodeObjectType t, std::uint32_t seq)
+{
+    if (!root_ || (root_->getSeq() == 0) || root_->isLeaf())
+        return walkSubTree (true, t, seq);
+
+    auto root = std::static_pointer_cast<SHAMapInnerNode>(root_);
+    if (root->isEmpty())
+        return 0;
+
+    root = preFlushNode(std::move(root));
+
+    int flushed = 0;
+    NodeStore::Batch batch;
+
+    // Leaves hanging off the root are cheap, flush those here and
+    // collect the inner nodes for the workers
+    std::vector <std::pair <int, std::shared_ptr<SHAMapInnerNode>>> work;
+    for (int branch = 0; branch < 16; ++branch)
+    {
+        if (root->isEmptyBranch (branch))
+            continue;
+
+        auto child = root->getChild (branch);
+        if (!child || (child->getSeq() == 0))
+            continue;
+
+        child = preFlushNode(std::move(child));
+
+        if (child->isInner ())
+        {
+            work.emplace_back (branch,
+                std::static_pointer_cast<SHAMapInnerNode>(std::move(child)));
+        }
+        else
+        {
+            ++flushed;
+            child->updateHash();
+            child = writeNode(t, seq, std::move(child), &batch);
+            root->shareChild (branch, child);
+        }
+    }
+
+    if (!work.empty ())
+    {
+        // Each subtree writes into its own batch
+        std::vector <NodeStore::Batch> batches (work.size());
+        std::vector <int> counts (work.size(), 0);
+
+        TaskPool::shared().forEach (work.size(),
+            static_cast <int> (work.size()) - 1,
+            [&](std::size_t i)
+            {
+                counts[i] = flushInner (work[i].second, true,
+                    t, seq, &batches[i]);
+            });
+
+        for (std::size_t i = 0; i < work.size(); ++i)
+        {
+            flushed += counts[i];
+            batch.insert (batch.end(),
+                std::make_move_iterator (batches[i].begin()),
+                std::make_move_iterator (batches[i].end()));
+        }
+
+        for (auto& e : work)
+        {
+            assert (root->getSeq() == seq_);
+            root->shareChild (e.first, e.second);
+        }
+    }
+
+    root->updateHashDeep();
+    root_ = writeNode(t, seq, std::move(root), &batch);
+    ++flushed;
+
+    // The nodes are in the cache now, so the close need not wait
+    // for the backend to write them
+    f_.db().asyncStoreBatch (batch);
+
+    return flushed;
+}
+
+int
+SHAMap::flushInner (std::shared_ptr<SHAMapInnerNode>& node, bool doWrite,
+    NodeObjectType t, std::uint32_t seq, NodeStore::Batch* batch) const
+{
+    int flushed = 0;
+
     // Stack of {parent,index,child} pointers representing
     // inner nodes we are in the process of flushing
     using StackEntry = std::pair <std::shared_ptr<SHAMapInnerNode>, int>;
     std::stack <StackEntry, std::vector<StackEntry>> stack;
 
-    node = preFlushNode(std::move(node));
-
     int pos = 0;
 
     // We can't flush an inner node until we flush its children
@@ -1060,7 +1276,7 @@ SHAMap::walkSubTree (bool doWrite, NodeObjectType t, std::uint32_t seq)
                         child->updateHash();
 
                         if (doWrite && backed_)
-                            child = writeNode(t, seq, std::move(child));
+                            child = writeNode(t, seq, std::move(child), batch);
 
                         node->shareChild (branch, child);
                     }
@@ -1074,7 +1290,7 @@ SHAMap::walkSubTree (bool doWrite, NodeObjectType t, std::uint32_t seq)
         // This inner node can now be shared
         if (doWrite && backed_)
             node = std::static_pointer_cast<SHAMapInnerNode>(writeNode(t, seq,
-                                                                       std::move(node)));
+                                                                       std::move(node), batch));
 
         ++flushed;
 
@@ -1094,9 +1310,6 @@ SHAMap::walkSubTree (bool doWrite, NodeObjectType t, std::uint32_t seq)
         ++pos;
     }
 
-    // Last inner node is the new root_
-    root_ = std::move (node);
-
     return flushed;
 }
 
@@ -1160,7 +1373,11 @@ SHAMap::canonicalize(uint256 const& hash, std::shared_ptr<SHAMapAbstractNode>& n
     assert (node->getSeq() == 0);
     assert (node->getNodeHash() == hash);
 
-    f_.treecache().canonicalize (hash, node);
+    // Nodes built during an uncached walk stay out of the cache
+    if (NodeStore::ScopedUncachedReads::active ())
+        return;
+
+    f_.treecache().admit (hash, node);
 }
 
 } // divvy
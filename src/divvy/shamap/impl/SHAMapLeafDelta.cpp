@@ -0,0 +1,222 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of divvyd: https://github.com/xdv/divvyd
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <divvy/shamap/SHAMapLeafDelta.h>
+#include <divvy/protocol/Serializer.h>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace divvy {
+
+static std::uint32_t const deltaMagic = 0x4C445441; // 'LDTA'
+static std::uint8_t const deltaVersion = 1;
+
+// Many times the largest delta two consecutive ledgers produce
+static std::uint32_t const maxDeltaBytes = 64 * 1024 * 1024;
+
+// A length prefix is only trusted as far as the bytes which follow it,
+// so a delta is read in pieces of this size.
+static std::size_t const readChunkBytes = 64 * 1024;
+
+SHAMapLeafDelta::SHAMapLeafDelta (SHAMap const& from,
+        std::shared_ptr<SHAMap> const& to,
+        SHAMapTreeNode::TNType type, std::uint32_t seq)
+    : from_ (from.getHash ())
+    , to_ (to->getHash ())
+    , seq_ (seq)
+    , type_ (type)
+{
+    SHAMap::Delta differences;
+    if (!from.compare (to, differences, std::numeric_limits<int>::max ()))
+        throw std::runtime_error ("delta too large");
+
+    // Delta is a std::map, so changes come out sorted by key
+    changes_.reserve (differences.size ());
+    for (auto const& d : differences)
+        changes_.push_back ({d.first, d.second.second});
+}
+
+bool
+SHAMapLeafDelta::apply (SHAMap& map, bool flush) const
+{
+    if (map.getHash () != from_)
+        return false;
+
+    bool const isTransaction = (type_ != SHAMapTreeNode::tnACCOUNT_STATE);
+    bool const hasMeta = (type_ == SHAMapTreeNode::tnTRANSACTION_MD);
+
+    for (auto const& change : changes_)
+    {
+        if (!change.item)
+        {
+            if (!map.delItem (change.key))
+                return false;
+        }
+        else if (map.hasItem (change.key))
+        {
+            if (!map.updateGiveItem (change.item, isTransaction, hasMeta))
+                return false;
+        }
+        else if (!map.addGiveItem (change.item, isTransaction, hasMeta))
+        {
+            return false;
+        }
+    }
+
+    if (flush)
+        map.flushDirty (isTransaction ? hotTRANSACTION_NODE : hotACCOUNT_NODE,
+            seq_, true);
+
+    return map.getHash () == to_;
+}
+
+Blob
+SHAMapLeafDelta::serialize () const
+{
+    Serializer s;
+    s.add32 (deltaMagic);
+    s.add8 (deltaVersion);
+    s.add8 (static_cast<unsigned char> (type_));
+    s.add32 (seq_);
+    s.add256 (from_);
+    s.add256 (to_);
+    s.add32 (static_cast<std::uint32_t> (changes_.size ()));
+
+    for (auto const& change : changes_)
+    {
+        s.add8 (change.item ? 1 : 0);
+        s.add256 (change.key);
+        if (change.item)
+            s.addVL (change.item->peekData ());
+    }
+
+    return s.peekData ();
+}
+
+bool
+SHAMapLeafDelta::deserialize (Slice const& data)
+{
+    try
+    {
+        SerialIter sit (data);
+
+        if (sit.get32 () != deltaMagic || sit.get8 () != deltaVersion)
+            return false;
+
+        auto const type = static_cast<SHAMapTreeNode::TNType> (sit.get8 ());
+        if (type != SHAMapTreeNode::tnACCOUNT_STATE &&
+            type != SHAMapTreeNode::tnTRANSACTION_NM &&
+            type != SHAMapTreeNode::tnTRANSACTION_MD)
+            return false;
+
+        auto const seq = sit.get32 ();
+        auto const from = sit.get256 ();
+        auto const to = sit.get256 ();
+        auto const count = sit.get32 ();
+
+        // Every change takes at least 33 bytes
+        if (count > static_cast<std::uint32_t> (sit.getBytesLeft ()) / 33)
+            return false;
+
+        std::vector<Change> changes;
+        changes.reserve (count);
+        for (std::uint32_t i = 0; i < count; ++i)
+        {
+            auto const op = sit.get8 ();
+            Change change {sit.get256 (), nullptr};
+
+            // Keys must be unique and in order
+            if (!changes.empty () && (changes.back ().key >= change.key))
+                return false;
+
+            if (op == 1)
+                change.item = make_pooled<SHAMapItem> (
+                    change.key, sit.getVL ());
+            else if (op != 0)
+                return false;
+
+            changes.push_back (std::move (change));
+        }
+
+        if (!sit.empty ())
+            return false;
+
+        type_ = type;
+        seq_ = seq;
+        from_ = from;
+        to_ = to;
+        changes_ = std::move (changes);
+        return true;
+    }
+    catch (std::exception const&)
+    {
+        return false;
+    }
+}
+
+void
+SHAMapLeafDelta::write (std::ostream& out) const
+{
+    auto const data = serialize ();
+
+    Serializer s (4);
+    s.add32 (static_cast<std::uint32_t> (data.size ()));
+    out.write (static_cast<char const*> (s.getDataPtr ()),
+        s.getLength ());
+    out.write (reinterpret_cast<char const*> (data.data ()), data.size ());
+}
+
+bool
+SHAMapLeafDelta::read (std::istream& in)
+{
+    unsigned char prefix[4];
+    if (!in.read (reinterpret_cast<char*> (prefix), sizeof (prefix)))
+        return false;
+
+    auto const size = SerialIter (prefix, sizeof (prefix)).get32 ();
+    if (size > maxDeltaBytes)
+        return false;
+
+    Blob data;
+    while (data.size () < size)
+    {
+        auto const offset = data.size ();
+        data.resize (offset + std::min<std::size_t> (
+            size - offset, readChunkBytes));
+        if (!in.read (reinterpret_cast<char*> (data.data () + offset),
+                data.size () - offset))
+            return false;
+    }
+
+    return deserialize (make_Slice (data));
+}
+
+std::size_t
+SHAMapLeafDelta::applyStream (std::istream& in, SHAMap& map, bool flush)
+{
+    std::size_t applied = 0;
+    SHAMapLeafDelta delta;
+    while (delta.read (in) && delta.apply (map, flush))
+        ++applied;
+    return applied;
+}
+
+} // divvy
@@ -19,8 +19,18 @@
 
 #include <BeastConfig.h>
 #include <divvy/shamap/SHAMap.h>
+#include <divvy/basics/TaskPool.h>
 #include <divvy/nodestore/Database.h>
+#include <divvy/nodestore/ScopedReadPriority.h>
 #include <beast/unit_test/suite.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
 
 namespace divvy {
 
@@ -60,10 +70,34 @@ void SHAMap::visitNodes(std::function<bool (SHAMapAbstractNode&)> const& functio
     if (!root_->isInner ())
         return;
 
+    visitChildren (std::static_pointer_cast<SHAMapInnerNode>(root_), function);
+}
+
+void SHAMap::visitBranch (int branch,
+    std::function<bool (SHAMapAbstractNode&)> const& function) const
+{
+    assert ((branch >= 0) && (branch < 16));
+
+    if (!root_ || !root_->isInner ())
+        return;
+
+    auto const root = std::static_pointer_cast<SHAMapInnerNode>(root_);
+    if (root->isEmptyBranch (branch))
+        return;
+
+    std::shared_ptr<SHAMapAbstractNode> child = descendNoStore (root, branch);
+    if (function (*child) || child->isLeaf ())
+        return;
+
+    visitChildren (std::static_pointer_cast<SHAMapInnerNode>(child), function);
+}
+
+bool SHAMap::visitChildren (std::shared_ptr<SHAMapInnerNode> node,
+    std::function<bool (SHAMapAbstractNode&)> const& function) const
+{
     using StackEntry = std::pair <int, std::shared_ptr<SHAMapInnerNode>>;
     std::stack <StackEntry, std::vector <StackEntry>> stack;
 
-    auto node = std::static_pointer_cast<SHAMapInnerNode>(root_);
     int pos = 0;
 
     while (1)
@@ -75,7 +109,7 @@ void SHAMap::visitNodes(std::function<bool (SHAMapAbstractNode&)> const& functio
             {
                 std::shared_ptr<SHAMapAbstractNode> child = descendNoStore (node, pos);
                 if (function (*child))
-                    return;
+                    return true;
 
                 if (child->isLeaf ())
                     ++pos;
@@ -108,6 +142,52 @@ void SHAMap::visitNodes(std::function<bool (SHAMapAbstractNode&)> const& functio
         std::tie(pos, node) = stack.top ();
         stack.pop ();
     }
+
+    return false;
+}
+
+std::vector<uint256> SHAMap::getTopHashes (int depth) const
+{
+    std::vector<uint256> ret;
+
+    if (!root_)
+        return ret;
+
+    ret.push_back (root_->getNodeHash ());
+
+    std::vector<std::shared_ptr<SHAMapInnerNode>> level;
+    if (root_->isInner ())
+        level.push_back (std::static_pointer_cast<SHAMapInnerNode>(root_));
+
+    for (int d = 1; d <= depth && !level.empty (); ++d)
+    {
+        std::vector<std::shared_ptr<SHAMapInnerNode>> next;
+
+        for (auto const& node : level)
+        {
+            for (int branch = 0; branch < 16; ++branch)
+            {
+                if (node->isEmptyBranch (branch))
+                    continue;
+
+                ret.push_back (node->getChildHash (branch));
+
+                // The parent holds the hash, so the deepest level
+                // need not be loaded
+                if (d == depth)
+                    continue;
+
+                auto child = descendNoStore (node, branch);
+                if (child && child->isInner ())
+                    next.push_back (
+                        std::static_pointer_cast<SHAMapInnerNode>(child));
+            }
+        }
+
+        level.swap (next);
+    }
+
+    return ret;
 }
 
 /** Get a list of node IDs and hashes for nodes that are part of this SHAMap
@@ -297,6 +377,459 @@ SHAMap::getMissingNodes(std::vector<SHAMapNodeID>& nodeIDs, std::vector<uint256>
         clearSynching ();
 }
 
+//------------------------------------------------------------------------------
+
+// Tuning for the parallel missing node search
+enum
+{
+    // Most threads a search may use, counting the caller
+    missingNodesMaxThreads = 16,
+
+    // Most reads a worker has outstanding in one batch
+    missingNodesReadBatch = 128,
+
+    // Missing nodes collected before the handler is called
+    missingNodesDeliverCount = 64,
+
+    // Longest time a missing node waits for delivery, in milliseconds
+    missingNodesDeliverMillis = 10
+};
+
+// State shared by the threads of a parallel missing node search.
+// Helpers from the pool which only start once the search is closed
+// leave it alone, so it is held by shared_ptr.
+struct SHAMap::MissingNodesSearch
+{
+    using clock_type = std::chrono::steady_clock;
+
+    SHAMapSyncFilter* const filter;
+    std::uint32_t const generation;
+    NodeStore::ReadPriority const priority;
+
+    // Only used on the calling thread
+    std::thread::id const owner;
+    MissingNodesHandler const& handler;
+
+    std::atomic <int> nextBranch;
+    std::atomic <bool> stop;
+
+    std::mutex mutex;
+    std::condition_variable cond;
+
+    // The remaining members are protected by the mutex
+    int running;
+    bool closed;
+    int remaining;
+    bool fullBelow;
+    std::size_t delivered;
+    clock_type::time_point lastDelivery;
+    std::set <uint256> found;
+    std::vector <SHAMapNodeID> nodeIDs;
+    std::vector <uint256> hashes;
+    std::exception_ptr error;
+
+    MissingNodesSearch (SHAMapSyncFilter* filter_,
+            std::uint32_t generation_, int max,
+                MissingNodesHandler const& handler_)
+        : filter (filter_)
+        , generation (generation_)
+        , priority (NodeStore::ScopedReadPriority::get ())
+        , owner (std::this_thread::get_id ())
+        , handler (handler_)
+        , nextBranch (0)
+        , stop (false)
+        , running (1)
+        , closed (false)
+        , remaining (max)
+        , fullBelow (true)
+        , delivered (0)
+        , lastDelivery (clock_type::now ())
+    {
+    }
+
+    // Hand the collected nodes to the handler. Called on the calling
+    // thread with the lock held, which is released during the call.
+    void deliver (std::unique_lock <std::mutex>& lock)
+    {
+        std::vector <SHAMapNodeID> ids;
+        std::vector <uint256> hs;
+        ids.swap (nodeIDs);
+        hs.swap (hashes);
+        delivered += ids.size ();
+        lastDelivery = clock_type::now ();
+
+        lock.unlock ();
+        bool more = false;
+        try
+        {
+            more = handler (ids, hs);
+        }
+        catch (...)
+        {
+            lock.lock ();
+            if (!error)
+                error = std::current_exception ();
+            stop = true;
+            return;
+        }
+        lock.lock ();
+
+        if (! more)
+            stop = true;
+    }
+
+    // Deliver if enough has collected. Does nothing on a helper thread.
+    void poll ()
+    {
+        if (std::this_thread::get_id () != owner)
+            return;
+
+        std::unique_lock <std::mutex> lock (mutex);
+        if (nodeIDs.size () >= missingNodesDeliverCount ||
+            (! nodeIDs.empty () && (stop ||
+                clock_type::now () - lastDelivery >=
+                    std::chrono::milliseconds (missingNodesDeliverMillis))))
+        {
+            deliver (lock);
+        }
+    }
+
+    // Record a missing node. Returns `false` if the search is over.
+    bool report (SHAMapNodeID const& nodeID, uint256 const& hash)
+    {
+        std::lock_guard <std::mutex> lock (mutex);
+        if (found.insert (hash).second)
+        {
+            nodeIDs.push_back (nodeID);
+            hashes.push_back (hash);
+            if (--remaining <= 0)
+                stop = true;
+            if (stop || nodeIDs.size () >= missingNodesDeliverCount)
+                cond.notify_all ();
+        }
+        return ! stop;
+    }
+};
+
+std::size_t
+SHAMap::getMissingNodes (int max, SHAMapSyncFilter* filter,
+    int threads, MissingNodesHandler const& handler)
+{
+    assert (root_->isValid ());
+    assert (root_->getNodeHash().isNonZero ());
+
+    std::uint32_t generation = f_.fullbelow().getGeneration();
+
+    if (!root_->isInner ())
+    {
+        if (generation == 0)
+            clearSynching();
+        else if (journal_.warning) journal_.warning <<
+            "synching empty tree";
+        return 0;
+    }
+
+    auto const root = std::static_pointer_cast<SHAMapInnerNode>(root_);
+    if (root->isFullBelow (generation))
+    {
+        clearSynching ();
+        return 0;
+    }
+
+    threads = std::max (1, std::min <int> (threads, missingNodesMaxThreads));
+    auto const search = std::make_shared <MissingNodesSearch> (
+        filter, generation, max, handler);
+
+    auto work = [this] (MissingNodesSearch& search)
+    {
+        try
+        {
+            for (int branch = search.nextBranch++; branch < 16 && !search.stop;
+                    branch = search.nextBranch++)
+            {
+                if (! findMissingInBranch (branch, search))
+                {
+                    std::lock_guard <std::mutex> lock (search.mutex);
+                    search.fullBelow = false;
+                }
+                search.poll ();
+            }
+        }
+        catch (...)
+        {
+            std::lock_guard <std::mutex> lock (search.mutex);
+            if (!search.error)
+                search.error = std::current_exception ();
+            search.stop = true;
+        }
+    };
+
+    auto const start = std::chrono::steady_clock::now ();
+
+    // Helpers come from the process wide pool, so the threads searching
+    // at once stay bounded however many maps are being acquired. Their
+    // reads carry the caller's priority.
+    for (int i = 1; i < threads; ++i)
+    {
+        TaskPool::shared ().post ([search, work]
+        {
+            {
+                std::lock_guard <std::mutex> lock (search->mutex);
+                if (search->closed)
+                    return;
+                ++search->running;
+            }
+
+            {
+                NodeStore::ScopedReadPriority scope (search->priority);
+                work (*search);
+            }
+
+            std::lock_guard <std::mutex> lock (search->mutex);
+            --search->running;
+            search->cond.notify_all ();
+        });
+    }
+
+    // The calling thread searches too, so the search finishes even
+    // if the pool is busy, and delivers whatever the helpers find.
+    work (*search);
+
+    {
+        std::unique_lock <std::mutex> lock (search->mutex);
+        --search->running;
+        for (;;)
+        {
+            search->cond.wait_for (lock,
+                std::chrono::milliseconds (missingNodesDeliverMillis),
+                [&search]
+                {
+                    return search->running == 0 ||
+                        search->nodeIDs.size () >= missingNodesDeliverCount ||
+                        (search->stop && ! search->nodeIDs.empty ());
+                });
+
+            if (! search->nodeIDs.empty ())
+                search->deliver (lock);
+            else if (search->running == 0)
+                break;
+        }
+
+        // Helpers which have yet to start will find nothing to do
+        search->closed = true;
+    }
+
+    if (search->error)
+        std::rethrow_exception (search->error);
+
+    std::size_t const found = search->delivered;
+
+    if (search->fullBelow && !search->stop && found == 0)
+    {
+        root->setFullBelowGen (generation);
+        if (backed_)
+            f_.fullbelow().insert (root->getNodeHash ());
+    }
+
+    if (journal_.debug) journal_.debug <<
+        "getMissingNodes found " << found << " with up to " << threads <<
+            " threads in " << std::chrono::duration_cast <
+                std::chrono::milliseconds> (std::chrono::steady_clock::now () -
+                    start).count () << " ms";
+
+    if (found == 0)
+        clearSynching ();
+
+    return found;
+}
+
+// Search the subtree below one branch of the root.
+// Returns `true` if the subtree is complete.
+bool
+SHAMap::findMissingInBranch (int branch, MissingNodesSearch& search)
+{
+    auto const root = static_cast<SHAMapInnerNode*>(root_.get());
+    if (root->isEmptyBranch (branch))
+        return true;
+
+    uint256 const& hash = root->getChildHash (branch);
+    if (backed_ && f_.fullbelow().touch_if_exists (hash))
+        return true;
+
+    SHAMapNodeID const topID = SHAMapNodeID ().getChildNodeID (branch);
+    bool pending = false;
+    auto top = descendNoRead (root, branch, topID, search.filter, pending);
+    if (!top && pending)
+    {
+        std::set <uint256> missing;
+        readDeferred ({ std::make_tuple (root, branch, topID) }, search, missing);
+        top = descendNoRead (root, branch, topID, search.filter, pending);
+    }
+
+    if (!top)
+    {
+        if (!pending)
+            search.report (topID, hash);
+        return false;
+    }
+
+    if (!top->isInner ())
+        return true;
+
+    auto const inner = static_cast<SHAMapInnerNode*>(top);
+
+    // Missing nodes found below this branch. Branches are disjoint,
+    // so no other thread needs to see these.
+    std::set <uint256> missing;
+    std::vector <DeferredRead> deferred;
+    deferred.reserve (missingNodesReadBatch + 16);
+
+    // Each pass descends as far as the nodes already loaded allow,
+    // then loads the next batch. Only this thread waits for it.
+    while (!search.stop)
+    {
+        deferred.clear ();
+        bool const fullBelow = findMissingBelow (
+            inner, topID, search, deferred, missing);
+        if (deferred.empty ())
+            return fullBelow;
+        readDeferred (deferred, search, missing);
+        search.poll ();
+    }
+
+    return false;
+}
+
+// Make one pass over the subtree below an inner node, collecting up to a
+// batch of children which must be read. Returns `true` if the pass found
+// the subtree complete.
+bool
+SHAMap::findMissingBelow (SHAMapInnerNode* top, SHAMapNodeID const& topID,
+    MissingNodesSearch& search, std::vector<DeferredRead>& deferred,
+        std::set<uint256>& missing)
+{
+    using StackEntry = std::tuple<SHAMapInnerNode*, SHAMapNodeID, int, bool>;
+    std::stack <StackEntry, std::vector<StackEntry>> stack;
+
+    auto node = top;
+    SHAMapNodeID nodeID = topID;
+    int currentChild = 0;
+    bool fullBelow = true;
+
+    for (;;)
+    {
+        while (currentChild < 16)
+        {
+            int branch = currentChild++;
+            if (node->isEmptyBranch (branch))
+                continue;
+
+            uint256 const& childHash = node->getChildHash (branch);
+
+            if (missing.count (childHash) != 0)
+            {
+                fullBelow = false;
+            }
+            else if (! backed_ || ! f_.fullbelow().touch_if_exists (childHash))
+            {
+                SHAMapNodeID childID = nodeID.getChildNodeID (branch);
+                bool pending = false;
+                auto d = descendNoRead (node, branch, childID,
+                    search.filter, pending);
+
+                if (!d)
+                {
+                    if (pending)
+                        deferred.emplace_back (node, branch, childID);
+                    else if (missing.insert (childHash).second &&
+                            ! search.report (childID, childHash))
+                        return false;
+
+                    fullBelow = false;
+                }
+                else if (d->isInner() &&
+                         !static_cast<SHAMapInnerNode*>(d)->isFullBelow(search.generation))
+                {
+                    stack.push (std::make_tuple (node, nodeID,
+                                  currentChild, fullBelow));
+
+                    node = static_cast<SHAMapInnerNode*>(d);
+                    nodeID = childID;
+                    currentChild = 0;
+                    fullBelow = true;
+                }
+            }
+
+            if (deferred.size () >= missingNodesReadBatch)
+                return false;
+        }
+
+        if (fullBelow)
+        {
+            node->setFullBelowGen (search.generation);
+            if (backed_)
+                f_.fullbelow().insert (node->getNodeHash ());
+        }
+
+        if (stack.empty ())
+            return fullBelow;
+
+        bool was;
+        std::tie (node, nodeID, currentChild, was) = stack.top ();
+        fullBelow = was && fullBelow;
+        stack.pop ();
+    }
+}
+
+// Read a batch of deferred children and hook them into their parents.
+// Children which can't be found are reported missing. The batch is read
+// on this thread, so it waits for its own keys and nobody else's.
+void
+SHAMap::readDeferred (std::vector<DeferredRead> const& deferred,
+    MissingNodesSearch& search, std::set<uint256>& missing)
+{
+    std::vector <uint256> hashes;
+    hashes.reserve (deferred.size ());
+    for (auto const& read : deferred)
+        hashes.push_back (std::get<0>(read)->getChildHash (std::get<1>(read)));
+
+    auto const objects = f_.db().fetchBatch (hashes);
+
+    for (std::size_t i = 0; i < deferred.size (); ++i)
+    {
+        auto parent = std::get<0>(deferred[i]);
+        auto branch = std::get<1>(deferred[i]);
+        auto const& nodeID = std::get<2>(deferred[i]);
+        auto const& nodeHash = hashes[i];
+
+        std::shared_ptr<SHAMapAbstractNode> node;
+        if (objects[i])
+        {
+            try
+            {
+                node = SHAMapAbstractNode::make (objects[i]->getData(),
+                    0, snfPREFIX, nodeHash, true);
+            }
+            catch (...)
+            {
+                if (journal_.warning) journal_.warning <<
+                    "Invalid DB node " << nodeHash;
+            }
+        }
+
+        if (node)
+        {
+            canonicalize (nodeHash, node);
+            parent->canonicalizeChild (branch, std::move (node));
+        }
+        else if (missing.insert (nodeHash).second &&
+            ! search.report (nodeID, nodeHash))
+        {
+            return;
+        }
+    }
+}
+
 std::vector<uint256> SHAMap::getNeededHashes (int max, SHAMapSyncFilter* filter)
 {
     std::vector<uint256> nodeHashes;
@@ -19,6 +19,7 @@
 
 #include <BeastConfig.h>
 #include <divvy/shamap/SHAMapTreeNode.h>
+#include <divvy/shamap/TreeNodeCache.h>
 #include <divvy/basics/Log.h>
 #include <divvy/basics/SHA512Half.h>
 #include <divvy/basics/Slice.h>
@@ -31,28 +32,151 @@
 
 namespace divvy {
 
-std::mutex SHAMapInnerNode::childLock;
-
 SHAMapAbstractNode::~SHAMapAbstractNode() = default;
 
+uint256 const SHAMapInnerNode::zeroHash;
+
+int
+SHAMapInnerNode::capacityFor (int branches)
+{
+    if (branches > sparseLimit)
+        return fullCapacity;
+
+    // Round up so that adding a branch rarely reallocates
+    return (branches + 1) & ~1;
+}
+
+// Each slot holds a child hash and a child pointer
+static std::size_t const slotBytes =
+    sizeof (uint256) + sizeof (std::shared_ptr<SHAMapAbstractNode>);
+
+SlabPool&
+SHAMapInnerNode::slotPool (int capacity)
+{
+    switch (capacity)
+    {
+    case 2: return getSlabPool <2 * slotBytes> ();
+    case 4: return getSlabPool <4 * slotBytes> ();
+    case 6: return getSlabPool <6 * slotBytes> ();
+    default: break;
+    }
+    assert (capacity == fullCapacity);
+    return getSlabPool <fullCapacity * slotBytes> ();
+}
+
+SHAMapInnerNode::~SHAMapInnerNode ()
+{
+    resize (0);
+}
+
+// Move the populated branches into storage of the given capacity, or
+// release the storage if the capacity is zero. The caller holds
+// mChildLock or owns the node exclusively.
+void
+SHAMapInnerNode::resize (int capacity)
+{
+    using Child = std::shared_ptr<SHAMapAbstractNode>;
+
+    void* slots = nullptr;
+    uint256* newHashes = nullptr;
+    Child* newChildren = nullptr;
+
+    if (capacity != 0)
+    {
+        slots = slotPool (capacity).allocate ();
+        newHashes = static_cast<uint256*> (slots);
+        newChildren = reinterpret_cast<Child*> (newHashes + capacity);
+        for (int i = 0; i < capacity; ++i)
+        {
+            new (&newHashes[i]) uint256;
+            new (&newChildren[i]) Child;
+        }
+    }
+
+    if (mSlots != nullptr)
+    {
+        uint256* const oldHashes = hashes ();
+        Child* const oldChildren = children ();
+
+        int packed = 0;
+        for (int i = 0; slots != nullptr && i < 16; ++i)
+        {
+            if (isEmptyBranch (i))
+                continue;
+
+            int const from = (mCapacity == fullCapacity) ? i : packed;
+            int const to = (capacity == fullCapacity) ? i : packed;
+            ++packed;
+
+            newHashes[to] = oldHashes[from];
+            newChildren[to] = std::move (oldChildren[from]);
+        }
+
+        for (int i = 0; i < mCapacity; ++i)
+            oldChildren[i].~Child ();
+        slotPool (mCapacity).deallocate (mSlots);
+    }
+
+    mSlots = slots;
+    mCapacity = static_cast<std::uint8_t> (capacity);
+}
+
+void
+SHAMapInnerNode::setHashes (uint256 const (&branchHashes)[16])
+{
+    assert (mIsBranch == 0);
+
+    int branches = 0;
+    for (int i = 0; i < 16; ++i)
+        if (branchHashes[i].isNonZero ())
+            ++branches;
+    resize (capacityFor (branches));
+
+    for (int i = 0; i < 16; ++i)
+        if (branchHashes[i].isNonZero ())
+            mIsBranch |= (1 << i);
+
+    for (int i = 0; i < 16; ++i)
+        if (!isEmptyBranch (i))
+            hashes ()[slot (i)] = branchHashes[i];
+}
+
+std::size_t
+SHAMapInnerNode::getSlotBytes () const
+{
+    if (mCapacity == 0)
+        return 0;
+    return slotPool (mCapacity).blockSize ();
+}
+
 std::shared_ptr<SHAMapAbstractNode>
 SHAMapInnerNode::clone(std::uint32_t seq) const
 {
-    auto p = std::make_shared<SHAMapInnerNode>(seq);
+    auto p = make_pooled<SHAMapInnerNode> (seq);
     p->mHash = mHash;
-    p->mIsBranch = mIsBranch;
     p->mFullBelowGen = mFullBelowGen;
-    std::memcpy(p->mHashes, mHashes, sizeof(mHashes));
-    std::unique_lock <std::mutex> lock(childLock);
+
+    // The copy gets storage sized for the branches it has now
+    p->resize (capacityFor (getBranchCount ()));
+    p->mIsBranch = mIsBranch;
+
+    beast::SpinLock::ScopedLockType lock (mChildLock);
     for (int i = 0; i < 16; ++i)
-        p->mChildren[i] = mChildren[i];
+    {
+        if (isEmptyBranch (i))
+            continue;
+        int const from = slot (i);
+        int const to = p->slot (i);
+        p->hashes ()[to] = hashes ()[from];
+        p->children ()[to] = children ()[from];
+    }
     return std::move(p);
 }
 
 std::shared_ptr<SHAMapAbstractNode>
 SHAMapTreeNode::clone(std::uint32_t seq) const
 {
-    return std::make_shared<SHAMapTreeNode>(mItem, mType, seq, mHash);
+    return make_pooled<SHAMapTreeNode> (mItem, mType, seq, mHash);
 }
 
 SHAMapTreeNode::SHAMapTreeNode (std::shared_ptr<SHAMapItem> const& item,
@@ -91,13 +215,13 @@ SHAMapAbstractNode::make(Blob const& rawNode, std::uint32_t seq, SHANodeFormat f
         if (type == 0)
         {
             // transaction
-            auto item = std::make_shared<SHAMapItem>(
+            auto item = make_pooled<SHAMapItem> (
                 sha512Half(HashPrefix::transactionID,
                     Slice(s.data(), s.size())),
                         s.peekData());
             if (hashValid)
-                return std::make_shared<SHAMapTreeNode>(item, tnTRANSACTION_NM, seq, hash);
-            return std::make_shared<SHAMapTreeNode>(item, tnTRANSACTION_NM, seq);
+                return make_pooled<SHAMapTreeNode> (item, tnTRANSACTION_NM, seq, hash);
+            return make_pooled<SHAMapTreeNode> (item, tnTRANSACTION_NM, seq);
         }
         else if (type == 1)
         {
@@ -111,10 +235,10 @@ SHAMapAbstractNode::make(Blob const& rawNode, std::uint32_t seq, SHANodeFormat f
 
             if (u.isZero ()) throw std::runtime_error ("invalid AS node");
 
-            auto item = std::make_shared<SHAMapItem> (u, s.peekData ());
+            auto item = make_pooled<SHAMapItem> (u, s.peekData ());
             if (hashValid)
-                return std::make_shared<SHAMapTreeNode>(item, tnACCOUNT_STATE, seq, hash);
-            return std::make_shared<SHAMapTreeNode>(item, tnACCOUNT_STATE, seq);
+                return make_pooled<SHAMapTreeNode> (item, tnACCOUNT_STATE, seq, hash);
+            return make_pooled<SHAMapTreeNode> (item, tnACCOUNT_STATE, seq);
         }
         else if (type == 2)
         {
@@ -122,14 +246,11 @@ SHAMapAbstractNode::make(Blob const& rawNode, std::uint32_t seq, SHANodeFormat f
             if (len != 512)
                 throw std::runtime_error ("invalid FI node");
 
-            auto ret = std::make_shared<SHAMapInnerNode>(seq);
+            auto ret = make_pooled<SHAMapInnerNode> (seq);
+            uint256 hashes[16];
             for (int i = 0; i < 16; ++i)
-            {
-                s.get256 (ret->mHashes[i], i * 32);
-
-                if (ret->mHashes[i].isNonZero ())
-                    ret->mIsBranch |= (1 << i);
-            }
+                s.get256 (hashes[i], i * 32);
+            ret->setHashes (hashes);
             if (hashValid)
                 ret->mHash = hash;
             else
@@ -138,7 +259,8 @@ SHAMapAbstractNode::make(Blob const& rawNode, std::uint32_t seq, SHANodeFormat f
         }
         else if (type == 3)
         {
-            auto ret = std::make_shared<SHAMapInnerNode>(seq);
+            auto ret = make_pooled<SHAMapInnerNode> (seq);
+            uint256 hashes[16];
             // compressed inner
             for (int i = 0; i < (len / 33); ++i)
             {
@@ -147,11 +269,9 @@ SHAMapAbstractNode::make(Blob const& rawNode, std::uint32_t seq, SHANodeFormat f
 
                 if ((pos < 0) || (pos >= 16)) throw std::runtime_error ("invalid CI node");
 
-                s.get256 (ret->mHashes[pos], i * 33);
-
-                if (ret->mHashes[pos].isNonZero ())
-                    ret->mIsBranch |= (1 << pos);
+                s.get256 (hashes[pos], i * 33);
             }
+            ret->setHashes (hashes);
             if (hashValid)
                 ret->mHash = hash;
             else
@@ -171,10 +291,10 @@ SHAMapAbstractNode::make(Blob const& rawNode, std::uint32_t seq, SHANodeFormat f
             if (u.isZero ())
                 throw std::runtime_error ("invalid TM node");
 
-            auto item = std::make_shared<SHAMapItem> (u, s.peekData ());
+            auto item = make_pooled<SHAMapItem> (u, s.peekData ());
             if (hashValid)
-                return std::make_shared<SHAMapTreeNode>(item, tnTRANSACTION_MD, seq, hash);
-            return std::make_shared<SHAMapTreeNode>(item, tnTRANSACTION_MD, seq);
+                return make_pooled<SHAMapTreeNode> (item, tnTRANSACTION_MD, seq, hash);
+            return make_pooled<SHAMapTreeNode> (item, tnTRANSACTION_MD, seq);
         }
     }
 
@@ -197,12 +317,12 @@ SHAMapAbstractNode::make(Blob const& rawNode, std::uint32_t seq, SHANodeFormat f
 
         if (prefix == HashPrefix::transactionID)
         {
-            auto item = std::make_shared<SHAMapItem>(
+            auto item = make_pooled<SHAMapItem> (
                 sha512Half(make_Slice(rawNode)),
                     s.peekData ());
             if (hashValid)
-                return std::make_shared<SHAMapTreeNode>(item, tnTRANSACTION_NM, seq, hash);
-            return std::make_shared<SHAMapTreeNode>(item, tnTRANSACTION_NM, seq);
+                return make_pooled<SHAMapTreeNode> (item, tnTRANSACTION_NM, seq, hash);
+            return make_pooled<SHAMapTreeNode> (item, tnTRANSACTION_NM, seq);
         }
         else if (prefix == HashPrefix::leafNode)
         {
@@ -219,23 +339,20 @@ SHAMapAbstractNode::make(Blob const& rawNode, std::uint32_t seq, SHANodeFormat f
                 throw std::runtime_error ("invalid PLN node");
             }
 
-            auto item = std::make_shared<SHAMapItem> (u, s.peekData ());
+            auto item = make_pooled<SHAMapItem> (u, s.peekData ());
             if (hashValid)
-                return std::make_shared<SHAMapTreeNode>(item, tnACCOUNT_STATE, seq, hash);
-            return std::make_shared<SHAMapTreeNode>(item, tnACCOUNT_STATE, seq);
+                return make_pooled<SHAMapTreeNode> (item, tnACCOUNT_STATE, seq, hash);
+            return make_pooled<SHAMapTreeNode> (item, tnACCOUNT_STATE, seq);
         }
         else if (prefix == HashPrefix::innerNode)
         {
             if (s.getLength () != 512)
                 throw std::runtime_error ("invalid PIN node");
-            auto ret = std::make_shared<SHAMapInnerNode>(seq);
+            auto ret = make_pooled<SHAMapInnerNode> (seq);
+            uint256 hashes[16];
             for (int i = 0; i < 16; ++i)
-            {
-                s.get256 (ret->mHashes[i], i * 32);
-
-                if (ret->mHashes[i].isNonZero ())
-                    ret->mIsBranch |= (1 << i);
-            }
+                s.get256 (hashes[i], i * 32);
+            ret->setHashes (hashes);
             if (hashValid)
                 ret->mHash = hash;
             else
@@ -251,10 +368,10 @@ SHAMapAbstractNode::make(Blob const& rawNode, std::uint32_t seq, SHANodeFormat f
             uint256 txID;
             s.get256 (txID, s.getLength () - 32);
             s.chop (32);
-            auto item = std::make_shared<SHAMapItem> (txID, s.peekData ());
+            auto item = make_pooled<SHAMapItem> (txID, s.peekData ());
             if (hashValid)
-                return std::make_shared<SHAMapTreeNode>(item, tnTRANSACTION_MD, seq, hash);
-            return std::make_shared<SHAMapTreeNode>(item, tnTRANSACTION_MD, seq);
+                return make_pooled<SHAMapTreeNode> (item, tnTRANSACTION_MD, seq, hash);
+            return make_pooled<SHAMapTreeNode> (item, tnTRANSACTION_MD, seq);
         }
         else
         {
@@ -272,14 +389,27 @@ SHAMapInnerNode::updateHash()
     uint256 nh;
     if (mIsBranch != 0)
     {
+        // The hash always covers all sixteen branches, empty ones as zero
+        uint256 expanded[16];
+        uint256 const* all = hashes ();
+        if (mCapacity != fullCapacity)
+        {
+            for (int i = 0; i < 16; ++i)
+                if (!isEmptyBranch (i))
+                    expanded[i] = hashes ()[slot (i)];
+            all = expanded;
+        }
+
         // VFALCO This code assumes the layout of a base_uint
         nh = sha512Half(HashPrefix::innerNode,
-            Slice(reinterpret_cast<unsigned char const*>(mHashes),
-                sizeof (mHashes)));
+            Slice(reinterpret_cast<unsigned char const*>(all),
+                sizeof (expanded)));
 #if RIPPLE_VERIFY_NODEOBJECT_KEYS
         SHA512HalfHasher h;
         using beast::hash_append;
-        hash_append(h, HashPrefix::innerNode, mHashes);
+        hash_append(h, HashPrefix::innerNode);
+        for (int i = 0; i < 16; ++i)
+            hash_append(h, getChildHash (i));
         assert (nh == sha512Half(
             static_cast<uint256>(h)));
 #endif
@@ -293,10 +423,10 @@ SHAMapInnerNode::updateHash()
 void
 SHAMapInnerNode::updateHashDeep()
 {
-    for (auto pos = 0; pos < 16; ++pos)
+    for (auto pos = 0; pos < mCapacity; ++pos)
     {
-        if (mChildren[pos] != nullptr)
-            mHashes[pos] = mChildren[pos]->getNodeHash();
+        if (children ()[pos] != nullptr)
+            hashes ()[pos] = children ()[pos]->getNodeHash();
     }
     updateHash();
 }
@@ -353,7 +483,7 @@ SHAMapInnerNode::addRaw(Serializer& s, SHANodeFormat format)
             s.add32 (HashPrefix::innerNode);
 
             for (int i = 0; i < 16; ++i)
-                s.add256 (mHashes[i]);
+                s.add256 (getChildHash (i));
         }
         else
         {
@@ -363,7 +493,7 @@ SHAMapInnerNode::addRaw(Serializer& s, SHANodeFormat format)
                 for (int i = 0; i < 16; ++i)
                     if (!isEmptyBranch (i))
                     {
-                        s.add256 (mHashes[i]);
+                        s.add256 (getChildHash (i));
                         s.add8 (i);
                     }
 
@@ -372,7 +502,7 @@ SHAMapInnerNode::addRaw(Serializer& s, SHANodeFormat format)
             else
             {
                 for (int i = 0; i < 16; ++i)
-                    s.add256 (mHashes[i]);
+                    s.add256 (getChildHash (i));
 
                 s.add8 (2);
             }
@@ -458,13 +588,7 @@ bool SHAMapInnerNode::isEmpty () const
 int SHAMapInnerNode::getBranchCount () const
 {
     assert (isInner ());
-    int count = 0;
-
-    for (int i = 0; i < 16; ++i)
-        if (!isEmptyBranch (i))
-            ++count;
-
-    return count;
+    return static_cast<int> (std::bitset<16> (mIsBranch).count ());
 }
 
 #ifdef BEAST_DEBUG
@@ -500,7 +624,7 @@ SHAMapInnerNode::getString(const SHAMapNodeID & id) const
             ret += "\nb";
             ret += beast::lexicalCastThrow <std::string> (i);
             ret += " = ";
-            ret += to_string (mHashes[i]);
+            ret += to_string (getChildHash (i));
         }
     }
     return ret;
@@ -536,13 +660,56 @@ SHAMapInnerNode::setChild(int m, std::shared_ptr<SHAMapAbstractNode> const& chil
     assert (mType == tnINNER);
     assert (mSeq != 0);
     assert (child.get() != this);
-    mHashes[m].zero();
     mHash.zero();
+
+    beast::SpinLock::ScopedLockType lock (mChildLock);
     if (child)
-        mIsBranch |= (1 << m);
-    else
+    {
+        if (isEmptyBranch (m))
+        {
+            int const count = getBranchCount () + 1;
+            if (capacityFor (count) > mCapacity)
+                resize (capacityFor (count));
+
+            if (mCapacity != fullCapacity)
+            {
+                // Open a gap at the new branch's packed position
+                int const pos = slot (m);
+                for (int i = count - 1; i > pos; --i)
+                {
+                    hashes ()[i] = hashes ()[i - 1];
+                    children ()[i] = std::move (children ()[i - 1]);
+                }
+            }
+            mIsBranch |= (1 << m);
+        }
+
+        int const pos = slot (m);
+        hashes ()[pos].zero();
+        children ()[pos] = child;
+    }
+    else if (!isEmptyBranch (m))
+    {
+        int const pos = slot (m);
+        if (mCapacity == fullCapacity)
+        {
+            hashes ()[pos].zero();
+            children ()[pos].reset();
+        }
+        else
+        {
+            // Close the gap left by the removed branch
+            int const count = getBranchCount ();
+            for (int i = pos; i + 1 < count; ++i)
+            {
+                hashes ()[i] = hashes ()[i + 1];
+                children ()[i] = std::move (children ()[i + 1]);
+            }
+            hashes ()[count - 1].zero();
+            children ()[count - 1].reset();
+        }
         mIsBranch &= ~ (1 << m);
-    mChildren[m] = child;
+    }
 }
 
 // finished modifying, now make shareable
@@ -553,8 +720,9 @@ void SHAMapInnerNode::shareChild (int m, std::shared_ptr<SHAMapAbstractNode> con
     assert (mSeq != 0);
     assert (child);
     assert (child.get() != this);
+    assert (!isEmptyBranch (m));
 
-    mChildren[m] = child;
+    children ()[slot (m)] = child;
 }
 
 SHAMapAbstractNode*
@@ -563,8 +731,10 @@ SHAMapInnerNode::getChildPointer (int branch)
     assert (branch >= 0 && branch < 16);
     assert (isInner());
 
-    std::unique_lock <std::mutex> lock (childLock);
-    return mChildren[branch].get ();
+    beast::SpinLock::ScopedLockType lock (mChildLock);
+    if (isEmptyBranch (branch))
+        return nullptr;
+    return children ()[slot (branch)].get ();
 }
 
 std::shared_ptr<SHAMapAbstractNode>
@@ -573,8 +743,10 @@ SHAMapInnerNode::getChild (int branch)
     assert (branch >= 0 && branch < 16);
     assert (isInner());
 
-    std::unique_lock <std::mutex> lock (childLock);
-    return mChildren[branch];
+    beast::SpinLock::ScopedLockType lock (mChildLock);
+    if (isEmptyBranch (branch))
+        return {};
+    return children ()[slot (branch)];
 }
 
 std::shared_ptr<SHAMapAbstractNode>
@@ -583,21 +755,35 @@ SHAMapInnerNode::canonicalizeChild(int branch, std::shared_ptr<SHAMapAbstractNod
     assert (branch >= 0 && branch < 16);
     assert (isInner());
     assert (node);
-    assert (node->getNodeHash() == mHashes[branch]);
+    assert (node->getNodeHash() == getChildHash (branch));
 
-    std::unique_lock <std::mutex> lock (childLock);
-    if (mChildren[branch])
+    beast::SpinLock::ScopedLockType lock (mChildLock);
+    assert (!isEmptyBranch (branch));
+    auto& child = children ()[slot (branch)];
+    if (child)
     {
         // There is already a node hooked up, return it
-        node = mChildren[branch];
+        node = child;
     }
     else
     {
         // Hook this node up
-        mChildren[branch] = node;
+        child = node;
     }
     return node;
 }
 
+std::size_t
+cacheFootprint (SHAMapAbstractNode const& node)
+{
+    if (node.isInner ())
+        return sizeof (SHAMapInnerNode) +
+            static_cast <SHAMapInnerNode const&> (node).getSlotBytes ();
+
+    auto const& item = static_cast <SHAMapTreeNode const&> (node).peekItem ();
+    if (! item)
+        return sizeof (SHAMapTreeNode);
+    return sizeof (SHAMapTreeNode) + sizeof (SHAMapItem) + item->size ();
+}
 
 } // divvy
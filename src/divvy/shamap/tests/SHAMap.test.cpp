@@ -21,9 +21,12 @@
 #include <divvy/shamap/SHAMap.h>
 #include <divvy/shamap/tests/common.h>
 #include <divvy/basics/Blob.h>
+#include <divvy/basics/SHA512Half.h>
 #include <divvy/basics/StringUtilities.h>
+#include <beast/random/xor_shift_engine.h>
 #include <beast/unit_test/suite.h>
 #include <beast/utility/Journal.h>
+#include <algorithm>
 
 namespace divvy {
 namespace shamap {
@@ -87,6 +90,30 @@ public:
         i = sMap.peekNextItem (i->getTag ());
         unexpected (i, "bad traverse");
 
+        testcase ("iterate");
+        {
+            std::vector<uint256> tags;
+            for (auto const& item : sMap)
+                tags.push_back (item->key ());
+            unexpected (tags.size () != 3, "bad iterate");
+            unexpected (tags[0] != h1 || tags[1] != h3 || tags[2] != h4,
+                "bad iterate");
+
+            auto it = sMap.upper_bound (h1);
+            unexpected (it == sMap.end () || (*it)->key () != h3, "bad seek");
+            ++it;
+            unexpected (it == sMap.end () || (*it)->key () != h4, "bad seek");
+            ++it;
+            unexpected (it != sMap.end (), "bad seek");
+
+            // Keys which are not in the map
+            it = sMap.upper_bound (uint256 ());
+            unexpected (it == sMap.end () || (*it)->key () != h1, "bad seek");
+            it = sMap.upper_bound (h2);
+            unexpected (it == sMap.end () || (*it)->key () != h3, "bad seek");
+            unexpected (sMap.upper_bound (h4) != sMap.end (), "bad seek");
+        }
+
         testcase ("snapshot");
         uint256 mapHash = sMap.getHash ();
         std::shared_ptr<SHAMap> map2 = sMap.snapShot (false);
@@ -134,6 +161,145 @@ public:
             }
             expect (map.getHash() == uint256(), "bad final empty map hash");
         }
+
+        testcase ("parallel flush");
+        {
+            SHAMap serial (SHAMapType::FREE, f, beast::Journal());
+            SHAMap parallel (SHAMapType::FREE, f, beast::Journal());
+
+            beast::xor_shift_engine gen;
+            for (int i = 0; i < 1000; ++i)
+            {
+                uint256 key;
+                auto p = reinterpret_cast<std::uint64_t*> (key.begin ());
+                for (int j = 0; j < 4; ++j)
+                    p[j] = gen ();
+                SHAMapItem item (key, IntToVUC (i));
+                serial.addItem (item, false, false);
+                parallel.addItem (item, false, false);
+            }
+
+            int const n = serial.flushDirty (hotACCOUNT_NODE, 1);
+            expect (parallel.flushDirty (hotACCOUNT_NODE, 1, true) == n,
+                "bad flush count");
+            expect (serial.getHash () == parallel.getHash (),
+                "bad flush hash");
+            expect (f.db().fetch (parallel.getHash ()) != nullptr,
+                "root not stored");
+
+            // A second flush has nothing left to do
+            expect (parallel.flushDirty (hotACCOUNT_NODE, 1, true) == 0,
+                "bad second flush");
+
+            testcase ("visit branch");
+
+            std::vector<uint256> all;
+            serial.visitNodes ([&all] (SHAMapAbstractNode& node)
+            {
+                all.push_back (node.getNodeHash ());
+                return false;
+            });
+
+            // The root plus each branch covers the whole map
+            std::vector<uint256> split;
+            split.push_back (serial.getHash ());
+            for (int branch = 0; branch < 16; ++branch)
+            {
+                serial.visitBranch (branch, [&split] (SHAMapAbstractNode& node)
+                {
+                    split.push_back (node.getNodeHash ());
+                    return false;
+                });
+            }
+            expect (all == split, "bad branch visit");
+
+            testcase ("top hashes");
+
+            auto top = serial.getTopHashes (0);
+            expect (top.size () == 1 && top[0] == serial.getHash (),
+                "bad root hash");
+
+            // Deep enough to reach every node
+            top = serial.getTopHashes (64);
+            std::sort (top.begin (), top.end ());
+            std::sort (all.begin (), all.end ());
+            expect (top == all, "bad top hashes");
+
+            expect (serial.getTopHashes (1).size () == 17, "bad first level");
+        }
+
+        testcase ("sparse inner nodes");
+        {
+            beast::xor_shift_engine gen;
+            auto inner = std::make_shared<SHAMapInnerNode> (1);
+            std::shared_ptr<SHAMapAbstractNode> leaves[16];
+
+            int order[16];
+            for (int i = 0; i < 16; ++i)
+                order[i] = i;
+            std::shuffle (std::begin (order), std::end (order), gen);
+
+            // The official hash covers all sixteen branches
+            auto const check = [&]()
+            {
+                inner->updateHashDeep ();
+                Serializer s;
+                inner->addRaw (s, snfPREFIX);
+                expect (inner->getNodeHash () == sha512Half (
+                    make_Slice (s.peekData ())), "bad sparse hash");
+
+                auto copy = SHAMapAbstractNode::make (s.peekData (), 0,
+                    snfPREFIX, uint256 (), false);
+                expect (copy->getNodeHash () == inner->getNodeHash (),
+                    "bad sparse round trip");
+
+                for (int i = 0; i < 16; ++i)
+                {
+                    expect (inner->getChild (i) == leaves[i],
+                        "bad sparse child");
+                    expect (inner->isEmptyBranch (i) == !leaves[i],
+                        "bad sparse branch");
+                }
+            };
+
+            for (int i = 0; i < 16; ++i)
+            {
+                uint256 key;
+                auto p = reinterpret_cast<std::uint64_t*> (key.begin ());
+                for (int j = 0; j < 4; ++j)
+                    p[j] = gen ();
+                auto const branch = order[i];
+                leaves[branch] = std::make_shared<SHAMapTreeNode> (
+                    std::make_shared<SHAMapItem> (key, IntToVUC (i)),
+                    SHAMapAbstractNode::tnACCOUNT_STATE, 1);
+                inner->setChild (branch, leaves[branch]);
+                check ();
+
+                expect (inner->getBranchCount () == i + 1);
+                if (i < 6)
+                    expect (inner->getCapacity () <= 6, "not sparse");
+                else
+                    expect (inner->getCapacity () == 16, "not full");
+                expect (inner->getSlotBytes () >= inner->getCapacity () *
+                    (sizeof (uint256) + sizeof (leaves[0])), "bad slot bytes");
+            }
+
+            // Remove branches in a different order
+            std::shuffle (std::begin (order), std::end (order), gen);
+            for (int i = 0; i < 14; ++i)
+            {
+                auto const branch = order[i];
+                leaves[branch].reset ();
+                inner->setChild (branch, nullptr);
+                check ();
+            }
+
+            // A copy is sized for the branches it holds
+            inner = std::static_pointer_cast<SHAMapInnerNode> (
+                inner->clone (2));
+            expect (inner->getCapacity () == 2, "bad clone capacity");
+            check ();
+        }
     }
 };
 
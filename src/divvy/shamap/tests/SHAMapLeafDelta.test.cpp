@@ -0,0 +1,254 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of divvyd: https://github.com/xdv/divvyd
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <divvy/shamap/SHAMapLeafDelta.h>
+#include <divvy/shamap/tests/common.h>
+#include <divvy/protocol/Serializer.h>
+#include <beast/unit_test/suite.h>
+#include <sstream>
+
+namespace divvy {
+namespace shamap {
+namespace tests {
+
+class SHAMapLeafDelta_test : public beast::unit_test::suite
+{
+    static std::shared_ptr<SHAMapItem> makeItem (uint256 const& key)
+    {
+        Serializer s;
+        for (int d = 0; d < 3; ++d) s.add32 (rand ());
+        return std::make_shared<SHAMapItem> (key, s.peekData ());
+    }
+
+    static std::shared_ptr<SHAMapItem> makeRandomItem ()
+    {
+        Serializer s;
+        for (int d = 0; d < 3; ++d) s.add32 (rand ());
+        return makeItem (s.getSHA512Half ());
+    }
+
+    // Make the next "ledger": change, remove and add some items
+    std::shared_ptr<SHAMap> makeNext (std::shared_ptr<SHAMap> const& prev,
+        std::vector<uint256>& keys)
+    {
+        auto next = prev->snapShot (true);
+
+        for (int i = 0; i < 20; ++i)
+        {
+            auto const& key = keys[rand () % keys.size ()];
+            expect (next->updateGiveItem (makeItem (key), false, false));
+        }
+
+        for (int i = 0; i < 10; ++i)
+        {
+            auto const index = rand () % keys.size ();
+            expect (next->delItem (keys[index]));
+            keys.erase (keys.begin () + index);
+        }
+
+        for (int i = 0; i < 30; ++i)
+        {
+            auto const item = makeRandomItem ();
+            keys.push_back (item->key ());
+            expect (next->addGiveItem (item, false, false));
+        }
+
+        next->setImmutable ();
+        return next;
+    }
+
+public:
+    void testApply ()
+    {
+        testcase ("apply");
+
+        beast::Journal const j;
+        TestFamily f (j);
+
+        std::vector<uint256> keys;
+        auto base = std::make_shared<SHAMap> (SHAMapType::FREE, f, j);
+        for (int i = 0; i < 1000; ++i)
+        {
+            auto const item = makeRandomItem ();
+            keys.push_back (item->key ());
+            base->addGiveItem (item, false, false);
+        }
+        expect (base->getHash ().isNonZero ());
+        base->setImmutable ();
+
+        auto const next = makeNext (base, keys);
+
+        SHAMapLeafDelta const delta (*base, next,
+            SHAMapTreeNode::tnACCOUNT_STATE, 2);
+        expect (delta.from () == base->getHash ());
+        expect (delta.to () == next->getHash ());
+        expect (! delta.changes ().empty ());
+        expect (delta.changes ().size () <= 60);
+
+        for (bool flush : {false, true})
+        {
+            auto map = base->snapShot (true);
+            expect (delta.apply (*map, flush), "apply");
+            expect (map->getHash () == next->getHash ());
+            expect (map->deepCompare (*next));
+        }
+
+        // The delta for the other direction undoes it
+        SHAMapLeafDelta const undo (*next, base,
+            SHAMapTreeNode::tnACCOUNT_STATE, 1);
+        auto map = next->snapShot (true);
+        expect (undo.apply (*map, false));
+        expect (map->getHash () == base->getHash ());
+
+        // A map at a different root hash is refused
+        expect (! delta.apply (*next->snapShot (true), false));
+
+        // A delta that does not reach its target fails the check
+        {
+            // Flip a bit of the root hash after
+            auto data = delta.serialize ();
+            data[4 + 1 + 1 + 4 + 32] ^= 0x01;
+            SHAMapLeafDelta bad;
+            expect (bad.deserialize (make_Slice (data)));
+            expect (! bad.apply (*base->snapShot (true), false));
+        }
+    }
+
+    void testEncoding ()
+    {
+        testcase ("encoding");
+
+        beast::Journal const j;
+        TestFamily f (j);
+
+        std::vector<uint256> keys;
+        auto base = std::make_shared<SHAMap> (SHAMapType::FREE, f, j);
+        for (int i = 0; i < 500; ++i)
+        {
+            auto const item = makeRandomItem ();
+            keys.push_back (item->key ());
+            base->addGiveItem (item, false, false);
+        }
+        base->getHash ();
+        base->setImmutable ();
+
+        auto const next = makeNext (base, keys);
+        SHAMapLeafDelta const delta (*base, next,
+            SHAMapTreeNode::tnACCOUNT_STATE, 7);
+
+        auto const data = delta.serialize ();
+        SHAMapLeafDelta copy;
+        expect (copy.deserialize (make_Slice (data)));
+        expect (copy.from () == delta.from ());
+        expect (copy.to () == delta.to ());
+        expect (copy.seq () == 7);
+        expect (copy.type () == SHAMapTreeNode::tnACCOUNT_STATE);
+        expect (copy.changes ().size () == delta.changes ().size ());
+        expect (copy.serialize () == data);
+
+        // Truncated or padded data is rejected
+        {
+            Blob truncated (data.begin (), data.end () - 1);
+            expect (! copy.deserialize (make_Slice (truncated)));
+
+            Blob padded (data);
+            padded.push_back (0);
+            expect (! copy.deserialize (make_Slice (padded)));
+
+            Blob wrongMagic (data);
+            wrongMagic[0] ^= 0xff;
+            expect (! copy.deserialize (make_Slice (wrongMagic)));
+        }
+
+        // A failed decode leaves the delta as it was
+        expect (copy.serialize () == data);
+    }
+
+    void testStream ()
+    {
+        testcase ("stream");
+
+        beast::Journal const j;
+        TestFamily f (j);
+
+        std::vector<uint256> keys;
+        auto base = std::make_shared<SHAMap> (SHAMapType::FREE, f, j);
+        for (int i = 0; i < 500; ++i)
+        {
+            auto const item = makeRandomItem ();
+            keys.push_back (item->key ());
+            base->addGiveItem (item, false, false);
+        }
+        base->getHash ();
+        base->setImmutable ();
+
+        std::stringstream stream;
+        auto prev = base;
+        for (std::uint32_t seq = 2; seq < 7; ++seq)
+        {
+            auto next = makeNext (prev, keys);
+            SHAMapLeafDelta (*prev, next,
+                SHAMapTreeNode::tnACCOUNT_STATE, seq).write (stream);
+            prev = next;
+        }
+
+        auto const data = stream.str ();
+
+        {
+            std::istringstream in (data);
+            auto map = base->snapShot (true);
+            expect (SHAMapLeafDelta::applyStream (in, *map, true) == 5);
+            expect (map->getHash () == prev->getHash ());
+        }
+
+        // A truncated stream applies every complete delta
+        {
+            std::istringstream in (data.substr (0, data.size () - 10));
+            auto map = base->snapShot (true);
+            expect (SHAMapLeafDelta::applyStream (in, *map, false) == 4);
+        }
+
+        // A length beyond the bytes present, or beyond any real
+        // delta, reads nothing
+        for (std::uint32_t size : { 48u * 1024 * 1024, 0xFFFFFFFFu })
+        {
+            Serializer s;
+            s.add32 (size);
+            std::string prefixed (
+                static_cast<char const*> (s.getDataPtr ()), s.getLength ());
+            std::istringstream in (prefixed + data);
+            SHAMapLeafDelta copy;
+            expect (! copy.read (in));
+        }
+    }
+
+    void run ()
+    {
+        testApply ();
+        testEncoding ();
+        testStream ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(SHAMapLeafDelta,shamap,divvy);
+
+} // tests
+} // shamap
+} // divvy
@@ -25,6 +25,7 @@
 #include <divvy/protocol/UInt160.h>
 #include <beast/unit_test/suite.h>
 #include <openssl/rand.h> // DEPRECATED
+#include <set>
 
 namespace divvy {
 namespace shamap {
@@ -91,13 +92,9 @@ public:
         return true;
     }
 
-    void run ()
+    void testSync (bool parallel)
     {
-        unsigned int seed;
-
-        // VFALCO DEPRECATED Should use C++11
-        RAND_pseudo_bytes (reinterpret_cast<unsigned char*> (&seed), sizeof (seed));
-        srand (seed);
+        testcase (parallel ? "parallel" : "serial");
 
         beast::Journal const j;                            // debug journal
 
@@ -147,7 +144,24 @@ public:
             hashes.clear ();
 
             // get the list of nodes we know we need
-            destination.getMissingNodes (nodeIDs, hashes, 2048, nullptr);
+            if (parallel)
+            {
+                auto const found = destination.getMissingNodes (2048, nullptr, 4,
+                    [&](std::vector<SHAMapNodeID> const& ids,
+                        std::vector<uint256> const& h)
+                    {
+                        nodeIDs.insert (nodeIDs.end (), ids.begin (), ids.end ());
+                        hashes.insert (hashes.end (), h.begin (), h.end ());
+                        return true;
+                    });
+                expect (found == nodeIDs.size (), "Found count");
+                expect (std::set<uint256> (hashes.begin (), hashes.end ()).size ()
+                    == hashes.size (), "Unique missing nodes");
+            }
+            else
+            {
+                destination.getMissingNodes (nodeIDs, hashes, 2048, nullptr);
+            }
 
             if (nodeIDs.empty ()) break;
 
@@ -222,6 +236,66 @@ public:
             passes << " passes, " << nodes << " nodes";
 #endif
     }
+
+    void testStop ()
+    {
+        testcase ("stop");
+
+        beast::Journal const j;
+        TestFamily f(j);
+        SHAMap source (SHAMapType::FREE, f, j);
+        SHAMap destination (SHAMapType::FREE, f, j);
+
+        for (int i = 0; i < 1000; ++i)
+            source.addItem (*makeRandomAS (), false, false);
+        expect (source.getHash ().isNonZero (), "Hash");
+        source.setImmutable ();
+
+        std::vector<SHAMapNodeID> nodeIDs;
+        std::vector<Blob> gotNodes;
+        destination.setSynching ();
+        expect (source.getNodeFat (SHAMapNodeID (), nodeIDs, gotNodes, false, 0),
+            "GetNodeFat");
+        expect (destination.addRootNode (gotNodes.front (), snfWIRE,
+            nullptr).isGood (), "AddRootNode");
+
+        // The handler ends the search after the first delivery
+        int calls = 0;
+        auto const found = destination.getMissingNodes (2048, nullptr, 4,
+            [&](std::vector<SHAMapNodeID> const& ids,
+                std::vector<uint256> const&)
+            {
+                ++calls;
+                return false;
+            });
+        expect (calls == 1, "Handler called once");
+        expect (found > 0 && found <= 16, "Found nodes");
+
+        // A limit ends it too
+        std::size_t delivered = 0;
+        expect (destination.getMissingNodes (3, nullptr, 4,
+            [&](std::vector<SHAMapNodeID> const& ids,
+                std::vector<uint256> const&)
+            {
+                delivered += ids.size ();
+                return true;
+            }) == 3, "Limit");
+        expect (delivered == 3, "Delivered");
+        expect (destination.isSynching (), "Still synching");
+    }
+
+    void run ()
+    {
+        unsigned int seed;
+
+        // VFALCO DEPRECATED Should use C++11
+        RAND_pseudo_bytes (reinterpret_cast<unsigned char*> (&seed), sizeof (seed));
+        srand (seed);
+
+        testSync (false);
+        testSync (true);
+        testStop ();
+    }
 };
 
 BEAST_DEFINE_TESTSUITE(sync,shamap,divvy);
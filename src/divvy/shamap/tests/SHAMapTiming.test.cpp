@@ -0,0 +1,129 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of divvyd: https://github.com/xdv/divvyd
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <divvy/shamap/SHAMap.h>
+#include <divvy/shamap/tests/common.h>
+#include <beast/random/xor_shift_engine.h>
+#include <beast/unit_test/suite.h>
+#include <beast/utility/Journal.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace divvy {
+namespace shamap {
+namespace tests {
+
+// Measures how well concurrent readers of an immutable
+// SHAMap scale with the number of threads.
+//
+class SHAMapTiming_test : public beast::unit_test::suite
+{
+public:
+    enum
+    {
+        numItems = 200000,
+        numLookups = 1000000
+    };
+
+    static uint256 makeKey (beast::xor_shift_engine& gen)
+    {
+        uint256 key;
+        auto p = reinterpret_cast<std::uint64_t*> (key.begin ());
+        for (int i = 0; i < 4; ++i)
+            p[i] = gen ();
+        return key;
+    }
+
+    // Each thread looks up its share of the keys, starting
+    // from the root every time.
+    std::chrono::milliseconds
+    timeLookups (SHAMap const& map, std::vector<uint256> const& keys,
+        std::size_t threads)
+    {
+        std::atomic<std::size_t> found (0);
+        std::vector<std::thread> workers;
+        auto const start = std::chrono::steady_clock::now ();
+        for (std::size_t t = 0; t < threads; ++t)
+        {
+            workers.emplace_back ([&, t]()
+            {
+                beast::xor_shift_engine gen (t + 1);
+                std::size_t n = 0;
+                for (std::size_t i = 0; i < numLookups / threads; ++i)
+                    if (map.hasItem (keys [gen () % keys.size ()]))
+                        ++n;
+                found += n;
+            });
+        }
+        for (auto& w : workers)
+            w.join ();
+        auto const elapsed = std::chrono::duration_cast <
+            std::chrono::milliseconds> (
+                std::chrono::steady_clock::now () - start);
+        expect (found == threads * (numLookups / threads), "missing key");
+        return elapsed;
+    }
+
+    void run ()
+    {
+        testcase ("parallel lookups");
+
+        beast::Journal const j;
+        TestFamily f (j);
+        SHAMap map (SHAMapType::FREE, f, j);
+
+        beast::xor_shift_engine gen (42);
+        std::vector<uint256> keys;
+        keys.reserve (numItems);
+        for (int i = 0; i < numItems; ++i)
+        {
+            keys.push_back (makeKey (gen));
+            Blob data (keys.back ().begin (), keys.back ().end ());
+            expect (map.addItem (SHAMapItem (keys.back (), data),
+                false, false), "no add");
+        }
+        map.setImmutable ();
+
+        std::size_t const maxThreads = std::max (
+            2u, std::thread::hardware_concurrency ());
+        auto const base = timeLookups (map, keys, 1);
+        for (std::size_t threads = 1; threads <= maxThreads; threads *= 2)
+        {
+            auto const elapsed = (threads == 1) ?
+                base : timeLookups (map, keys, threads);
+            std::stringstream ss;
+            ss << threads << " threads: " << elapsed.count () << "ms";
+            if (elapsed.count () > 0)
+                ss << ", relative throughput " <<
+                    (100 * base.count () / elapsed.count ()) << "%";
+            log << ss.str ();
+        }
+    }
+};
+
+BEAST_DEFINE_TESTSUITE_MANUAL(SHAMapTiming,shamap,divvy);
+
+} // tests
+} // shamap
+} // divvy
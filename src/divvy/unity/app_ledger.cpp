@@ -26,6 +26,7 @@
 #include <divvy/app/ledger/ConsensusTransSetSF.cpp>
 #include <divvy/app/ledger/DeferredCredits.cpp>
 #include <divvy/app/ledger/DirectoryEntryIterator.cpp>
+#include <divvy/app/ledger/FetchPackCache.cpp>
 #include <divvy/app/ledger/Ledger.cpp>
 #include <divvy/app/ledger/LedgerEntrySet.cpp>
 #include <divvy/app/ledger/LedgerHistory.cpp>
@@ -45,4 +46,5 @@
 
 #include <divvy/app/ledger/tests/common_ledger.cpp>
 #include <divvy/app/ledger/tests/DeferredCredits.test.cpp>
+#include <divvy/app/ledger/tests/FetchPackCache.test.cpp>
 #include <divvy/app/ledger/tests/Ledger_test.cpp>
@@ -22,23 +22,30 @@
 #include <divvy/basics/impl/BasicConfig.cpp>
 #include <divvy/basics/impl/CheckLibraryVersions.cpp>
 #include <divvy/basics/impl/CountedObject.cpp>
+#include <divvy/basics/impl/FrequencySketch.cpp>
 #include <divvy/basics/impl/Log.cpp>
 #include <divvy/basics/impl/make_SSLContext.cpp>
 #include <divvy/basics/impl/RangeSet.cpp>
+#include <divvy/basics/impl/SlabAllocator.cpp>
 #include <divvy/basics/impl/ResolverAsio.cpp>
 #include <divvy/basics/impl/strHex.cpp>
 #include <divvy/basics/impl/StringUtilities.cpp>
 #include <divvy/basics/impl/Sustain.cpp>
+#include <divvy/basics/impl/TaskPool.cpp>
 #include <divvy/basics/impl/TestSuite.test.cpp>
 #include <divvy/basics/impl/ThreadName.cpp>
 #include <divvy/basics/impl/Time.cpp>
 #include <divvy/basics/impl/UptimeTimer.cpp>
 
 #include <divvy/basics/tests/CheckLibraryVersions.test.cpp>
+#include <divvy/basics/tests/FrequencySketch.test.cpp>
 #include <divvy/basics/tests/hardened_hash_test.cpp>
 #include <divvy/basics/tests/KeyCache.test.cpp>
 #include <divvy/basics/tests/RangeSet.test.cpp>
+#include <divvy/basics/tests/ShardedTaggedCache.test.cpp>
+#include <divvy/basics/tests/SlabAllocator.test.cpp>
 #include <divvy/basics/tests/StringUtilities.test.cpp>
+#include <divvy/basics/tests/TaskPool.test.cpp>
 #include <divvy/basics/tests/TaggedCache.test.cpp>
 
 #if DOXYGEN
@@ -28,18 +28,27 @@
 #include <divvy/nodestore/backend/RocksDBQuickFactory.cpp>
 
 #include <divvy/nodestore/impl/BatchWriter.cpp>
+#include <divvy/nodestore/impl/CompressionDictionary.cpp>
 #include <divvy/nodestore/impl/DatabaseImp.h>
 #include <divvy/nodestore/impl/DatabaseRotatingImp.cpp>
 #include <divvy/nodestore/impl/DummyScheduler.cpp>
 #include <divvy/nodestore/impl/DecodedBlob.cpp>
 #include <divvy/nodestore/impl/EncodedBlob.cpp>
+#include <divvy/nodestore/impl/FilteredBackend.cpp>
+#include <divvy/nodestore/impl/HotKeys.cpp>
+#include <divvy/nodestore/impl/KeyFilter.cpp>
 #include <divvy/nodestore/impl/ManagerImp.cpp>
 #include <divvy/nodestore/impl/NodeObject.cpp>
+#include <divvy/nodestore/impl/ReadQueue.cpp>
 #include <divvy/nodestore/impl/ScopedMetrics.cpp>
+#include <divvy/nodestore/impl/ScopedReadPriority.cpp>
+#include <divvy/nodestore/impl/ScopedUncachedReads.cpp>
 
 #include <divvy/nodestore/tests/Backend.test.cpp>
 #include <divvy/nodestore/tests/Basics.test.cpp>
 #include <divvy/nodestore/tests/Database.test.cpp>
 #include <divvy/nodestore/tests/import_test.cpp>
+#include <divvy/nodestore/tests/KeyFilter.test.cpp>
+#include <divvy/nodestore/tests/ReadQueue.test.cpp>
 #include <divvy/nodestore/tests/Timing.test.cpp>
 
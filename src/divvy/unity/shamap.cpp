@@ -21,10 +21,13 @@
 #include <divvy/shamap/impl/SHAMap.cpp>
 #include <divvy/shamap/impl/SHAMapDelta.cpp>
 #include <divvy/shamap/impl/SHAMapItem.cpp>
+#include <divvy/shamap/impl/SHAMapLeafDelta.cpp>
 #include <divvy/shamap/impl/SHAMapMissingNode.cpp>
 #include <divvy/shamap/impl/SHAMapNodeID.cpp>
 #include <divvy/shamap/impl/SHAMapSync.cpp>
 #include <divvy/shamap/impl/SHAMapTreeNode.cpp>
 #include <divvy/shamap/tests/FetchPack.test.cpp>
 #include <divvy/shamap/tests/SHAMap.test.cpp>
+#include <divvy/shamap/tests/SHAMapLeafDelta.test.cpp>
 #include <divvy/shamap/tests/SHAMapSync.test.cpp>
+#include <divvy/shamap/tests/SHAMapTiming.test.cpp>